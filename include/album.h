@@ -0,0 +1,25 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Built-in album: a packed set of JPEGs in the "album" flash partition
+// (see partitions.csv), written by scripts/album.sh. The partition is
+// memory mapped, so photos are decoded straight from flash with no file
+// system and no copies. Used when the SD card is missing and as a
+// reference for the SD decode benchmark.
+#define ALBUM_PARTITION "album"
+#define ALBUM_NAME_MAX 56
+
+// Partition layout (little endian), offsets are from the partition start:
+//   header   "ALB1", u16 count, u16 reserved
+//   entries  count x { u32 offset, u32 length, char name[ALBUM_NAME_MAX] }
+//   data     the JPEGs back to back, in entry order
+
+// Maps the partition, returns false when it is missing or holds no album
+bool albumOpen();
+
+int albumCount();
+
+// JPEG data and file name of a photo, the data stays mapped for good
+const uint8_t *albumData(int index, uint32_t *size);
+const char *albumName(int index);
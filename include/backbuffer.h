@@ -0,0 +1,57 @@
+#pragma once
+
+#include <Arduino.h>
+#include <TFT_eSPI.h>
+
+// Rows per heap block of the frame, the ESP32 heap has no single free block
+// large enough for a whole 480x320 frame. The frame has the panel size of
+// include/panel.h, an 800x480 frame does not fit the heap at all and the
+// photos are then drawn directly.
+#define BACKBUFFER_BAND_ROWS 64
+
+// Rows expanded per DMA transfer, two such line buffers are alternated
+#define BACKBUFFER_DMA_ROWS 4
+
+// Off-screen 8-bit frame that the next photo is decoded into, so the photo
+// replaces the previous one in a single pass instead of being painted block
+// by block over a black screen.
+//
+// Every decoded block goes through backBufferCapture(), which maps each
+// pixel to a palette index. The palette is built per photo while decoding:
+// pixels are binned by their RGB444 value, the first pixel of a new bin
+// claims the next free entry and later pixels of that bin share it. Once all
+// 256 entries are taken, new bins are mapped to the nearest existing entry.
+// Each entry ends up as the mean of the pixels mapped to it. Entry 0 is
+// always black, used for the borders around smaller photos.
+//
+// backBufferPresent() expands the frame through the palette into two small
+// line buffers and streams them to the panel with DMA, expanding the next
+// rows while the previous ones are on the bus.
+
+// Allocates the frame, the palette tables and the DMA line buffers and
+// prints the heap cost, call once during setup
+bool backBufferBegin(TFT_eSPI &tft);
+
+// Clears the frame to black, resets the palette and routes decoded blocks
+// into the frame. Returns false when the back buffer is not available.
+bool backBufferStart();
+
+// True between backBufferStart() and backBufferPresent()
+bool backBufferCapturing();
+
+// Stores a decoded block in the frame. Set swapped when the pixels are
+// already byte-swapped for the SPI bus.
+void backBufferCapture(int16_t x, int16_t y, uint16_t w, uint16_t h, const uint16_t *pixels, bool swapped);
+
+// Clears the frame and the palette again, e.g. after a failed decode
+void backBufferClear();
+
+// Stops capturing and pushes the whole frame to the panel
+void backBufferPresent();
+
+// Stops capturing and settles the palette without pushing anything, the
+// frame can then go to the panel in strips with backBufferPushColumns()
+void backBufferFinish();
+
+// Pushes columns x .. x + w - 1 of the frame to the same columns of the panel
+void backBufferPushColumns(int16_t x, int16_t w);
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Backlight level through the LEDC peripheral.
+//
+// backlightFade() hands the ramp to the LEDC hardware fade and returns at
+// once: the duty steps happen without the CPU, so a fade runs alongside a
+// decode. A new fade or level waits for a fade that is still running, keep
+// fades short. Levels are in percent of full brightness.
+//
+// The backlight pin belongs to this module, do not analogWrite() it.
+
+void backlightBegin(uint8_t pin, int percent);
+
+// Sets the level at once
+void backlightSet(int percent);
+
+// Starts a hardware fade to percent over duration_ms
+void backlightFade(int percent, uint32_t duration_ms);
+
+// Waits until the running fade is done
+void backlightWait();
+
+// Level the backlight is at or fading to
+int backlightTarget();
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <Arduino.h>
+#include "FS.h"
+
+// Motion clips (.mjpg) written by scripts/clip.sh, played from SD in the
+// same playlist as the photos. A clip loops until the slideshow moves on.
+#define CLIP_EXTENSION ".mjpg"
+
+#define CLIP_MAX_FRAMES 1024
+#define CLIP_FRAME_MAX 65536 // largest single JPEG frame, 480x320 baseline frames stay well below
+
+// File layout (little endian):
+//   header   "MJP1", u16 width, u16 height, u16 fps, u16 frame count
+//   index    (frame count + 1) x u32 frame offset from the file start,
+//            the last entry is the end of the data
+//   data     baseline JPEG frames back to back
+//
+// Frames are paced against the clock: a frame that is already late when
+// the previous one is done is dropped instead of played, so the clip keeps
+// its speed when decode and SPI can't keep up. Shown and dropped frames and
+// the achieved frame rate are reported after every pass through the clip.
+
+// Returns true for file names with the clip extension, any case
+bool clipIsClip(const char *name);
+
+// Opens a clip and reads its frame index, returns 0 on success
+int clipOpen(fs::FS &fs, const char *path, uint16_t *width, uint16_t *height);
+
+// Shows the frame that is due now at (x, y), dropping late frames.
+// Returns false when nothing is playing.
+bool clipTick(int32_t x, int32_t y);
+
+// Stops playback and reports the last pass
+void clipStop();
+
+bool clipPlaying();
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Directory listing straight from the directory entries.
+//
+// openNextFile() opens every entry it returns: the Arduino SD layer builds
+// the full path, stat()s it and fopen()s it before the caller gets to read
+// the name, even for entries that are skipped. dirScan() walks the
+// directory with the VFS opendir()/readdir() instead and takes the name and
+// the file/directory flag from the directory entry, so nothing is opened
+// and the directory itself is read once, sector after sector.
+//
+// Paths are VFS paths, with the mount point of the card in front ("/sd/").
+// The scanner has no Arduino dependencies.
+
+struct DirScanStats
+{
+  uint32_t entries; // directory entries read
+  uint32_t files;   // regular files handed to the callback
+};
+
+// Calls found for every regular file in path whose name does not start with
+// a dot, in directory order. Returns false if the directory cannot be
+// opened.
+bool dirScan(const char *path, void (*found)(void *context, const char *name), void *context, DirScanStats *stats);
+
+// True when name ends in extension (".jpg"), ignoring case
+bool dirHasExtension(const char *name, const char *extension);
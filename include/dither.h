@@ -0,0 +1,35 @@
+#pragma once
+
+#include <Arduino.h>
+#include "FS.h"
+
+// Same signature as the TJpg_Decoder sketch callback, so tft_output() can be
+// shared by both decode paths. Pixels handed to it are byte-swapped RGB565,
+// ready to go out on the SPI bus, so TFT byte swapping must be off.
+// Workspace needed by the ROM decoder (3100 bytes is its documented minimum)
+#define DITHER_WORKSPACE_SIZE 3100
+
+// Largest MCU is 16x16 pixels
+#define DITHER_BLOCK_PIXELS (16 * 16)
+
+typedef bool (*DitherOutputCallback)(int16_t x, int16_t y, uint16_t w, uint16_t h, uint16_t *data);
+
+// Builds the ordered-dither lookup tables and registers the block output
+// callback. Must be called once before ditherDrawFsJpg().
+void ditherInit(DitherOutputCallback callback);
+
+// Decodes a JPEG at full 24-bit precision per MCU block and packs every
+// pixel to byte-swapped RGB565 through a 4x4 ordered-dither table keyed on
+// screen position. Returns 0 on success or a TJpgDec style error code.
+int ditherDrawFsJpg(int32_t x, int32_t y, const char *path, fs::FS &fs);
+
+// Packs a w x h region of an RGB888 block (stride pixels per row) into
+// byte-swapped RGB565 at out. x and y are the screen position of the first
+// pixel and select the dither cells; with dithered false the channels are
+// truncated like TJpgDec does. ditherInit() must have run.
+void ditherPackBlock(const uint8_t *rgb, uint16_t stride, uint16_t *out, int32_t x, int32_t y, uint16_t w, uint16_t h, bool dithered);
+
+// The ROM decoder workspace and the packed block buffer, shared with the
+// viewport decoder (roi.h). Only one ROM decode runs at a time.
+uint8_t *ditherWorkspace();
+uint16_t *ditherBlockBuffer();
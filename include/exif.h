@@ -0,0 +1,26 @@
+#pragma once
+
+#include <Arduino.h>
+#include "FS.h"
+
+// EXIF orientation values (TIFF tag 0x0112)
+#define EXIF_ORIENTATION_NORMAL 1     // upright, no transform needed
+#define EXIF_ORIENTATION_MIRROR_H 2   // mirrored horizontally
+#define EXIF_ORIENTATION_ROTATE_180 3 // rotated 180 degrees
+#define EXIF_ORIENTATION_MIRROR_V 4   // mirrored vertically
+#define EXIF_ORIENTATION_TRANSPOSE 5  // mirrored across the main diagonal
+#define EXIF_ORIENTATION_ROTATE_90 6  // needs 90 degrees clockwise rotation
+#define EXIF_ORIENTATION_TRANSVERSE 7 // mirrored across the anti-diagonal
+#define EXIF_ORIENTATION_ROTATE_270 8 // needs 90 degrees counter-clockwise rotation
+
+// Reads the orientation tag from the APP1 (Exif) segment of a JPEG file.
+// Only the marker headers in front of the image data are read, the entropy
+// coded data is never touched. Returns EXIF_ORIENTATION_NORMAL when the
+// file has no Exif segment or the tag is missing or invalid.
+uint8_t readExifOrientation(fs::FS &fs, const char *path);
+
+// Orientations 5-8 swap the displayed width and height
+inline bool exifSwapsAxes(uint8_t orientation)
+{
+  return orientation >= EXIF_ORIENTATION_TRANSPOSE;
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef ARDUINO
+#include "FS.h"
+#endif
+
+#include "panel.h"
+
+// Speed-tuned baseline JPEG decoder, an alternative to TJpg_Decoder for
+// upright photos. Compared to TJpgDec it trades RAM and code size for speed:
+//   - 9-bit Huffman lookup tables, with small AC coefficients decoded
+//     (run, size and value) in a single table lookup
+//   - integer AAN IDCT with the scale factors folded into the quantisation
+//     tables, and a shortcut for blocks that only carry a DC value
+//   - YCbCr to RGB565 conversion that writes byte-swapped pixels, ready for
+//     the SPI bus, computing the chroma terms once per chroma sample
+//   - MCUs are collected into strips of up to FASTJPEG_STRIP_WIDTH pixels,
+//     so the display window is set once per strip instead of once per MCU
+// The hot loops are placed in IRAM on the ESP32. The decoder has no Arduino
+// dependencies and builds on the host (see scripts/jpegbench.sh).
+//
+// Supported: sequential Huffman JPEGs with up to two tables per class,
+// grayscale or YCbCr, 4:4:4, 4:2:2 and 4:2:0, restart intervals.
+// Progressive and arithmetic coded files are rejected with FASTJPEG_FMT3.
+
+#define FASTJPEG_STRIP_WIDTH PANEL_WIDTH // widest strip handed to the output callback, one panel row
+#define FASTJPEG_INPUT_SIZE 4096 // read buffer for streamed input
+
+// Same values as TJpgDec's JRESULT, so callers handle both decoders alike
+#define FASTJPEG_OK 0   // succeeded
+#define FASTJPEG_INTR 1 // interrupted by the output callback
+#define FASTJPEG_INP 2  // input stream ended or failed
+#define FASTJPEG_PAR 5  // parameter error
+#define FASTJPEG_FMT1 6 // data format error, possibly damaged data
+#define FASTJPEG_FMT3 8 // not supported JPEG standard
+
+// Same signature as the TJpg_Decoder sketch callback. Pixels are
+// byte-swapped RGB565, so TFT byte swapping must be off. Return false to
+// stop decoding.
+typedef bool (*FastJpegOutputCallback)(int16_t x, int16_t y, uint16_t w, uint16_t h, uint16_t *data);
+
+// Reads up to length bytes of JPEG data into buffer, returns the number read
+typedef size_t (*FastJpegReadCallback)(void *context, uint8_t *buffer, size_t length);
+
+// Registers the strip output callback, call once before decoding
+void fastJpegInit(FastJpegOutputCallback callback);
+
+// Decodes a JPEG read through read() with its top-left corner at (x, y)
+int fastJpegDecode(FastJpegReadCallback read, void *context, int32_t x, int32_t y);
+
+// Decodes a JPEG held in memory (RAM or mapped flash) without copying it
+int fastJpegDrawMem(int32_t x, int32_t y, const uint8_t *data, size_t size);
+
+#ifdef ARDUINO
+int fastJpegDrawFs(int32_t x, int32_t y, const char *path, fs::FS &fs);
+#endif
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Heap guard for the steady-state slideshow loop.
+//
+// Built with HEAP_GUARD (see the esp32dev_heapguard environment) every
+// malloc/calloc/realloc made after heapGuardArm() is counted through linker
+// wrapping, and heapGuardReport() prints the count together with the largest
+// free heap block after each slide. Without HEAP_GUARD all of it compiles
+// away.
+//
+// A slide is not free of allocations: every SD.open() allocates the File
+// and the VFS stream with its buffer, and the SD layer offers no way to
+// reuse them. The first HEAP_GUARD_BASELINE_SLIDES slides measure what a
+// slide normally costs, and any later slide that allocates more is
+// reported as a failure.
+//
+// HEAP_SOAK_SLIDES makes the slideshow advance back to back for that many
+// slides and prints whether the largest free block stayed flat and no slide
+// went over the baseline.
+
+#ifndef HEAP_SOAK_SLIDES
+#define HEAP_SOAK_SLIDES 0
+#endif
+
+#ifndef HEAP_GUARD_BASELINE_SLIDES
+#define HEAP_GUARD_BASELINE_SLIDES 32
+#endif
+
+#ifdef HEAP_GUARD
+void heapGuardArm();
+void heapGuardReport();
+bool heapSoakRunning();
+#else
+inline void heapGuardArm() {}
+inline void heapGuardReport() {}
+inline bool heapSoakRunning() { return false; }
+#endif
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <Arduino.h>
+#include <TFT_eSPI.h>
+
+// Input layer and touch-to-photon latency harness.
+//
+// Touch and boot button reads go through inputGetTouch() and
+// inputButtonPressed(). Built with INPUT_TRACE (see the esp32dev_latency
+// environment) the device also accepts a recorded event trace over serial
+// and replays it into these reads in real time, and the slideshow reports
+// when the first pixel and the complete image of the reaction reach the
+// panel. Latency distributions are printed per gesture type.
+//
+// Serial commands, one per line:
+//   RECORD               print live touch/button events as trace lines
+//   REPLAY BEGIN         start collecting a trace
+//   T <ms> <x> <y> <z>   touch sample, z is pressure, 0 = released
+//   B <ms> <0|1>         boot button released / pressed
+//   REPLAY END           replay the collected trace from now
+//   REPORT               print latency distributions
+//   RESET                clear collected latencies
+//   SPANS                print the span trace ring (SPAN_TRACE builds)
+//
+// Without INPUT_TRACE the reads go straight to the hardware and the
+// latency marks compile to nothing.
+
+#ifdef INPUT_TRACE
+bool inputGetTouch(TFT_eSPI &tft, uint16_t *x, uint16_t *y);
+bool inputButtonPressed(uint8_t pin);
+
+// Reads serial commands, call from loop()
+void inputTraceTick();
+
+// The input handlers decided what the latest touch does
+void latencyGesture(const char *type);
+
+// The reaction started to reach the panel / is complete
+void latencyFirstPixel();
+void latencyComplete();
+
+void latencyReport();
+#else
+inline bool inputGetTouch(TFT_eSPI &tft, uint16_t *x, uint16_t *y) { return tft.getTouch(x, y, 600); }
+inline bool inputButtonPressed(uint8_t pin) { return digitalRead(pin) == LOW; }
+inline void inputTraceTick() {}
+inline void latencyGesture(const char *type) {}
+inline void latencyFirstPixel() {}
+inline void latencyComplete() {}
+inline void latencyReport() {}
+#endif
@@ -0,0 +1,120 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Live mode: frames streamed from a host over serial, for demos and
+// dashboards, without touching the SD card.
+//
+// The host sender (tools/live.cpp, see scripts/live.sh) uses the framing of
+// the upload protocol (include/upload.h) and opens a session the same way,
+// with a LIVE_HELLO at 115200 baud, with the payload of an upload HELLO
+// (baud and host clock). Both ends switch to the negotiated baud,
+// then the host sends only the tiles of each frame that changed since the
+// previous one:
+//
+//   TILE   frame number, tiles in the frame, tile index, tile rect, format
+//          and a fragment of the encoded tile. Tiles are JPEG or
+//          RLE-compressed RGB565, up to LIVE_TILE_SIDE pixels square; a
+//          tile larger than UPLOAD_CHUNK bytes is split over several TILE
+//          frames.
+//   END    frame number, after the last tile of the frame
+//          -> FRAME_ACK with the time the frame spent decoding and drawing
+//             and a bitmap of the tiles that made it to the panel. Tiles
+//             damaged on the way are sent again with the next frame. A
+//             repeated END gets the same FRAME_ACK again.
+//   ACK    bytes read off the port so far, every LIVE_ACK_INTERVAL bytes.
+//          The host keeps at most LIVE_WINDOW_BYTES unread, which fits in
+//          the serial receive buffer, so bytes keep arriving while a tile
+//          is decoded and pushed. A PING is answered with an ACK as well.
+//   BYE    -> BYE_ACK, back to 115200
+//
+// Each tile is drawn as soon as its last fragment arrives. RLE tiles are
+// decoded into one of two pixel buffers that alternate, so the previous
+// tile can still be on its way to the panel by DMA.
+//
+// Like the upload receiver, the session has no Arduino dependencies; the
+// port, the clock and the panel are reached through LiveIo.
+
+#define LIVE_TILE_SIDE 64                                        // largest tile width and height
+#define LIVE_TILE_BYTES (LIVE_TILE_SIDE * LIVE_TILE_SIDE * 2 + 64) // largest encoded tile, any RLE tile fits
+#define LIVE_WINDOW_BYTES 8192                                   // unread bytes the host may have in flight
+#define LIVE_ACK_INTERVAL 2048                                   // bytes read between ACKs
+#define LIVE_IDLE_TIMEOUT 3000                                   // session ends after this long without a frame (ms)
+#define LIVE_FRAME_TILES 1024                                    // most tiles in one frame
+#define LIVE_TILE_HEADER 18                                      // TILE payload ahead of the fragment data
+
+enum LiveFrameType
+{
+  LIVE_HELLO = 0x10,
+  LIVE_TILE = 0x11,
+  LIVE_BYE = 0x12,
+  LIVE_END = 0x13,
+  LIVE_HELLO_ACK = 0x90,
+  LIVE_ACK = 0x91,
+  LIVE_FRAME_ACK = 0x92,
+  LIVE_BYE_ACK = 0x93,
+};
+
+// Tile formats
+#define LIVE_FORMAT_JPEG 0
+#define LIVE_FORMAT_RLE 1
+
+// FRAME_ACK status
+#define LIVE_FRAME_OK 0
+#define LIVE_FRAME_DAMAGED 1
+
+// Sent in an upload ERROR frame when the tile buffers do not fit in memory
+#define LIVE_STATUS_MEMORY 0x10
+
+// Session events reported to LiveIo::event
+#define LIVE_EVENT_START 0 // session accepted, before HELLO_ACK and the baud switch
+#define LIVE_EVENT_END 1   // session over, the port is back at 115200
+
+struct LiveIo
+{
+  void *context;
+
+  // Serial port and clock, as in UploadIo
+  size_t (*read)(void *context, uint8_t *buffer, size_t length);
+  void (*write)(void *context, const uint8_t *data, size_t length);
+  void (*set_baud)(void *context, uint32_t baud);
+  uint32_t (*millis)(void *context);
+  uint32_t (*micros)(void *context);
+
+  // Panel: pixels are byte-swapped RGB565, ready for the SPI bus. The
+  // pixel buffer is left alone until the call after next, so it can be
+  // pushed with DMA and the call may return before the transfer is done.
+  bool (*draw_jpeg)(void *context, int16_t x, int16_t y, const uint8_t *data, size_t length);
+  void (*draw_pixels)(void *context, int16_t x, int16_t y, uint16_t w, uint16_t h, uint16_t *pixels);
+
+  // Optional, may be null
+  void (*event)(void *context, int event);
+};
+
+struct LiveStats
+{
+  uint32_t frames;     // frames completed
+  uint32_t damaged;    // frames with a missing or broken tile
+  uint32_t tiles;      // tiles drawn
+  uint32_t wire_bytes; // bytes read from the port
+  uint32_t busy_us;    // time spent decoding and drawing tiles
+  uint32_t elapsed_ms;
+  uint32_t baud;
+};
+
+// Runs a live session on a width x height panel once a LIVE_HELLO asking
+// for requested_baud has arrived, with the totals in stats. Returns false
+// when the tile buffers could not be allocated.
+bool liveRun(const LiveIo &io, uint32_t requested_baud, int16_t width, int16_t height, LiveStats *stats);
+
+// ====== SHARED WITH THE SENDER ======
+
+// RLE for RGB565 tiles: a byte below 0x80 is followed by that many plus one
+// pixels, a byte from 0x80 up repeats the pixel that follows (byte & 0x7F)
+// plus two times. Pixels are two bytes in bus order.
+// Returns the encoded size, or 0 when it would not fit in out_length
+size_t liveRleEncode(const uint16_t *pixels, size_t count, uint8_t *out, size_t out_length);
+
+// Returns true when data decodes to exactly count pixels
+bool liveRleDecode(const uint8_t *data, size_t length, uint16_t *pixels, size_t count);
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Leveled, non-blocking logging.
+//
+// LOG_ERROR/LOG_WARN/LOG_INFO/LOG_DEBUG take printf arguments. Levels above
+// LOG_LEVEL expand to nothing, their format strings and arguments are never
+// compiled in. Enabled messages are formatted into a slot of a fixed ring
+// buffer and returned right away; a low-priority task writes them to Serial.
+// Producers reserve slots with a compare-and-swap, so any task can log
+// without taking a lock. When the ring is full the message is dropped and
+// counted, and the drain task reports the count once it catches up.
+//
+// Pick the level with a build flag, e.g. -DLOG_LEVEL=LOG_LEVEL_DEBUG to see
+// every file found while scanning and every tap.
+
+#define LOG_LEVEL_NONE 0
+#define LOG_LEVEL_ERROR 1
+#define LOG_LEVEL_WARN 2
+#define LOG_LEVEL_INFO 3
+#define LOG_LEVEL_DEBUG 4
+
+#ifndef LOG_LEVEL
+#define LOG_LEVEL LOG_LEVEL_INFO
+#endif
+
+#define LOG_SLOTS 32     // messages waiting for the drain task, power of two
+#define LOG_LINE_MAX 96  // longer messages are truncated
+
+// Prepares the ring and starts the drain task, call once right after
+// Serial.begin() and before anything is logged
+void logBegin();
+
+// Queues one line, a newline is appended
+void logWrite(const char *format, ...) __attribute__((format(printf, 1, 2)));
+
+// Messages dropped because the ring was full, since boot
+uint32_t logDropped();
+
+// Holds back output while the serial port carries something else, e.g. a
+// photo upload. Messages keep queueing, and dropping once the ring is full.
+// Pausing waits until a line the drain task is writing has left the port.
+void logPause(bool paused);
+
+#if LOG_LEVEL >= LOG_LEVEL_ERROR
+#define LOG_ERROR(...) logWrite(__VA_ARGS__)
+#else
+#define LOG_ERROR(...) do {} while (0)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_WARN
+#define LOG_WARN(...) logWrite(__VA_ARGS__)
+#else
+#define LOG_WARN(...) do {} while (0)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_INFO
+#define LOG_INFO(...) logWrite(__VA_ARGS__)
+#else
+#define LOG_INFO(...) do {} while (0)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_DEBUG
+#define LOG_DEBUG(...) logWrite(__VA_ARGS__)
+#else
+#define LOG_DEBUG(...) do {} while (0)
+#endif
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <Arduino.h>
+#include <TFT_eSPI.h>
+
+// Overlay band along the bottom edge of the screen
+#define OVERLAY_HEIGHT 20
+
+// Clock, photo counter and file name drawn over the photo.
+//
+// While a photo is decoded, tft_output() hands every block to
+// overlayCapture(), which keeps a copy of the pixels that fall inside the
+// overlay band. Updating the overlay afterwards only restores that strip from
+// RAM, composites the text on top in a sprite and pushes the strip, so the
+// JPEG is never decoded again and the SD card is never touched.
+
+// Allocates the band and the compositing sprite, call once during setup
+bool overlayBegin(TFT_eSPI &tft);
+
+// Clears the saved band to black, call before each decode
+void overlayResetBand();
+
+// Saves the part of a decoded block that lands inside the band. Set swapped
+// when the pixels are already byte-swapped for the SPI bus.
+void overlayCapture(int16_t x, int16_t y, uint16_t w, uint16_t h, const uint16_t *pixels, bool swapped);
+
+// Sets the caption and counter shown for the current photo
+void overlaySetPhoto(const char *name, int index, int count);
+
+// Restores the band and draws the overlay text over it
+void overlayDraw();
+
+// Redraws the overlay when the clock minute has changed since the last draw
+void overlayTick();
+
+// Marks the band stale, e.g. while the settings screen covers the photo
+void overlayInvalidate();
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <stdint.h>
+
+// Display geometry and screen layouts, fixed at compile time.
+//
+// The firmware is built for one panel size, PANEL_WIDTH x PANEL_HEIGHT in
+// the landscape rotation: 480x320 by default, 320x240 and 800x480 through
+// the esp32dev_320x240 and esp32dev_800x480 environments. Everything that
+// depends on it is a constant of Panel, so image centring, block clipping
+// and the strip, band and frame buffers compile to immediates for the
+// selected size instead of asking the display driver at run time.
+//
+// Screen layouts are designed for 480x320 and scaled to the panel: x
+// positions by the width, y positions, button sizes and text sizes by the
+// height.
+
+#ifndef PANEL_WIDTH
+#define PANEL_WIDTH 480
+#endif
+
+#ifndef PANEL_HEIGHT
+#define PANEL_HEIGHT 320
+#endif
+
+struct PanelRect
+{
+  int16_t x;
+  int16_t y;
+  int16_t w;
+  int16_t h;
+
+  // Edges included, as the touch checks always were
+  constexpr bool contains(int32_t px, int32_t py) const { return px >= x && px <= x + w && py >= y && py <= y + h; }
+
+  constexpr int16_t centerX() const { return x + w / 2; }
+  constexpr int16_t centerY() const { return y + h / 2; }
+};
+
+template <int16_t W, int16_t H>
+struct PanelGeometry
+{
+  static_assert(W > H, "the panel is used in landscape");
+  static_assert(W >= 320 && H >= 240, "the screen layouts need at least 320x240");
+
+  static constexpr int16_t width = W;
+  static constexpr int16_t height = H;
+  static constexpr int16_t center_x = W / 2;
+  static constexpr int16_t center_y = H / 2;
+
+  // Touch areas: left third previous, center third taps, right third next
+  static constexpr int16_t touch_section = W / 3;
+  static constexpr int16_t center_touch_left = touch_section;
+  static constexpr int16_t center_touch_right = touch_section * 2;
+
+  // 480x320 layout coordinates on this panel
+  static constexpr int16_t sx(int32_t x) { return x * W / 480; }
+  static constexpr int16_t sy(int32_t y) { return y * H / 320; }
+  static constexpr uint8_t textSize(int32_t size) { return size * H / 320 > 1 ? size * H / 320 : 1; }
+
+  // Top left corner of a w x h image centered on screen, 0 when the image
+  // is larger
+  static constexpr int16_t centerLeft(int32_t w) { return w < W ? (W - w) / 2 : 0; }
+  static constexpr int16_t centerTop(int32_t h) { return h < H ? (H - h) / 2 : 0; }
+
+  // True when a block lies entirely outside the screen
+  static constexpr bool offScreen(int32_t x, int32_t y, int32_t w, int32_t h)
+  {
+    return x >= W || y >= H || x + w <= 0 || y + h <= 0;
+  }
+};
+
+using Panel = PanelGeometry<PANEL_WIDTH, PANEL_HEIGHT>;
+
+// Settings screen: a card with - value + for the frame interval, one for
+// the brightness, and a close button. Some touch areas are offset from the
+// drawn buttons, they follow where the panel reports presses on them.
+// Rectangles are functions so nothing needs a definition outside the class
+// under C++11.
+template <class P>
+struct SettingsLayout
+{
+  static constexpr int16_t margin = P::sx(20);
+  static constexpr int16_t button = P::sy(40);
+  static constexpr int16_t minus_x = P::sx(110);
+  static constexpr int16_t plus_x = P::width - P::sx(110) - button;
+
+  static constexpr PanelRect intervalCard() { return {margin, P::sy(20), (int16_t)(P::width - 2 * margin), P::sy(100)}; }
+  static constexpr int16_t interval_title_y = P::sy(35);
+  static constexpr PanelRect intervalMinus() { return {minus_x, P::sy(65), button, button}; }
+  static constexpr PanelRect intervalPlus() { return {plus_x, P::sy(65), button, button}; }
+
+  static constexpr PanelRect brightnessCard() { return {margin, P::sy(140), (int16_t)(P::width - 2 * margin), P::sy(100)}; }
+  static constexpr int16_t brightness_title_y = P::sy(155);
+  static constexpr PanelRect brightnessMinus() { return {minus_x, P::sy(185), button, button}; }
+  static constexpr PanelRect brightnessPlus() { return {plus_x, P::sy(185), button, button}; }
+  static constexpr PanelRect brightnessMinusTouch() { return {P::sx(128), P::sy(192), button, button}; }
+  static constexpr PanelRect brightnessPlusTouch() { return {P::sx(312), P::sy(192), button, button}; }
+
+  static constexpr PanelRect close() { return {P::sx(160), P::sy(260), P::sx(160), P::sy(40)}; }
+  static constexpr PanelRect closeTouch() { return {P::sx(172), P::sy(264), P::sx(140), P::sy(40)}; }
+
+  static constexpr int16_t corner = P::sy(12);
+  static constexpr int16_t button_corner = P::sy(6);
+  static constexpr uint8_t label_text = P::textSize(2);
+  static constexpr uint8_t value_text = P::textSize(3);
+};
+
+using Settings = SettingsLayout<Panel>;
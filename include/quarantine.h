@@ -0,0 +1,53 @@
+#pragma once
+
+#include <Arduino.h>
+#include "FS.h"
+
+// List of photos that failed validation or decoding, kept on the card
+#define QUARANTINE_PATH "/quarantine.txt"
+
+// Photos that can be quarantined, 8 bytes of RAM each
+#define QUARANTINE_MAX 256
+
+// Reasons returned by validateJpeg()
+#define JPEG_VALID 0
+#define JPEG_NOT_JPEG 1         // no SOI marker
+#define JPEG_BAD_HEADER 2       // segment chain broken before the image data
+#define JPEG_UNSUPPORTED 3      // progressive, arithmetic or lossless frame
+#define JPEG_BAD_SUBSAMPLING 4  // sampling TJpgDec cannot decode
+#define JPEG_TRUNCATED 5        // no EOI marker at the end of the file
+
+// Checks the markers of a JPEG and that its frame is one TJpgDec decodes
+// (baseline, 8-bit, 4:4:4, 4:2:2 or 4:2:0) without decoding any image
+// data. Returns JPEG_VALID or one of the reasons above.
+int validateJpeg(fs::FS &fs, const char *path);
+
+const char *validateReason(int reason);
+
+// The list keeps one "name<TAB>size<TAB>reason" line per photo. An entry
+// only matches while the file on the card still has the size it was
+// quarantined with: a photo replaced under the same name, or a hash
+// collision with a good one, is released on the next check. All calls are
+// made with the card locked, which is how the background scan and the main
+// loop share the list.
+
+// Loads the quarantine list from the card, call once after mounting
+void quarantineLoad(fs::FS &fs);
+
+// True if the file name in the VFS directory dir ("/sd/") is quarantined.
+// A listed name whose file changed or is gone is dropped from the list.
+bool quarantineContains(const char *dir, const char *name);
+
+// Adds a file to the list and appends it to the file on the card
+void quarantineAdd(fs::FS &fs, const char *path, const char *reason);
+
+// Drops a file from the list, e.g. when an upload replaced it, and writes
+// the list back
+void quarantineRemove(fs::FS &fs, const char *path);
+
+// Writes the list back after entries were dropped. Not called during a
+// directory scan, the card file is rewritten.
+void quarantineSave(fs::FS &fs);
+
+// Empties the list and deletes the file on the card
+void quarantineClear(fs::FS &fs);
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Longest file name kept for resuming (FAT long names are cut here)
+#define RESUME_NAME_MAX 96
+
+// The position is written to NVS after this many slides or this long,
+// whichever comes first, so short intervals do not wear the flash
+#define RESUME_SAVE_SLIDES 20
+#define RESUME_SAVE_MS (10 * 60 * 1000UL)
+
+// Slideshow state kept in NVS so a reboot can go straight back to the
+// photo that was on screen, without scanning the card first
+struct ResumeState
+{
+  int file_index;                 // index of the photo on screen
+  char filename[RESUME_NAME_MAX]; // its name, checked against the card at boot
+  int delay_index;                // index into delay_configs
+  int brightness_pct;             // backlight brightness
+  uint32_t dir_fingerprint;       // fingerprint of the card it was taken from
+};
+
+// Opens the NVS namespace, call once during setup
+void resumeBegin();
+
+// Returns false when nothing was saved yet
+bool loadResumeState(ResumeState &state);
+
+// Records the photo on screen, written to NVS as RESUME_SAVE_SLIDES and
+// RESUME_SAVE_MS allow
+void saveResumePosition(int file_index, const char *filename);
+
+// Writes a recorded position that is still pending, e.g. before the
+// display is switched off
+void resumeFlush();
+
+// Writes the settings and any pending position
+void saveResumeSettings(int delay_index, int brightness_pct);
+void saveResumeFingerprint(uint32_t fingerprint);
+
+// FNV-1a over the names of the photos on the card, quarantined ones
+// included, built one name at a time while scanning and stable across
+// reboots. Start from FINGERPRINT_EMPTY.
+#define FINGERPRINT_EMPTY 2166136261u
+uint32_t fingerprintAddName(uint32_t fingerprint, const char *name);
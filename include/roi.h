@@ -0,0 +1,42 @@
+#pragma once
+
+#include <Arduino.h>
+#include "FS.h"
+#include "dither.h"
+
+// Region-of-interest decode for photos larger than the screen.
+//
+// The preparation step writes photos that do not fit the screen with a
+// restart marker after every MCU (jpegtran -restart 1B). roiOpen() walks the
+// file once and records where each restart interval starts. roiDraw() then
+// decodes only the intervals that cover the requested viewport, one MCU row
+// at a time, by streaming the stored headers followed by just those
+// intervals into the ROM tjpgd decoder. Panning costs time proportional to
+// the visible area instead of the whole file.
+
+// Restart intervals that can be indexed. The index takes 4 bytes of heap
+// per interval plus about 2 KB of headers, only while a file is open.
+#define ROI_MAX_INTERVALS 8192
+
+// Registers the block output callback, blocks arrive as byte-swapped RGB565,
+// ordered-dithered from 24-bit when dithered is set
+void roiInit(DitherOutputCallback callback, bool dithered);
+
+// Indexes the restart intervals of a JPEG into memory allocated for it.
+// The index of the open file is kept until roiClose() or the next roiOpen()
+// of another file, so reopening the same file is free. Returns 0 when the
+// file can be drawn with roiDraw(), non-zero for files without restart
+// markers, unsupported frames, too many intervals or too little memory.
+int roiOpen(fs::FS &fs, const char *path);
+
+// Frees the index, once the viewport is left
+void roiClose();
+
+// Size of the image indexed by roiOpen()
+uint16_t roiImageWidth();
+uint16_t roiImageHeight();
+
+// Draws the view_w x view_h region at (view_x, view_y) of the indexed image
+// with its top left corner at (dest_x, dest_y) on screen. Returns 0 on
+// success or a TJpgDec style error code.
+int roiDraw(fs::FS &fs, int32_t view_x, int32_t view_y, uint16_t view_w, uint16_t view_h, int32_t dest_x, int32_t dest_y);
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <Arduino.h>
+#include <TFT_eSPI.h>
+
+// Slide transitions with the hardware vertical scroll of the ST7796.
+//
+// The controller shows its frame memory starting at the line held in the
+// scroll start address register (VSCRSADD) and wraps around at the end of
+// the scroll area (VSCRDEF), so writing one register moves the whole
+// picture. The panel scans along its long axis (Panel::width lines), which
+// is the horizontal axis in the landscape rotation, so photos slide
+// sideways. Controllers of other panel sizes need the same two commands.
+//
+// Column c of the incoming photo is written to the memory line it keeps
+// once the slide is over. Each step moves the start address past the
+// columns of the outgoing photo that just left the screen, then writes the
+// incoming columns into exactly those lines, which now show at the
+// opposite edge. The incoming photo crosses the bus once in total, a strip
+// per step, and the slide ends with the start address back at 0.
+
+#define SCROLL_LEFT 1   // the next photo comes in from the right
+#define SCROLL_RIGHT -1 // the previous photo comes in from the left
+
+// Pushes columns x .. x + w - 1 of the incoming photo to the same columns
+// of the panel
+typedef void (*ScrollColumnsCallback)(int16_t x, int16_t w);
+
+struct ScrollStats
+{
+  uint32_t steps;      // start address changes
+  uint32_t elapsed_ms;
+};
+
+// Makes the full panel width the scroll area, call after setRotation()
+void scrollBegin(TFT_eSPI &tft);
+
+// Slides the incoming photo in over about duration_ms, easing out
+void scrollSlide(int direction, uint32_t duration_ms, ScrollColumnsCallback push, ScrollStats *stats);
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <stdint.h>
+
+// Span tracing: where the time of one particular slide went.
+//
+// Built with SPAN_TRACE (see the esp32dev_spans environment) each SPAN()
+// reads the CPU cycle counter when it is reached and again when the
+// enclosing scope ends, and stores the span in a fixed RAM ring that keeps
+// the last SPAN_RING of them. The ring is printed over serial on request:
+// scripts/spans.sh asks for it with a SPAN_REQUEST frame (include/upload.h
+// framing) and turns it into Chrome trace JSON for a timeline viewer, the
+// latency build prints it for a SPANS line instead.
+//
+// Dump format, one span per line, numbers in hex:
+//   SPANS BEGIN <cpu mhz> <tick hz> <spans listed> <spans recorded>
+//   <core> <end tick> <start cycle> <cycles> <name>
+//   SPANS END
+//
+// Names must be string literals, only the pointer is kept. Without
+// SPAN_TRACE SPAN() expands to nothing.
+
+#define SPAN_REQUEST 0x20 // frame type asking for a dump
+
+#ifdef SPAN_TRACE
+
+#include "hal/cpu_hal.h"
+
+#ifndef SPAN_RING
+#define SPAN_RING 2048 // spans kept, 16 bytes each, a power of two
+#endif
+
+void spanRecord(const char *name, uint32_t start, uint32_t end);
+void spanDump();
+
+class SpanScope
+{
+public:
+  explicit SpanScope(const char *name) : name(name), start(cpu_hal_get_cycle_count()) {}
+  ~SpanScope() { spanRecord(name, start, cpu_hal_get_cycle_count()); }
+
+private:
+  const char *name;
+  uint32_t start;
+};
+
+#define SPAN_JOIN_(a, b) a##b
+#define SPAN_JOIN(a, b) SPAN_JOIN_(a, b)
+#define SPAN(name) SpanScope SPAN_JOIN(span_, __LINE__)(name)
+#else
+#define SPAN(name)
+inline void spanDump() {}
+#endif
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <Arduino.h>
+#include "FS.h"
+
+// Thumbnail file written by scripts/thumbnails.sh
+#define THUMBS_PATH "/thumbs.bin"
+
+#define THUMB_WIDTH 120
+#define THUMB_HEIGHT 80
+#define THUMB_MAX_BYTES 4096 // thumbnails are small baseline JPEGs capped at this size
+#define THUMB_NAME_MAX 56
+#define THUMBS_PER_PAGE 12   // 4 x 3 grid
+
+// File layout (little endian):
+//   header   "THB1", u16 count, u16 width, u16 height, u16 reserved
+//   entries  count x { u32 offset, u32 length, char name[THUMB_NAME_MAX] }
+//   data     the JPEG thumbnails back to back, in entry order
+//
+// Thumbnails of one page are stored next to each other, so a whole page is
+// fetched with one sequential read into a page buffer and decoded from RAM.
+
+// Reads the header, returns false when the card has no thumbnail file
+bool thumbsOpen(fs::FS &fs);
+
+int thumbsCount();
+int thumbsPageCount();
+
+// Loads a page into RAM, returns the number of thumbnails on it or -1
+int thumbsLoadPage(fs::FS &fs, int page);
+
+// JPEG data and photo file name of a thumbnail on the loaded page
+const uint8_t *thumbsData(int slot, uint32_t *size);
+const char *thumbsName(int slot);
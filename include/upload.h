@@ -0,0 +1,185 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Serial upload of photos straight to the SD card.
+//
+// A sender on the host (tools/upload.cpp, see scripts/upload.sh) opens a
+// session with a HELLO frame at the default 115200 baud, carrying the baud
+// it asks for and its clock, which sets the time on the frame. Both ends
+// then switch to the negotiated baud and files are sent one after another:
+//
+//   OPEN   size, CRC-32 and name of the file
+//          -> OPEN_ACK with the offset to start from, non-zero when an
+//             interrupted upload of the same file is resumed
+//   DATA   offset and up to UPLOAD_CHUNK bytes, optionally LZ compressed.
+//          Up to UPLOAD_WINDOW frames are in flight; every frame that
+//          continues the file is written and acknowledged with the next
+//          offset, anything else is answered with a NAK carrying the
+//          expected offset and the sender goes back to it
+//   CLOSE  -> CLOSE_ACK once the CRC of the whole file is checked and it
+//          has replaced any file of the same name
+//   BYE    -> BYE_ACK, back to 115200
+//
+// Frames are 0xA5 0x5A, type, payload length (u16), payload, CRC-32 of
+// type, length and payload (u32), little endian. Bytes outside valid frames
+// are skipped, so a frame is found again after noise or a lost byte.
+//
+// Data is written to UPLOAD_PART_PATH next to UPLOAD_META_PATH, which holds
+// the size, CRC and name of the file. Both are hidden from the slideshow.
+// If the session ends before CLOSE, the next OPEN of the same file resumes
+// after the bytes already on the card.
+//
+// The receiver has no Arduino dependencies: the serial port, the clock and
+// the card are reached through UploadIo, so the whole protocol also runs on
+// the host against a directory (tools/upload_rx.cpp).
+
+#define UPLOAD_CHUNK 1024           // largest DATA payload after the offset
+#define UPLOAD_WINDOW 8             // DATA frames in flight
+#define UPLOAD_DEFAULT_BAUD 115200
+#define UPLOAD_MAX_BAUD 921600      // highest baud the receiver accepts
+#define UPLOAD_IDLE_TIMEOUT 5000    // session ends after this long without a frame (ms)
+#define UPLOAD_NAME_MAX 64
+#define UPLOAD_MAX_FRAME (UPLOAD_CHUNK + 64)
+
+// HELLO payload: requested baud (u32), then the host clock as UTC seconds
+// (u32) and the offset of its local time from UTC in seconds (i32). Senders
+// that leave the clock out are still accepted.
+#define UPLOAD_HELLO_LENGTH 4
+#define UPLOAD_HELLO_CLOCK_LENGTH 12
+
+#define UPLOAD_PART_PATH "/.upload.part"
+#define UPLOAD_META_PATH "/.upload"
+
+enum UploadFrameType
+{
+  UPLOAD_HELLO = 0x01,
+  UPLOAD_PING = 0x02,
+  UPLOAD_OPEN = 0x03,
+  UPLOAD_DATA = 0x04,
+  UPLOAD_CLOSE = 0x05,
+  UPLOAD_BYE = 0x06,
+  UPLOAD_HELLO_ACK = 0x81,
+  UPLOAD_PONG = 0x82,
+  UPLOAD_OPEN_ACK = 0x83,
+  UPLOAD_ACK = 0x84,
+  UPLOAD_NAK = 0x85,
+  UPLOAD_CLOSE_ACK = 0x86,
+  UPLOAD_BYE_ACK = 0x87,
+  UPLOAD_ERROR = 0xEE,
+};
+
+#define UPLOAD_DATA_COMPRESSED 0x01 // DATA flag
+
+// CLOSE_ACK and ERROR status
+#define UPLOAD_STATUS_OK 0
+#define UPLOAD_STATUS_CRC 1     // file CRC does not match, the upload starts over
+#define UPLOAD_STATUS_STORAGE 2 // the card could not be written
+#define UPLOAD_STATUS_NAME 3    // file name rejected
+#define UPLOAD_STATUS_STATE 4   // frame not expected at this point
+
+// Session events reported to UploadIo::event
+#define UPLOAD_EVENT_START 0    // session accepted, before HELLO_ACK and the baud switch
+#define UPLOAD_EVENT_PROGRESS 1 // name, bytes done and total of the current file
+#define UPLOAD_EVENT_END 2      // session over, the port is back at 115200
+
+struct UploadIo
+{
+  void *context;
+
+  // Serial port: non-blocking read of what has arrived, blocking write
+  size_t (*read)(void *context, uint8_t *buffer, size_t length);
+  void (*write)(void *context, const uint8_t *data, size_t length);
+  void (*set_baud)(void *context, uint32_t baud); // waits for pending output first
+  uint32_t (*millis)(void *context);
+
+  // Card: mode is "r", "w" or "a"; size returns -1 for a missing file
+  void *(*open)(void *context, const char *path, const char *mode);
+  size_t (*file_read)(void *context, void *file, uint8_t *buffer, size_t length);
+  size_t (*file_write)(void *context, void *file, const uint8_t *data, size_t length);
+  void (*close)(void *context, void *file);
+  long (*size)(void *context, const char *path);
+  bool (*remove)(void *context, const char *path);
+  bool (*rename)(void *context, const char *from, const char *to);
+
+  // Optional, may be null
+  void (*event)(void *context, int event, const char *name, uint32_t done, uint32_t total);
+
+  // Optional: valid frames other than HELLO seen outside a session, so other
+  // protocols on the same framing (live mode, include/live.h) can start theirs
+  void (*frame)(void *context, uint8_t type, const uint8_t *payload, size_t length);
+
+  // Optional: the host clock from a HELLO that carries one
+  void (*set_clock)(void *context, uint32_t utc, int32_t utc_offset);
+};
+
+struct UploadStats
+{
+  int files;          // files completed
+  uint32_t bytes;     // file bytes received, after decompression
+  uint32_t wire_bytes; // bytes read from the port
+  uint32_t elapsed_ms;
+  uint32_t baud;
+};
+
+// Feeds what has arrived on the port to the frame parser. When a HELLO
+// frame is found the whole session runs before returning true, with the
+// totals in stats. Returns false right away otherwise, after handing any
+// other frame to io.frame.
+bool uploadPoll(const UploadIo &io, UploadStats *stats);
+
+// ====== SHARED WITH THE SENDER ======
+
+uint32_t uploadCrc32(uint32_t crc, const uint8_t *data, size_t length);
+
+// Writes a complete frame into out (UPLOAD_MAX_FRAME bytes), returns its size
+size_t uploadEncodeFrame(uint8_t type, const uint8_t *payload, size_t length, uint8_t *out);
+
+// Byte-at-a-time frame parser
+struct UploadParser
+{
+  uint8_t frame[UPLOAD_MAX_FRAME];
+  size_t length;
+  uint8_t type;
+  uint16_t payload_length;
+  const uint8_t *payload; // valid after uploadParse() returned true
+  uint32_t crc_errors;
+};
+
+void uploadParserReset(UploadParser &parser);
+
+// Returns true when byte completes a frame with a valid CRC
+bool uploadParse(UploadParser &parser, uint8_t byte);
+
+// Simple LZ77 for DATA payloads, returns the compressed size or 0 when the
+// data does not get smaller
+size_t uploadCompress(const uint8_t *data, size_t length, uint8_t *out, size_t out_length);
+
+// Returns the decompressed size, or 0 when the input is malformed or would
+// not fit in out_length
+size_t uploadDecompress(const uint8_t *data, size_t length, uint8_t *out, size_t out_length);
+
+static inline void uploadPut16(uint8_t *p, uint16_t v)
+{
+  p[0] = v;
+  p[1] = v >> 8;
+}
+
+static inline void uploadPut32(uint8_t *p, uint32_t v)
+{
+  p[0] = v;
+  p[1] = v >> 8;
+  p[2] = v >> 16;
+  p[3] = v >> 24;
+}
+
+static inline uint16_t uploadGet16(const uint8_t *p)
+{
+  return p[0] | (p[1] << 8);
+}
+
+static inline uint32_t uploadGet32(const uint8_t *p)
+{
+  return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
@@ -0,0 +1,128 @@
+#!/bin/bash
+
+# Script to build the built-in album image for the "album" flash partition
+# Writes assets/album.bin from the .jpg files in assets/target and, when a
+# serial port is given, writes it to the frame with esptool.py
+# Usage: album.sh [serial port]
+
+# Color codes for output
+RED='\033[0;31m'
+GREEN='\033[0;32m'
+YELLOW='\033[1;33m'
+NC='\033[0m' # No Color
+
+# Get the script's directory and project root
+SCRIPT_DIR="$(cd "$(dirname "${BASH_SOURCE[0]}")" && pwd)"
+PROJECT_ROOT="$(dirname "$SCRIPT_DIR")"
+
+# Define source directory and output file
+TARGET_DIR="$PROJECT_ROOT/assets/target"
+ALBUM_FILE="$PROJECT_ROOT/assets/album.bin"
+PORT="$1"
+
+# Album partition and format, must match partitions.csv and include/album.h
+ALBUM_OFFSET=0x190000
+ALBUM_SIZE=$((0x260000))
+ALBUM_NAME_MAX=56
+
+echo "Photo Frame Album Builder"
+echo "========================="
+echo ""
+
+# Check if target directory exists
+if [ ! -d "$TARGET_DIR" ]; then
+    echo -e "${RED}Error: Target directory not found: $TARGET_DIR${NC}"
+    echo "Please run prepare.sh first to generate images."
+    exit 1
+fi
+
+shopt -s nullglob nocaseglob
+JPG_FILES=("$TARGET_DIR"/*.jpg)
+shopt -u nullglob nocaseglob
+
+if [ ${#JPG_FILES[@]} -eq 0 ]; then
+    echo -e "${YELLOW}No .jpg files found in $TARGET_DIR${NC}"
+    echo "Please run prepare.sh first to generate images."
+    exit 0
+fi
+
+# Little endian integer writers
+u16le() {
+    printf "\\x$(printf %02x $(($1 & 0xFF)))\\x$(printf %02x $((($1 >> 8) & 0xFF)))"
+}
+
+u32le() {
+    u16le $(($1 & 0xFFFF))
+    u16le $((($1 >> 16) & 0xFFFF))
+}
+
+# Pick photos in order until the partition is full
+ENTRY_SIZE=$((8 + ALBUM_NAME_MAX))
+PHOTOS=()
+TOTAL=0
+for img in "${JPG_FILES[@]}"; do
+    name=$(basename "$img")
+    if [ ${#name} -gt $ALBUM_NAME_MAX ]; then
+        echo -e "  ${YELLOW}! Skipped (name too long): $name${NC}"
+        continue
+    fi
+
+    length=$(wc -c < "$img" | tr -d ' ')
+    if [ $((8 + (${#PHOTOS[@]} + 1) * ENTRY_SIZE + TOTAL + length)) -gt $ALBUM_SIZE ]; then
+        echo -e "  ${YELLOW}! Album partition full, stopping at ${#PHOTOS[@]} photo(s)${NC}"
+        break
+    fi
+
+    PHOTOS+=("$img")
+    TOTAL=$((TOTAL + length))
+done
+
+COUNT=${#PHOTOS[@]}
+echo "Packing $COUNT photo(s), $((TOTAL / 1024)) KB..."
+
+# Header, entry table, then the photos back to back
+offset=$((8 + COUNT * ENTRY_SIZE))
+
+{
+    printf "ALB1"
+    u16le $COUNT
+    u16le 0
+
+    for img in "${PHOTOS[@]}"; do
+        name=$(basename "$img")
+        length=$(wc -c < "$img" | tr -d ' ')
+
+        u32le $offset
+        u32le $length
+        printf "%s" "$name"
+        head -c $((ALBUM_NAME_MAX - ${#name})) /dev/zero
+
+        offset=$((offset + length))
+    done
+
+    for img in "${PHOTOS[@]}"; do
+        cat "$img"
+    done
+} > "$ALBUM_FILE"
+
+echo ""
+echo "========================="
+echo -e "${GREEN}Successfully created album with $COUNT photo(s)!${NC}"
+echo ""
+echo "Album image saved to: $ALBUM_FILE"
+
+if [ -z "$PORT" ]; then
+    echo "Write it to the frame with:"
+    echo "  esptool.py --chip esp32 write_flash $ALBUM_OFFSET $ALBUM_FILE"
+    exit 0
+fi
+
+if ! command -v esptool.py &> /dev/null; then
+    echo -e "${RED}Error: 'esptool.py' command not found.${NC}"
+    echo "Install it with 'pip install esptool' or run it from PlatformIO."
+    exit 1
+fi
+
+echo ""
+echo -e "${YELLOW}Writing album to $PORT at $ALBUM_OFFSET...${NC}"
+esptool.py --chip esp32 --port "$PORT" write_flash $ALBUM_OFFSET "$ALBUM_FILE"
@@ -0,0 +1,115 @@
+#!/bin/bash
+
+# Script to convert a video or animated GIF into a motion clip (.mjpg)
+# for the photo frame: baseline JPEG frames behind a small frame index
+# Usage: clip.sh <input> [output.mjpg]
+#   CLIP_SIZE=240x160|480x320  frame size (default 240x160)
+#   CLIP_FPS=15                frame rate
+#   CLIP_SECONDS=10            maximum length
+
+# Color codes for output
+RED='\033[0;31m'
+GREEN='\033[0;32m'
+YELLOW='\033[1;33m'
+NC='\033[0m' # No Color
+
+# Get the script's directory and project root
+SCRIPT_DIR="$(cd "$(dirname "${BASH_SOURCE[0]}")" && pwd)"
+PROJECT_ROOT="$(dirname "$SCRIPT_DIR")"
+
+INPUT="$1"
+OUTPUT="${2:-$PROJECT_ROOT/assets/target/$(basename "${INPUT%.*}").mjpg}"
+
+CLIP_SIZE="${CLIP_SIZE:-240x160}"
+CLIP_FPS="${CLIP_FPS:-15}"
+CLIP_SECONDS="${CLIP_SECONDS:-10}"
+
+# Clip format limits, must match include/clip.h
+CLIP_MAX_FRAMES=1024
+CLIP_FRAME_MAX=65536
+
+if [ -z "$INPUT" ] || [ ! -f "$INPUT" ]; then
+    echo -e "${RED}Error: Input file not found: $INPUT${NC}"
+    echo "Usage: $0 <input> [output.mjpg]"
+    exit 1
+fi
+
+# Half screen clips play at higher frame rates, full screen clips look sharper
+if [ "$CLIP_SIZE" != "240x160" ] && [ "$CLIP_SIZE" != "480x320" ]; then
+    echo -e "${RED}Error: CLIP_SIZE must be 240x160 or 480x320${NC}"
+    exit 1
+fi
+
+if [ $((CLIP_FPS * CLIP_SECONDS)) -gt $CLIP_MAX_FRAMES ]; then
+    echo -e "${RED}Error: CLIP_FPS x CLIP_SECONDS must not exceed $CLIP_MAX_FRAMES frames${NC}"
+    exit 1
+fi
+
+# Check if ffmpeg command exists
+if ! command -v ffmpeg &> /dev/null; then
+    echo -e "${RED}Error: 'ffmpeg' command not found.${NC}"
+    echo "Please install ffmpeg to create clips."
+    exit 1
+fi
+
+CLIP_WIDTH=${CLIP_SIZE%x*}
+CLIP_HEIGHT=${CLIP_SIZE#*x}
+
+# Little endian integer writers
+u16le() {
+    printf "\\x$(printf %02x $(($1 & 0xFF)))\\x$(printf %02x $((($1 >> 8) & 0xFF)))"
+}
+
+u32le() {
+    u16le $(($1 & 0xFFFF))
+    u16le $((($1 >> 16) & 0xFFFF))
+}
+
+TEMP_DIR="$(mktemp -d)"
+trap 'rm -rf "$TEMP_DIR"' EXIT
+
+# Letterboxed to exactly the clip size, baseline 4:2:0 frames
+if ! ffmpeg -loglevel error -i "$INPUT" -t "$CLIP_SECONDS" \
+    -vf "fps=$CLIP_FPS,scale=$CLIP_WIDTH:$CLIP_HEIGHT:force_original_aspect_ratio=decrease,pad=$CLIP_WIDTH:$CLIP_HEIGHT:(ow-iw)/2:(oh-ih)/2" \
+    -pix_fmt yuvj420p -q:v 5 "$TEMP_DIR/%05d.jpg"; then
+    echo -e "${RED}✗ Failed to extract frames from $INPUT${NC}"
+    exit 1
+fi
+
+shopt -s nullglob
+FRAMES=("$TEMP_DIR"/*.jpg)
+shopt -u nullglob
+COUNT=${#FRAMES[@]}
+
+if [ $COUNT -eq 0 ]; then
+    echo -e "${RED}✗ No frames extracted from $INPUT${NC}"
+    exit 1
+fi
+
+for frame in "${FRAMES[@]}"; do
+    if [ "$(wc -c < "$frame" | tr -d ' ')" -gt $CLIP_FRAME_MAX ]; then
+        echo -e "${RED}✗ A frame is larger than $CLIP_FRAME_MAX bytes, lower the quality or the size${NC}"
+        exit 1
+    fi
+done
+
+# Header, frame index with the end of the data as last entry, then the frames
+offset=$((12 + (COUNT + 1) * 4))
+
+{
+    printf "MJP1"
+    u16le $CLIP_WIDTH
+    u16le $CLIP_HEIGHT
+    u16le $CLIP_FPS
+    u16le $COUNT
+
+    for frame in "${FRAMES[@]}"; do
+        u32le $offset
+        offset=$((offset + $(wc -c < "$frame" | tr -d ' ')))
+    done
+    u32le $offset
+
+    cat "${FRAMES[@]}"
+} > "$OUTPUT"
+
+echo -e "${GREEN}✓ $(basename "$OUTPUT")${NC} ($COUNT frames, ${CLIP_SIZE} at ${CLIP_FPS} fps, $((offset / 1024)) KB)"
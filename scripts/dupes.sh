@@ -0,0 +1,127 @@
+#!/bin/bash
+
+# Script to find near-duplicate photos (burst shots, re-exports) in assets/target
+# Hashes every .jpg with tools/dupes.cpp, clusters similar ones, then either
+# spaces them out in the display order or removes all but one of each cluster
+# Usage: dupes.sh
+#   DUPES_MODE=spread  rename photos so members of a cluster are DUPES_GAP slides apart (default)
+#   DUPES_MODE=drop    delete all but the largest file of each cluster
+#   DUPES_DISTANCE=8   hash bits two photos may differ in and still count as duplicates (0-10)
+#   DUPES_GAP=20       slides between photos of one cluster in spread mode
+
+# Color codes for output
+RED='\033[0;31m'
+GREEN='\033[0;32m'
+YELLOW='\033[1;33m'
+NC='\033[0m' # No Color
+
+# Get the script's directory and project root
+SCRIPT_DIR="$(cd "$(dirname "${BASH_SOURCE[0]}")" && pwd)"
+PROJECT_ROOT="$(dirname "$SCRIPT_DIR")"
+
+TARGET_DIR="$PROJECT_ROOT/assets/target"
+
+DUPES_MODE="${DUPES_MODE:-spread}"
+DUPES_DISTANCE="${DUPES_DISTANCE:-8}"
+DUPES_GAP="${DUPES_GAP:-20}"
+
+echo "Photo Frame Duplicate Finder"
+echo "============================"
+echo ""
+
+if ! command -v g++ &> /dev/null; then
+    echo -e "${RED}Error: 'g++' command not found.${NC}"
+    echo "Please install a host C++ compiler to find duplicates."
+    exit 1
+fi
+
+if [ "$DUPES_MODE" != "spread" ] && [ "$DUPES_MODE" != "drop" ]; then
+    echo -e "${RED}Error: DUPES_MODE must be spread or drop${NC}"
+    exit 1
+fi
+
+if [ ! -d "$TARGET_DIR" ]; then
+    echo -e "${RED}Error: Target directory not found: $TARGET_DIR${NC}"
+    exit 1
+fi
+
+# The frame shows photos in file name order
+shopt -s nullglob nocaseglob
+JPG_FILES=("$TARGET_DIR"/*.jpg)
+shopt -u nullglob nocaseglob
+
+if [ ${#JPG_FILES[@]} -lt 2 ]; then
+    echo -e "${YELLOW}Fewer than two .jpg files in $TARGET_DIR, nothing to compare${NC}"
+    exit 0
+fi
+
+BUILD_DIR="$(mktemp -d)"
+trap 'rm -rf "$BUILD_DIR"' EXIT
+
+g++ -O3 -march=native -std=gnu++17 -I"$PROJECT_ROOT/include" \
+    "$PROJECT_ROOT/tools/dupes.cpp" "$PROJECT_ROOT/src/fastjpeg.cpp" -o "$BUILD_DIR/dupes" || exit 1
+
+# Hash on every core, in batches of 256 files per process
+JOBS=$(getconf _NPROCESSORS_ONLN 2>/dev/null || echo 4)
+echo "Hashing ${#JPG_FILES[@]} photo(s) on $JOBS core(s)..."
+
+started_at=$(date +%s%N)
+printf '%s\0' "${JPG_FILES[@]}" | xargs -0 -P "$JOBS" -n 256 "$BUILD_DIR/dupes" hash > "$BUILD_DIR/hashes.txt"
+elapsed_ms=$((($(date +%s%N) - started_at) / 1000000))
+
+HASHED=$(wc -l < "$BUILD_DIR/hashes.txt")
+echo -e "${GREEN}✓ Hashed $HASHED photo(s) in ${elapsed_ms} ms ($((HASHED * 1000 / (elapsed_ms > 0 ? elapsed_ms : 1))) images/s)${NC}"
+echo ""
+
+# Back in display order before clustering
+LC_ALL=C sort -k2 "$BUILD_DIR/hashes.txt" > "$BUILD_DIR/sorted.txt"
+"$BUILD_DIR/dupes" cluster "$DUPES_DISTANCE" "$DUPES_MODE" "$DUPES_GAP" < "$BUILD_DIR/sorted.txt" > "$BUILD_DIR/plan.txt" || exit 1
+echo ""
+
+if [ "$DUPES_MODE" = "drop" ]; then
+    DROPPED=0
+    while IFS= read -r img; do
+        rm -f "$img"
+        echo -e "  ${YELLOW}✗${NC} Removed: $(basename "$img")"
+        ((DROPPED++))
+    done < "$BUILD_DIR/plan.txt"
+
+    echo ""
+    echo "============================"
+    echo -e "${GREEN}Removed $DROPPED near-duplicate(s)${NC}"
+    exit 0
+fi
+
+# Photos that could not be hashed keep their place at the end
+printf '%s\n' "${JPG_FILES[@]}" | LC_ALL=C sort > "$BUILD_DIR/all.txt"
+cut -d' ' -f2- "$BUILD_DIR/sorted.txt" > "$BUILD_DIR/hashed.txt"
+LC_ALL=C comm -23 "$BUILD_DIR/all.txt" "$BUILD_DIR/hashed.txt" >> "$BUILD_DIR/plan.txt"
+
+# Spread: rename in the new order, through a temporary directory so names do not collide
+TEMP_DIR="$TARGET_DIR/.temp_dupes_$$"
+mkdir -p "$TEMP_DIR"
+
+COUNTER=1
+while IFS= read -r img; do
+    if ! mv "$img" "$TEMP_DIR/$(printf "%06d" $COUNTER).jpg"; then
+        echo -e "${RED}Error: could not move $img, the photos moved so far are in $TEMP_DIR${NC}"
+        exit 1
+    fi
+    ((COUNTER++))
+done < "$BUILD_DIR/plan.txt"
+
+# Same name width as randomize.sh while it fits
+TOTAL=$((COUNTER - 1))
+WIDTH=${#TOTAL}
+[ "$WIDTH" -lt 3 ] && WIDTH=3
+
+for ((i = 1; i <= TOTAL; i++)); do
+    if ! mv "$TEMP_DIR/$(printf "%06d" $i).jpg" "$TARGET_DIR/$(printf "%0${WIDTH}d" $i).jpg"; then
+        echo -e "${RED}Error: could not rename photo $i, the rest are still in $TEMP_DIR${NC}"
+        exit 1
+    fi
+done
+rmdir "$TEMP_DIR"
+
+echo "============================"
+echo -e "${GREEN}Reordered $TOTAL photo(s), duplicates spaced $DUPES_GAP slides apart${NC}"
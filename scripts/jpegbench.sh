@@ -0,0 +1,63 @@
+#!/bin/bash
+
+# Script to build and run the host JPEG decoder benchmark
+# Compares the fast decoder (src/fastjpeg.cpp) with TJpg_Decoder's tjpgd
+# core on assets/example, or on the .jpg files given as arguments
+# Usage: jpegbench.sh [file.jpg...]
+
+# Color codes for output
+RED='\033[0;31m'
+GREEN='\033[0;32m'
+YELLOW='\033[1;33m'
+NC='\033[0m' # No Color
+
+# Get the script's directory and project root
+SCRIPT_DIR="$(cd "$(dirname "${BASH_SOURCE[0]}")" && pwd)"
+PROJECT_ROOT="$(dirname "$SCRIPT_DIR")"
+
+# TJpg_Decoder is fetched by PlatformIO on the first build
+TJPGD_DIR="${TJPGD_DIR:-$PROJECT_ROOT/.pio/libdeps/esp32dev/TJpg_Decoder/src}"
+
+echo "Photo Frame JPEG Decoder Benchmark"
+echo "=================================="
+echo ""
+
+if ! command -v g++ &> /dev/null; then
+    echo -e "${RED}Error: 'g++' command not found.${NC}"
+    echo "Please install a host C++ compiler to run the benchmark."
+    exit 1
+fi
+
+if [ $# -gt 0 ]; then
+    FILES=("$@")
+else
+    FILES=("$PROJECT_ROOT"/assets/example/*.jpg)
+fi
+
+BUILD_DIR="$(mktemp -d)"
+trap 'rm -rf "$BUILD_DIR"' EXIT
+
+SOURCES=("$PROJECT_ROOT/tools/jpegbench.cpp" "$PROJECT_ROOT/src/fastjpeg.cpp")
+FLAGS=(-O2 -std=gnu++17 -I"$PROJECT_ROOT/include")
+
+if [ -f "$TJPGD_DIR/tjpgd.c" ]; then
+    echo -e "${GREEN}✓ TJpg_Decoder found: $TJPGD_DIR${NC}"
+    gcc -O2 -c "$TJPGD_DIR/tjpgd.c" -I"$TJPGD_DIR" -o "$BUILD_DIR/tjpgd.o" || exit 1
+    SOURCES+=("$BUILD_DIR/tjpgd.o")
+    FLAGS+=(-DWITH_TJPGD -I"$TJPGD_DIR")
+else
+    echo -e "${YELLOW}! TJpg_Decoder not found, timing the fast decoder alone${NC}"
+    echo "  Run 'pio run' once so PlatformIO fetches it, or set TJPGD_DIR"
+fi
+echo ""
+
+g++ "${FLAGS[@]}" "${SOURCES[@]}" -lm -o "$BUILD_DIR/jpegbench" || exit 1
+
+if "$BUILD_DIR/jpegbench" "${FILES[@]}"; then
+    echo ""
+    echo -e "${GREEN}✓ All images decoded within tolerance${NC}"
+else
+    echo ""
+    echo -e "${RED}✗ Decode errors or PSNR below threshold${NC}"
+    exit 1
+fi
@@ -0,0 +1,92 @@
+#!/bin/bash
+
+# Script to stream images to the frame's live mode over USB serial
+# Builds the host sender (tools/live.cpp) and replays a directory of JPEGs
+# (assets/example by default) on the panel, sending only the tiles that
+# changed from one frame to the next, then prints the frames per second,
+# link use and end-to-end latency achieved
+# Usage: live.sh <port> [directory|file.jpg...]
+#   LIVE_BAUD=921600  session baud
+#   LIVE_TILE=32      tile width and height, 16 to 64
+#   LIVE_FORMAT=auto  rle, jpeg or auto (JPEG needs libjpeg, else rle)
+#   LIVE_FPS=0        take frames at this rate, 0 for as fast as the link allows
+#   LIVE_LOOPS=1      play the images this many times
+
+# Color codes for output
+RED='\033[0;31m'
+GREEN='\033[0;32m'
+YELLOW='\033[1;33m'
+NC='\033[0m' # No Color
+
+# Get the script's directory and project root
+SCRIPT_DIR="$(cd "$(dirname "${BASH_SOURCE[0]}")" && pwd)"
+PROJECT_ROOT="$(dirname "$SCRIPT_DIR")"
+
+LIVE_BAUD="${LIVE_BAUD:-921600}"
+LIVE_TILE="${LIVE_TILE:-32}"
+LIVE_FORMAT="${LIVE_FORMAT:-auto}"
+LIVE_FPS="${LIVE_FPS:-0}"
+LIVE_LOOPS="${LIVE_LOOPS:-1}"
+
+echo "Photo Frame Live Mode"
+echo "====================="
+echo ""
+
+if [ $# -lt 1 ]; then
+    echo "Usage: $0 <port> [directory|file.jpg...]"
+    echo "  e.g. $0 /dev/ttyUSB0 assets/target"
+    exit 1
+fi
+
+if ! command -v g++ &> /dev/null; then
+    echo -e "${RED}Error: 'g++' command not found.${NC}"
+    echo "Please install a host C++ compiler to build the sender."
+    exit 1
+fi
+
+PORT="$1"
+shift
+if [ $# -gt 0 ]; then
+    SOURCES=("$@")
+else
+    SOURCES=("$PROJECT_ROOT/assets/example")
+fi
+
+if [ ! -e "$PORT" ]; then
+    echo -e "${RED}Error: Port '$PORT' does not exist.${NC}"
+    exit 1
+fi
+
+BUILD_DIR="$(mktemp -d)"
+trap 'rm -rf "$BUILD_DIR"' EXIT
+
+SOURCES_CPP=("$PROJECT_ROOT/tools/live.cpp" "$PROJECT_ROOT/src/live.cpp" "$PROJECT_ROOT/src/upload.cpp"
+    "$PROJECT_ROOT/src/fastjpeg.cpp")
+FLAGS=(-O2 -std=gnu++17 -I"$PROJECT_ROOT/include")
+LIBS=()
+
+# JPEG tiles need an encoder on the host
+if echo '#include <stdio.h>
+#include <jpeglib.h>
+int main() { return 0; }' | g++ -x c++ - -ljpeg -o "$BUILD_DIR/probe" &> /dev/null; then
+    echo -e "${GREEN}✓ libjpeg found, JPEG tiles available${NC}"
+    FLAGS+=(-DWITH_LIBJPEG)
+    LIBS+=(-ljpeg)
+else
+    echo -e "${YELLOW}! libjpeg not found, sending RLE tiles only${NC}"
+    echo "  Install libjpeg development files (e.g. libjpeg-dev) for JPEG tiles"
+    LIVE_FORMAT=rle
+fi
+echo ""
+
+g++ "${FLAGS[@]}" "${SOURCES_CPP[@]}" "${LIBS[@]}" -o "$BUILD_DIR/live" || exit 1
+
+if "$BUILD_DIR/live" -b "$LIVE_BAUD" -t "$LIVE_TILE" -f "$LIVE_FORMAT" --fps "$LIVE_FPS" --loops "$LIVE_LOOPS" \
+    "$PORT" "${SOURCES[@]}"; then
+    echo ""
+    echo -e "${GREEN}✓ Replay complete, the frame returns to the slideshow${NC}"
+else
+    echo ""
+    echo -e "${RED}✗ Live session failed${NC}"
+    exit 1
+fi
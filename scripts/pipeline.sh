@@ -1,7 +1,7 @@
 #!/bin/bash
 
 # Pipeline script to prepare and randomize images
-# This script combines prepare.sh and randomize.sh into one workflow
+# This script combines prepare.sh, randomize.sh, dupes.sh and thumbnails.sh into one workflow
 
 # Color codes for output
 RED='\033[0;31m'
@@ -18,6 +18,8 @@ echo ""
 echo "This pipeline will:"
 echo "  1. Prepare images (resize from assets/root to assets/target)"
 echo "  2. Randomize image filenames"
+echo "  3. Space out near-duplicate photos (DUPES_MODE=drop removes them)"
+echo "  4. Build the gallery thumbnail file"
 echo ""
 
 # Step 1: Run prepare.sh
@@ -50,6 +52,36 @@ else
     exit 1
 fi
 
+# Step 3: Run dupes.sh (after randomize, it reorders the shuffled names)
+echo -e "${YELLOW}Step 3: Running dupes.sh...${NC}"
+echo ""
+
+if bash "$SCRIPT_DIR/dupes.sh"; then
+    echo ""
+    echo -e "${GREEN}✓ Duplicates step completed successfully${NC}"
+    echo ""
+else
+    echo ""
+    echo -e "${RED}✗ Duplicates step failed${NC}"
+    echo "Pipeline aborted."
+    exit 1
+fi
+
+# Step 4: Run thumbnails.sh (after renaming, thumbnails are looked up by file name)
+echo -e "${YELLOW}Step 4: Running thumbnails.sh...${NC}"
+echo ""
+
+if bash "$SCRIPT_DIR/thumbnails.sh"; then
+    echo ""
+    echo -e "${GREEN}✓ Thumbnails step completed successfully${NC}"
+    echo ""
+else
+    echo ""
+    echo -e "${RED}✗ Thumbnails step failed${NC}"
+    echo "Pipeline aborted."
+    exit 1
+fi
+
 # Pipeline complete
 echo "===================="
 echo -e "${GREEN}Pipeline completed successfully!${NC}"
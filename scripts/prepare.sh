@@ -2,6 +2,9 @@
 
 # Script to resize images from assets/root to assets/target
 # Target resolution: 480x320 (keeping aspect ratio)
+#   PANEL_SIZE=320x240|800x480  for firmware built for another panel size
+# Panoramas keep the full screen height and can be panned on the device
+# Videos become motion clips (.mjpg) through clip.sh
 
 # Color codes for output
 RED='\033[0;31m'
@@ -17,11 +20,25 @@ PROJECT_ROOT="$(dirname "$SCRIPT_DIR")"
 SOURCE_DIR="$PROJECT_ROOT/assets/root"
 TARGET_DIR="$PROJECT_ROOT/assets/target"
 
-# Target resolution
-TARGET_WIDTH=480
-TARGET_HEIGHT=320
+# Target resolution, the panel size the firmware was built for
+PANEL_SIZE="${PANEL_SIZE:-480x320}"
+if [[ ! "$PANEL_SIZE" =~ ^[0-9]+x[0-9]+$ ]]; then
+    echo -e "${RED}Error: PANEL_SIZE must look like 480x320${NC}"
+    exit 1
+fi
+TARGET_WIDTH="${PANEL_SIZE%x*}"
+TARGET_HEIGHT="${PANEL_SIZE#*x}"
 TARGET_RESOLUTION="${TARGET_WIDTH}x${TARGET_HEIGHT}"
 
+# Photos at least this many times wider than tall are kept as panoramas:
+# screen height, width up to PANORAMA_MAX_WIDTH
+PANORAMA_RATIO=2
+PANORAMA_MAX_WIDTH=3840
+
+# ZOOM=2 keeps regular photos at twice the screen size so they can be
+# zoomed into on the device (long press in the center)
+ZOOM="${ZOOM:-1}"
+
 echo "Photo Frame Image Preparation Script"
 echo "====================================="
 echo ""
@@ -39,6 +56,16 @@ if ! command -v magick &> /dev/null; then
 fi
 
 echo -e "${GREEN}✓ ImageMagick found${NC}"
+
+# jpegtran adds the restart markers the device needs to pan large photos
+if command -v jpegtran &> /dev/null; then
+    HAS_JPEGTRAN=1
+    echo -e "${GREEN}✓ jpegtran found${NC}"
+else
+    HAS_JPEGTRAN=0
+    echo -e "${YELLOW}! jpegtran not found, panoramas and zoomed photos will not be pannable${NC}"
+    echo "  Install libjpeg-turbo (macOS: brew install jpeg-turbo, Ubuntu: sudo apt-get install libjpeg-turbo-progs)"
+fi
 echo ""
 
 # Check if source directory exists
@@ -66,12 +93,15 @@ IMAGE_FILES=("$SOURCE_DIR"/*.jpg "$SOURCE_DIR"/*.jpeg "$SOURCE_DIR"/*.png \
              "$SOURCE_DIR"/*.gif "$SOURCE_DIR"/*.bmp "$SOURCE_DIR"/*.tiff \
              "$SOURCE_DIR"/*.tif "$SOURCE_DIR"/*.webp "$SOURCE_DIR"/*.heic \
              "$SOURCE_DIR"/*.heif)
+VIDEO_FILES=("$SOURCE_DIR"/*.mp4 "$SOURCE_DIR"/*.mov "$SOURCE_DIR"/*.webm \
+             "$SOURCE_DIR"/*.mkv "$SOURCE_DIR"/*.avi)
 shopt -u nullglob nocaseglob
 
 # Check if any images were found
-if [ ${#IMAGE_FILES[@]} -eq 0 ]; then
+if [ ${#IMAGE_FILES[@]} -eq 0 ] && [ ${#VIDEO_FILES[@]} -eq 0 ]; then
     echo -e "${YELLOW}No image files found in $SOURCE_DIR${NC}"
     echo "Supported formats: jpg, jpeg, png, gif, bmp, tiff, tif, webp, heic, heif"
+    echo "Videos (mp4, mov, webm, mkv, avi) are converted to motion clips"
     echo "Please add some images to the assets/root directory."
     exit 0
 fi
@@ -93,14 +123,41 @@ for img in "${IMAGE_FILES[@]}"; do
     target_path="$TARGET_DIR/${filename_no_ext}.jpg"
     
     echo -n "Processing: $filename ... "
-    
+
+    # Size as displayed, after applying the EXIF rotation
+    read -r src_width src_height < <(magick "${img}[0]" -auto-orient -format "%w %h" info: 2>/dev/null)
+
+    if [ -n "$src_width" ] && [ "$src_width" -ge $((src_height * PANORAMA_RATIO)) ]; then
+        resize_box="${PANORAMA_MAX_WIDTH}x${TARGET_HEIGHT}"
+        kind="panorama"
+    else
+        resize_box="$((TARGET_WIDTH * ZOOM))x$((TARGET_HEIGHT * ZOOM))"
+        kind="photo"
+    fi
+
+    # Quality 100 would keep full chroma (4:4:4, 8x8 MCUs). Photos that can
+    # end up larger than the screen use 4:2:0 instead: 16x16 MCUs keep their
+    # restart intervals within the device's index (ROI_MAX_INTERVALS, 8192)
+    sampling="1x1"
+    if [ "$kind" = "panorama" ] || [ "$ZOOM" -gt 1 ]; then
+        sampling="2x2"
+    fi
+
     # Process image:
     # 1. Auto-orient based on EXIF data (fixes rotation issues)
-    # 2. Resize to fit within 480x320 box (keeping aspect ratio)
+    # 2. Resize to fit within the box (keeping aspect ratio)
     # 3. Convert to JPG with quality 100
     # The '>' flag only shrinks images larger than the target size
-    if magick "$img" -auto-orient -resize "${TARGET_WIDTH}x${TARGET_HEIGHT}>" -quality 100 "$target_path" 2>/dev/null; then
-        echo -e "${GREEN}✓ Done${NC}"
+    if magick "$img" -auto-orient -resize "${resize_box}>" -quality 100 -sampling-factor "$sampling" "$target_path" 2>/dev/null; then
+        # Photos larger than the screen get a restart marker after every MCU,
+        # the device indexes them to decode only the visible part
+        read -r out_width out_height < <(magick identify -format "%w %h" "$target_path")
+        if [ "$HAS_JPEGTRAN" -eq 1 ] && { [ "$out_width" -gt "$TARGET_WIDTH" ] || [ "$out_height" -gt "$TARGET_HEIGHT" ]; }; then
+            jpegtran -restart 1B -copy none -outfile "$target_path.tmp" "$target_path" && mv "$target_path.tmp" "$target_path"
+            kind="$kind, pannable ${out_width}x${out_height}"
+        fi
+
+        echo -e "${GREEN}✓ Done${NC} ($kind)"
         ((PROCESSED++))
     else
         echo -e "${RED}✗ Failed${NC}"
@@ -108,6 +165,18 @@ for img in "${IMAGE_FILES[@]}"; do
     fi
 done
 
+# Videos become looping motion clips, sized by CLIP_SIZE (240x160 or 480x320)
+for video in "${VIDEO_FILES[@]}"; do
+    filename=$(basename "$video")
+    echo -n "Processing: $filename ... "
+
+    if bash "$SCRIPT_DIR/clip.sh" "$video" "$TARGET_DIR/${filename%.*}.mjpg"; then
+        ((PROCESSED++))
+    else
+        ((FAILED++))
+    fi
+done
+
 echo ""
 echo "====================================="
 echo "Processing complete!"
@@ -0,0 +1,57 @@
+#!/bin/bash
+
+# Script to replay a recorded input trace on a frame built with the
+# esp32dev_latency environment and print the touch-to-photon latency report
+# Usage: replay.sh <trace file> [serial port]
+
+# Color codes for output
+RED='\033[0;31m'
+GREEN='\033[0;32m'
+YELLOW='\033[1;33m'
+NC='\033[0m' # No Color
+
+TRACE_FILE="$1"
+PORT="${2:-/dev/ttyUSB0}"
+
+echo "Photo Frame Input Replay"
+echo "========================"
+echo ""
+
+if [ -z "$TRACE_FILE" ] || [ ! -f "$TRACE_FILE" ]; then
+    echo -e "${RED}Error: Trace file not found: $TRACE_FILE${NC}"
+    echo "Usage: $0 <trace file> [serial port]"
+    echo ""
+    echo "Record a trace by sending RECORD to the frame and saving the"
+    echo "'T' and 'B' lines it prints while you use the touch screen."
+    exit 1
+fi
+
+if [ ! -c "$PORT" ]; then
+    echo -e "${RED}Error: Serial port not found: $PORT${NC}"
+    exit 1
+fi
+
+EVENTS=$(grep -cE '^[TB] ' "$TRACE_FILE")
+LAST_AT=$(grep -E '^[TB] ' "$TRACE_FILE" | tail -n 1 | cut -d' ' -f2)
+
+echo -e "${YELLOW}Trace: $TRACE_FILE ($EVENTS events, $((LAST_AT / 1000)) s)${NC}"
+echo -e "${YELLOW}Port: $PORT${NC}"
+echo ""
+
+stty -F "$PORT" 115200 raw -echo
+
+# Collect the frame's output until the replay report is complete
+# (the frame settles for 3 s after the last event before reporting)
+timeout $((LAST_AT / 1000 + 10)) cat "$PORT" &
+READER=$!
+
+{
+    echo "REPLAY BEGIN"
+    grep -E '^[TB] ' "$TRACE_FILE"
+    echo "REPLAY END"
+} > "$PORT"
+
+wait $READER
+
+echo ""
+echo -e "${GREEN}Replay complete${NC}"
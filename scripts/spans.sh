@@ -0,0 +1,79 @@
+#!/bin/bash
+
+# Script to fetch the span trace from the frame and turn it into a timeline
+# Builds the host tool (tools/spans.cpp), asks a SPAN_TRACE build of the
+# firmware for its span ring and writes Chrome trace JSON that opens in
+# ui.perfetto.dev or chrome://tracing
+# Usage: spans.sh <port> [trace.json]
+#        spans.sh -i <saved serial log> [trace.json]
+
+# Color codes for output
+RED='\033[0;31m'
+GREEN='\033[0;32m'
+YELLOW='\033[1;33m'
+NC='\033[0m' # No Color
+
+# Get the script's directory and project root
+SCRIPT_DIR="$(cd "$(dirname "${BASH_SOURCE[0]}")" && pwd)"
+PROJECT_ROOT="$(dirname "$SCRIPT_DIR")"
+
+echo "Photo Frame Span Trace"
+echo "======================"
+echo ""
+
+if [ "$1" = "-i" ]; then
+    SOURCE_ARGS=(-i "$2")
+    SOURCE="$2"
+    OUTPUT="${3:-spans.json}"
+    if [ ! -f "$SOURCE" ]; then
+        echo -e "${RED}Error: Log file '$SOURCE' does not exist.${NC}"
+        exit 1
+    fi
+else
+    SOURCE_ARGS=("$1")
+    SOURCE="$1"
+    OUTPUT="${2:-spans.json}"
+fi
+
+if [ -z "$SOURCE" ]; then
+    echo "Usage: $0 <port> [trace.json]"
+    echo "       $0 -i <saved serial log> [trace.json]"
+    echo "  e.g. $0 /dev/ttyUSB0 slide.json"
+    exit 1
+fi
+
+if ! command -v g++ &> /dev/null; then
+    echo -e "${RED}Error: 'g++' command not found.${NC}"
+    echo "Please install a host C++ compiler to build the converter."
+    exit 1
+fi
+
+if [ "$1" != "-i" ]; then
+    if [ ! -e "$SOURCE" ]; then
+        echo -e "${RED}Error: Port '$SOURCE' does not exist.${NC}"
+        exit 1
+    fi
+
+    # The serial monitor holds the port open and eats the dump
+    if command -v fuser &> /dev/null && fuser "$SOURCE" &> /dev/null; then
+        echo -e "${YELLOW}! $SOURCE is in use, close the serial monitor first${NC}"
+    fi
+fi
+
+BUILD_DIR="$(mktemp -d)"
+trap 'rm -rf "$BUILD_DIR"' EXIT
+
+g++ -O2 -std=gnu++17 -I"$PROJECT_ROOT/include" "$PROJECT_ROOT/tools/spans.cpp" "$PROJECT_ROOT/src/upload.cpp" \
+    -o "$BUILD_DIR/spans" || exit 1
+
+echo -e "${YELLOW}Reading spans from $SOURCE...${NC}"
+echo ""
+
+if "$BUILD_DIR/spans" "${SOURCE_ARGS[@]}" "$OUTPUT"; then
+    echo ""
+    echo -e "${GREEN}✓ Wrote $OUTPUT, open it in ui.perfetto.dev or chrome://tracing${NC}"
+else
+    echo ""
+    echo -e "${RED}✗ No span trace, flash the esp32dev_spans environment first${NC}"
+    exit 1
+fi
@@ -0,0 +1,156 @@
+#!/bin/bash
+
+# Script to build the thumbnail file for the on-device gallery
+# Writes assets/target/thumbs.bin with a 120x80 JPEG thumbnail of every .jpg
+
+# Color codes for output
+RED='\033[0;31m'
+GREEN='\033[0;32m'
+YELLOW='\033[1;33m'
+NC='\033[0m' # No Color
+
+# Get the script's directory and project root
+SCRIPT_DIR="$(cd "$(dirname "${BASH_SOURCE[0]}")" && pwd)"
+PROJECT_ROOT="$(dirname "$SCRIPT_DIR")"
+
+# Define target directory and output file
+TARGET_DIR="$PROJECT_ROOT/assets/target"
+THUMBS_FILE="$TARGET_DIR/thumbs.bin"
+
+# Thumbnail format, must match include/thumbs.h
+THUMB_WIDTH=120
+THUMB_HEIGHT=80
+THUMB_MAX_BYTES=4096
+THUMB_NAME_MAX=56
+
+echo "Photo Frame Thumbnail Builder"
+echo "============================="
+echo ""
+
+# Check if magick command exists
+if ! command -v magick &> /dev/null; then
+    echo -e "${RED}Error: ImageMagick 'magick' command not found.${NC}"
+    echo "Please install ImageMagick to use this script."
+    exit 1
+fi
+
+# Check if target directory exists
+if [ ! -d "$TARGET_DIR" ]; then
+    echo -e "${RED}Error: Target directory not found: $TARGET_DIR${NC}"
+    exit 1
+fi
+
+# Order does not matter, the device looks each name up when a thumbnail is tapped
+shopt -s nullglob nocaseglob
+JPG_FILES=("$TARGET_DIR"/*.jpg)
+shopt -u nullglob nocaseglob
+
+if [ ${#JPG_FILES[@]} -eq 0 ]; then
+    echo -e "${YELLOW}No .jpg files found in $TARGET_DIR${NC}"
+    echo "Please run prepare.sh first to generate images."
+    exit 0
+fi
+
+# Little endian integer writers
+u16le() {
+    printf "\\x$(printf %02x $(($1 & 0xFF)))\\x$(printf %02x $((($1 >> 8) & 0xFF)))"
+}
+
+u32le() {
+    u16le $(($1 & 0xFFFF))
+    u16le $((($1 >> 16) & 0xFFFF))
+}
+
+# Length of a name in bytes, entries are fixed size in bytes whatever the locale
+byte_length() {
+    local LC_ALL=C
+    local text="$1"
+    echo ${#text}
+}
+
+# Baseline JPEG letterboxed to exactly 120x80. jpeg:extent is only a hint,
+# so the quality steps down until the file fits THUMB_MAX_BYTES.
+make_thumbnail() {
+    local quality
+    for quality in 85 70 55 40 25; do
+        magick "$1" -thumbnail "${THUMB_WIDTH}x${THUMB_HEIGHT}" -background black -gravity center \
+            -extent "${THUMB_WIDTH}x${THUMB_HEIGHT}" -strip -interlace none -sampling-factor 2x2 \
+            -quality $quality "$2" 2>/dev/null || return 1
+        [ "$(wc -c < "$2" | tr -d ' ')" -le $THUMB_MAX_BYTES ] && return 0
+    done
+    return 2
+}
+
+TEMP_DIR="$(mktemp -d)"
+trap 'rm -rf "$TEMP_DIR"' EXIT
+
+echo "Creating ${#JPG_FILES[@]} thumbnail(s)..."
+
+COUNT=0
+FAILED=0
+for img in "${JPG_FILES[@]}"; do
+    name=$(basename "$img")
+    if [ "$(byte_length "$name")" -ge $THUMB_NAME_MAX ]; then
+        echo -e "  ${YELLOW}! Skipped (name too long): $name${NC}"
+        continue
+    fi
+
+    # A thumbnail over THUMB_MAX_BYTES would make the device drop its whole page
+    thumb="$TEMP_DIR/$(printf "%05d" $COUNT).jpg"
+    make_thumbnail "$img" "$thumb"
+    case $? in
+    0)
+        echo "$name" > "$thumb.name"
+        ((COUNT++))
+        ;;
+    2)
+        echo -e "  ${RED}✗ Over $THUMB_MAX_BYTES bytes even at low quality: $name${NC}"
+        ((FAILED++))
+        ;;
+    *)
+        echo -e "  ${RED}✗ Failed: $name${NC}"
+        ((FAILED++))
+        ;;
+    esac
+done
+
+# Header, entry table, then the thumbnails back to back
+ENTRY_SIZE=$((8 + THUMB_NAME_MAX))
+offset=$((12 + COUNT * ENTRY_SIZE))
+
+{
+    printf "THB1"
+    u16le $COUNT
+    u16le $THUMB_WIDTH
+    u16le $THUMB_HEIGHT
+    u16le 0
+
+    for ((i = 0; i < COUNT; i++)); do
+        thumb="$TEMP_DIR/$(printf "%05d" $i).jpg"
+        name=$(cat "$thumb.name")
+        length=$(wc -c < "$thumb" | tr -d ' ')
+
+        u32le $offset
+        u32le $length
+        printf "%s" "$name"
+        head -c $((THUMB_NAME_MAX - $(byte_length "$name"))) /dev/zero
+
+        offset=$((offset + length))
+    done
+
+    for ((i = 0; i < COUNT; i++)); do
+        cat "$TEMP_DIR/$(printf "%05d" $i).jpg"
+    done
+} > "$THUMBS_FILE"
+
+echo ""
+echo "============================="
+echo -e "${GREEN}Successfully created $COUNT thumbnail(s)!${NC}"
+if [ $FAILED -gt 0 ]; then
+    echo -e "${RED}$FAILED photo(s) have no thumbnail and are missing from the gallery${NC}"
+fi
+echo ""
+echo "Thumbnail file saved to: $THUMBS_FILE"
+echo "Copy it to the SD card root together with the photos."
+
+[ $FAILED -eq 0 ]
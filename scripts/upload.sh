@@ -0,0 +1,72 @@
+#!/bin/bash
+
+# Script to send photos to the frame over USB serial
+# Builds the host sender (tools/upload.cpp) and writes the given .jpg files
+# straight to the frame's SD card, resuming any upload that was interrupted
+# Run prepare.sh on the photos first, they are stored as they are sent
+# Usage: upload.sh <port> <file.jpg>...
+#   UPLOAD_BAUD=921600  session baud, lower it on long or noisy cables
+#   UPLOAD_COMPRESS=1   compress data frames (rarely pays off for JPEG)
+
+# Color codes for output
+RED='\033[0;31m'
+GREEN='\033[0;32m'
+YELLOW='\033[1;33m'
+NC='\033[0m' # No Color
+
+# Get the script's directory and project root
+SCRIPT_DIR="$(cd "$(dirname "${BASH_SOURCE[0]}")" && pwd)"
+PROJECT_ROOT="$(dirname "$SCRIPT_DIR")"
+
+UPLOAD_BAUD="${UPLOAD_BAUD:-921600}"
+UPLOAD_COMPRESS="${UPLOAD_COMPRESS:-0}"
+
+echo "Photo Frame Serial Upload"
+echo "========================="
+echo ""
+
+if [ $# -lt 2 ]; then
+    echo "Usage: $0 <port> <file.jpg>..."
+    echo "  e.g. $0 /dev/ttyUSB0 prepared/*.jpg"
+    exit 1
+fi
+
+if ! command -v g++ &> /dev/null; then
+    echo -e "${RED}Error: 'g++' command not found.${NC}"
+    echo "Please install a host C++ compiler to build the sender."
+    exit 1
+fi
+
+PORT="$1"
+shift
+
+if [ ! -e "$PORT" ]; then
+    echo -e "${RED}Error: Port '$PORT' does not exist.${NC}"
+    exit 1
+fi
+
+# The serial monitor holds the port open and eats the replies
+if command -v fuser &> /dev/null && fuser "$PORT" &> /dev/null; then
+    echo -e "${YELLOW}! $PORT is in use, close the serial monitor first${NC}"
+fi
+
+BUILD_DIR="$(mktemp -d)"
+trap 'rm -rf "$BUILD_DIR"' EXIT
+
+g++ -O2 -std=gnu++17 -I"$PROJECT_ROOT/include" "$PROJECT_ROOT/tools/upload.cpp" "$PROJECT_ROOT/src/upload.cpp" \
+    -o "$BUILD_DIR/upload" || exit 1
+
+ARGS=(-b "$UPLOAD_BAUD")
+[ "$UPLOAD_COMPRESS" = "1" ] && ARGS+=(-z)
+
+echo -e "${YELLOW}Sending $# file(s) to $PORT at $UPLOAD_BAUD baud...${NC}"
+echo ""
+
+if "$BUILD_DIR/upload" "${ARGS[@]}" "$PORT" "$@"; then
+    echo ""
+    echo -e "${GREEN}✓ Upload complete, the frame rescans its card${NC}"
+else
+    echo ""
+    echo -e "${RED}✗ Some files were not stored, run again to resume${NC}"
+    exit 1
+fi
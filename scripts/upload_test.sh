@@ -0,0 +1,105 @@
+#!/bin/bash
+
+# Script to test the serial upload protocol end to end on the host
+# Runs the frame's receive mode (src/upload.cpp) on a pseudo-terminal with a
+# directory standing in for the SD card, paced to the negotiated baud and with
+# a bit flipped now and then, sends assets/example through it with
+# tools/upload.cpp, interrupts an upload and resumes it, and checks every file
+# Usage: upload_test.sh
+
+# Color codes for output
+RED='\033[0;31m'
+GREEN='\033[0;32m'
+YELLOW='\033[1;33m'
+NC='\033[0m' # No Color
+
+# Get the script's directory and project root
+SCRIPT_DIR="$(cd "$(dirname "${BASH_SOURCE[0]}")" && pwd)"
+PROJECT_ROOT="$(dirname "$SCRIPT_DIR")"
+
+echo "Photo Frame Upload Protocol Test"
+echo "================================"
+echo ""
+
+if ! command -v g++ &> /dev/null; then
+    echo -e "${RED}Error: 'g++' command not found.${NC}"
+    echo "Please install a host C++ compiler to run the test."
+    exit 1
+fi
+
+WORK_DIR="$(mktemp -d)"
+CARD_DIR="$WORK_DIR/card"
+mkdir -p "$CARD_DIR"
+
+RX_PID=""
+cleanup() {
+    [ -n "$RX_PID" ] && kill "$RX_PID" 2> /dev/null
+    rm -rf "$WORK_DIR"
+}
+trap cleanup EXIT
+
+FLAGS=(-O2 -std=gnu++17 -I"$PROJECT_ROOT/include")
+g++ "${FLAGS[@]}" "$PROJECT_ROOT/tools/upload.cpp" "$PROJECT_ROOT/src/upload.cpp" -o "$WORK_DIR/upload" || exit 1
+g++ "${FLAGS[@]}" "$PROJECT_ROOT/tools/upload_rx.cpp" "$PROJECT_ROOT/src/upload.cpp" -o "$WORK_DIR/upload_rx" || exit 1
+
+# Receiver in the background, it prints the terminal side of its pty pair first
+"$WORK_DIR/upload_rx" --noise 20000 "$CARD_DIR" > "$WORK_DIR/rx.log" &
+RX_PID=$!
+for _ in $(seq 50); do
+    PORT=$(sed -n 's/^PORT //p' "$WORK_DIR/rx.log")
+    [ -n "$PORT" ] && break
+    sleep 0.1
+done
+if [ -z "$PORT" ]; then
+    echo -e "${RED}✗ Receiver did not start${NC}"
+    exit 1
+fi
+echo -e "${GREEN}✓ Receiver listening on $PORT${NC}"
+echo ""
+
+FILES=("$PROJECT_ROOT"/assets/example/*.jpg)
+FAILED=0
+
+check_files() {
+    for file in "$@"; do
+        if ! cmp -s "$file" "$CARD_DIR/$(basename "$file")"; then
+            echo -e "${RED}✗ $(basename "$file") differs on the card${NC}"
+            ((FAILED++))
+        fi
+    done
+}
+
+echo -e "${YELLOW}Sending ${#FILES[@]} file(s)...${NC}"
+"$WORK_DIR/upload" "$PORT" "${FILES[@]}" || ((FAILED++))
+check_files "${FILES[@]}"
+echo ""
+
+echo -e "${YELLOW}Sending again with compression...${NC}"
+rm -f "$CARD_DIR"/*.jpg
+"$WORK_DIR/upload" -z "$PORT" "${FILES[@]}" || ((FAILED++))
+check_files "${FILES[@]}"
+echo ""
+
+# The receiver keeps the partial file once the session times out
+echo -e "${YELLOW}Interrupting an upload...${NC}"
+rm -f "$CARD_DIR"/*.jpg
+STOP_AT=$(($(wc -c < "${FILES[0]}") / 2))
+"$WORK_DIR/upload" --stop-after "$STOP_AT" "$PORT" "${FILES[0]}"
+sleep 6
+
+echo -e "${YELLOW}Resuming it...${NC}"
+"$WORK_DIR/upload" "$PORT" "${FILES[0]}" | tee "$WORK_DIR/resume.log" || ((FAILED++))
+if ! grep -q "resumed at" "$WORK_DIR/resume.log"; then
+    echo -e "${RED}✗ Upload started over instead of resuming${NC}"
+    ((FAILED++))
+fi
+check_files "${FILES[0]}"
+echo ""
+
+echo "================================"
+if [ "$FAILED" -eq 0 ]; then
+    echo -e "${GREEN}✓ All uploads arrived intact${NC}"
+else
+    echo -e "${RED}✗ $FAILED check(s) failed${NC}"
+    exit 1
+fi
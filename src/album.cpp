@@ -0,0 +1,104 @@
+#include "album.h"
+
+#include <esp_partition.h>
+#include "log.h"
+
+#define ALBUM_MAGIC "ALB1"
+#define ALBUM_HEADER_SIZE 8
+#define ALBUM_ENTRY_SIZE (8 + ALBUM_NAME_MAX)
+
+static const uint8_t *album = nullptr;
+static uint32_t album_size = 0;
+static uint16_t album_count = 0;
+
+static uint16_t readU16(const uint8_t *p)
+{
+  return p[0] | (p[1] << 8);
+}
+
+static uint32_t readU32(const uint8_t *p)
+{
+  return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static const uint8_t *entry(int index)
+{
+  return album + ALBUM_HEADER_SIZE + index * ALBUM_ENTRY_SIZE;
+}
+
+bool albumOpen()
+{
+  album_count = 0;
+
+  const esp_partition_t *partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, ALBUM_PARTITION);
+  if (!partition)
+  {
+    LOG_WARN("No album partition, flash with partitions.csv");
+    return false;
+  }
+
+  // Mapped once and never unmapped, the photos are read through the flash cache
+  const void *mapped = nullptr;
+  spi_flash_mmap_handle_t handle;
+  if (esp_partition_mmap(partition, 0, partition->size, SPI_FLASH_MMAP_DATA, &mapped, &handle) != ESP_OK)
+  {
+    LOG_ERROR("Album partition could not be mapped");
+    return false;
+  }
+
+  album = (const uint8_t *)mapped;
+  album_size = partition->size;
+
+  if (memcmp(album, ALBUM_MAGIC, 4) != 0)
+  {
+    LOG_WARN("Album partition is empty, write one with scripts/album.sh");
+    return false;
+  }
+
+  uint16_t count = readU16(album + 4);
+  if (ALBUM_HEADER_SIZE + (uint32_t)count * ALBUM_ENTRY_SIZE > album_size)
+  {
+    LOG_ERROR("Album partition is not valid, rerun scripts/album.sh");
+    return false;
+  }
+
+  // Entries pointing past the partition end are cut off with the rest
+  for (album_count = 0; album_count < count; album_count++)
+  {
+    uint32_t offset = readU32(entry(album_count));
+    uint32_t length = readU32(entry(album_count) + 4);
+    if (offset > album_size || length > album_size - offset)
+      break;
+  }
+
+  return album_count > 0;
+}
+
+int albumCount()
+{
+  return album_count;
+}
+
+const uint8_t *albumData(int index, uint32_t *size)
+{
+  if (index < 0 || index >= album_count)
+  {
+    *size = 0;
+    return nullptr;
+  }
+
+  *size = readU32(entry(index) + 4);
+  return album + readU32(entry(index));
+}
+
+const char *albumName(int index)
+{
+  if (index < 0 || index >= album_count)
+    return "";
+
+  // Names are zero padded, a name using all ALBUM_NAME_MAX bytes is not terminated
+  static char name[ALBUM_NAME_MAX + 1];
+  memcpy(name, entry(index) + 8, ALBUM_NAME_MAX);
+  name[ALBUM_NAME_MAX] = '\0';
+  return name;
+}
@@ -0,0 +1,301 @@
+#include "backbuffer.h"
+#include <esp_heap_caps.h>
+#include "panel.h"
+#include "log.h"
+
+#define PALETTE_SIZE 256
+#define BIN_COUNT 4096       // RGB444 bins
+#define BIN_UNASSIGNED 0xFFFF
+
+// A DMA chunk must never span two bands
+static_assert(BACKBUFFER_BAND_ROWS % BACKBUFFER_DMA_ROWS == 0, "band rows must be a multiple of DMA rows");
+
+static TFT_eSPI *bb_tft = nullptr;
+static constexpr int16_t frame_width = Panel::width;
+static constexpr int16_t frame_height = Panel::height;
+static constexpr int band_count = (frame_height + BACKBUFFER_BAND_ROWS - 1) / BACKBUFFER_BAND_ROWS;
+static uint8_t **bands = nullptr; // frame rows, BACKBUFFER_BAND_ROWS per band
+
+static uint16_t palette[PALETTE_SIZE];  // RGB565, byte-swapped for the SPI bus
+
+// Sum of the pixels mapped to each entry, the entry is moved to their mean
+// before presenting so late pixels merged into an entry pull it their way
+static uint32_t entry_sum[PALETTE_SIZE][3];
+static uint32_t entry_pixels[PALETTE_SIZE];
+static uint16_t *bin_index = nullptr;   // palette entry of each RGB444 bin
+static int palette_used = 0;
+static uint32_t bins_merged = 0;        // bins mapped to an existing entry once the palette was full
+
+static uint16_t *line_buffers[2] = {nullptr, nullptr};
+static bool capturing = false;
+
+static inline uint16_t swap565(uint16_t pixel)
+{
+  return (pixel >> 8) | (pixel << 8);
+}
+
+static void freeBuffers()
+{
+  if (bands)
+  {
+    for (int i = 0; i < band_count; i++)
+      free(bands[i]);
+    free(bands);
+    bands = nullptr;
+  }
+
+  free(bin_index);
+  bin_index = nullptr;
+
+  for (int i = 0; i < 2; i++)
+  {
+    heap_caps_free(line_buffers[i]);
+    line_buffers[i] = nullptr;
+  }
+}
+
+bool backBufferBegin(TFT_eSPI &tft)
+{
+  bb_tft = &tft;
+
+  size_t free_before = ESP.getFreeHeap();
+  size_t band_bytes = (size_t)frame_width * BACKBUFFER_BAND_ROWS;
+  size_t line_bytes = (size_t)frame_width * BACKBUFFER_DMA_ROWS * sizeof(uint16_t);
+
+  // All buffers live for the whole run, nothing is allocated per slide
+  bands = (uint8_t **)calloc(band_count, sizeof(uint8_t *));
+  bin_index = (uint16_t *)malloc(BIN_COUNT * sizeof(uint16_t));
+  bool allocated = bands && bin_index;
+
+  for (int i = 0; allocated && i < band_count; i++)
+  {
+    bands[i] = (uint8_t *)malloc(band_bytes);
+    allocated = bands[i] != nullptr;
+  }
+
+  for (int i = 0; allocated && i < 2; i++)
+  {
+    line_buffers[i] = (uint16_t *)heap_caps_malloc(line_bytes, MALLOC_CAP_DMA);
+    allocated = line_buffers[i] != nullptr;
+  }
+
+  if (!allocated || !tft.initDMA())
+  {
+    LOG_WARN("Back buffer could not be allocated, photos are drawn directly");
+    freeBuffers();
+    return false;
+  }
+
+  LOG_INFO("Back buffer: %u bytes in %d bands, %u bytes of DMA lines, free heap %u -> %u",
+           (unsigned)(band_bytes * band_count), band_count, (unsigned)(2 * line_bytes),
+           (unsigned)free_before, (unsigned)ESP.getFreeHeap());
+
+  backBufferClear();
+  return true;
+}
+
+bool backBufferStart()
+{
+  if (!bands)
+    return false;
+
+  backBufferClear();
+  capturing = true;
+  return true;
+}
+
+bool backBufferCapturing()
+{
+  return capturing;
+}
+
+void backBufferClear()
+{
+  if (!bands)
+    return;
+
+  for (int i = 0; i < band_count; i++)
+    memset(bands[i], 0, (size_t)frame_width * BACKBUFFER_BAND_ROWS);
+
+  for (int i = 0; i < BIN_COUNT; i++)
+    bin_index[i] = BIN_UNASSIGNED;
+
+  memset(entry_sum, 0, sizeof(entry_sum));
+  memset(entry_pixels, 0, sizeof(entry_pixels));
+
+  palette[0] = 0;
+  bin_index[0] = 0;
+  palette_used = 1;
+  bins_merged = 0;
+}
+
+// Closest palette entry to an RGB565 color, green weighted the most
+static uint8_t nearestEntry(uint16_t color)
+{
+  int r = (color >> 11) << 1;
+  int g = (color >> 5) & 0x3F;
+  int b = (color & 0x1F) << 1;
+
+  uint8_t best = 0;
+  uint32_t best_distance = UINT32_MAX;
+  for (int i = 0; i < palette_used; i++)
+  {
+    uint16_t entry = swap565(palette[i]);
+    int dr = r - ((entry >> 11) << 1);
+    int dg = g - ((entry >> 5) & 0x3F);
+    int db = b - ((entry & 0x1F) << 1);
+    uint32_t distance = 3 * dr * dr + 4 * dg * dg + 2 * db * db;
+
+    if (distance < best_distance)
+    {
+      best_distance = distance;
+      best = i;
+    }
+  }
+
+  return best;
+}
+
+void backBufferCapture(int16_t x, int16_t y, uint16_t w, uint16_t h, const uint16_t *pixels, bool swapped)
+{
+  if (!bands)
+    return;
+
+  int16_t row_start = max(y, (int16_t)0);
+  int16_t row_end = min((int16_t)(y + h), frame_height);
+  int16_t col_start = max(x, (int16_t)0);
+  int16_t col_end = min((int16_t)(x + w), frame_width);
+
+  // Neighbouring pixels usually fall in the same bin, skip the lookup for runs
+  uint16_t last_bin = BIN_UNASSIGNED;
+  uint8_t last_entry = 0;
+
+  for (int16_t row = row_start; row < row_end; row++)
+  {
+    const uint16_t *src = pixels + (row - y) * w + (col_start - x);
+    uint8_t *dst = bands[row / BACKBUFFER_BAND_ROWS] + (row % BACKBUFFER_BAND_ROWS) * frame_width + col_start;
+
+    for (int16_t col = col_start; col < col_end; col++)
+    {
+      uint16_t color = swapped ? swap565(*src++) : *src++;
+      uint16_t bin = ((color >> 4) & 0xF00) | ((color >> 3) & 0x0F0) | ((color >> 1) & 0x00F);
+
+      if (bin != last_bin)
+      {
+        uint16_t entry = bin_index[bin];
+        if (entry == BIN_UNASSIGNED)
+        {
+          if (palette_used < PALETTE_SIZE)
+          {
+            entry = palette_used++;
+            palette[entry] = swap565(color);
+          }
+          else
+          {
+            entry = nearestEntry(color);
+            bins_merged++;
+          }
+          bin_index[bin] = entry;
+        }
+
+        last_bin = bin;
+        last_entry = entry;
+      }
+
+      *dst++ = last_entry;
+
+      uint32_t *sum = entry_sum[last_entry];
+      sum[0] += color >> 11;
+      sum[1] += (color >> 5) & 0x3F;
+      sum[2] += color & 0x1F;
+      entry_pixels[last_entry]++;
+    }
+  }
+}
+
+void backBufferFinish()
+{
+  if (!capturing)
+    return;
+  capturing = false;
+
+  // Entry 0 stays pure black for the borders
+  for (int i = 1; i < palette_used; i++)
+  {
+    uint32_t n = entry_pixels[i];
+    if (n)
+      palette[i] = swap565(((entry_sum[i][0] / n) << 11) | ((entry_sum[i][1] / n) << 5) | (entry_sum[i][2] / n));
+  }
+}
+
+void backBufferPresent()
+{
+  if (!capturing)
+    return;
+  backBufferFinish();
+
+  unsigned long started_at = micros();
+
+  // Palette entries are stored byte-swapped, so pushPixelsDMA must not swap again
+  bool swap_bytes = bb_tft->getSwapBytes();
+  bb_tft->setSwapBytes(false);
+  bb_tft->startWrite();
+  bb_tft->setAddrWindow(0, 0, frame_width, frame_height);
+
+  int current = 0;
+  for (int16_t row = 0; row < frame_height; row += BACKBUFFER_DMA_ROWS)
+  {
+    int16_t rows = min((int16_t)BACKBUFFER_DMA_ROWS, (int16_t)(frame_height - row));
+    uint16_t *dst = line_buffers[current];
+
+    const uint8_t *src = bands[row / BACKBUFFER_BAND_ROWS] + (row % BACKBUFFER_BAND_ROWS) * frame_width;
+    for (size_t i = 0; i < (size_t)frame_width * rows; i++)
+      dst[i] = palette[src[i]];
+
+    // Waits for the other line buffer to finish before queuing this one
+    bb_tft->pushPixelsDMA(dst, (uint32_t)frame_width * rows);
+    current ^= 1;
+  }
+
+  bb_tft->dmaWait();
+  bb_tft->endWrite();
+  bb_tft->setSwapBytes(swap_bytes);
+
+  LOG_INFO("Swapped in %lu us (%d colors, %lu bins merged)", micros() - started_at, palette_used,
+           (unsigned long)bins_merged);
+}
+
+void backBufferPushColumns(int16_t x, int16_t w)
+{
+  if (!bands || w <= 0)
+    return;
+
+  // As many rows of the strip as fit in a line buffer
+  int16_t chunk_rows = min((int16_t)((frame_width * BACKBUFFER_DMA_ROWS) / w), frame_height);
+
+  bool swap_bytes = bb_tft->getSwapBytes();
+  bb_tft->setSwapBytes(false);
+  bb_tft->startWrite();
+  bb_tft->setAddrWindow(x, 0, w, frame_height);
+
+  int current = 0;
+  for (int16_t row = 0; row < frame_height; row += chunk_rows)
+  {
+    int16_t rows = min(chunk_rows, (int16_t)(frame_height - row));
+    uint16_t *dst = line_buffers[current];
+
+    for (int16_t r = row; r < row + rows; r++)
+    {
+      const uint8_t *src = bands[r / BACKBUFFER_BAND_ROWS] + (r % BACKBUFFER_BAND_ROWS) * frame_width + x;
+      for (int16_t c = 0; c < w; c++)
+        *dst++ = palette[src[c]];
+    }
+
+    bb_tft->pushPixelsDMA(line_buffers[current], (uint32_t)w * rows);
+    current ^= 1;
+  }
+
+  bb_tft->dmaWait();
+  bb_tft->endWrite();
+  bb_tft->setSwapBytes(swap_bytes);
+}
@@ -0,0 +1,75 @@
+#include "backlight.h"
+#include <driver/ledc.h>
+
+// Channel and timer of their own, analogWrite() allocates from the other end
+#define BACKLIGHT_MODE LEDC_HIGH_SPEED_MODE
+#define BACKLIGHT_CHANNEL LEDC_CHANNEL_0
+#define BACKLIGHT_TIMER LEDC_TIMER_0
+#define BACKLIGHT_RESOLUTION LEDC_TIMER_13_BIT // fine steps keep slow fades smooth at the dark end
+#define BACKLIGHT_MAX_DUTY ((1 << 13) - 1)
+#define BACKLIGHT_FREQUENCY 5000
+
+static int target_percent = 0;
+static unsigned long fade_ends_at = 0;
+
+static uint32_t dutyFor(int percent)
+{
+  return (uint32_t)constrain(percent, 0, 100) * BACKLIGHT_MAX_DUTY / 100;
+}
+
+void backlightBegin(uint8_t pin, int percent)
+{
+  ledc_timer_config_t timer = {};
+  timer.speed_mode = BACKLIGHT_MODE;
+  timer.duty_resolution = BACKLIGHT_RESOLUTION;
+  timer.timer_num = BACKLIGHT_TIMER;
+  timer.freq_hz = BACKLIGHT_FREQUENCY;
+  timer.clk_cfg = LEDC_AUTO_CLK;
+  ledc_timer_config(&timer);
+
+  ledc_channel_config_t channel = {};
+  channel.gpio_num = pin;
+  channel.speed_mode = BACKLIGHT_MODE;
+  channel.channel = BACKLIGHT_CHANNEL;
+  channel.intr_type = LEDC_INTR_DISABLE;
+  channel.timer_sel = BACKLIGHT_TIMER;
+  channel.duty = dutyFor(percent);
+  channel.hpoint = 0;
+  ledc_channel_config(&channel);
+
+  ledc_fade_func_install(0);
+  target_percent = percent;
+}
+
+void backlightSet(int percent)
+{
+  ledc_set_duty(BACKLIGHT_MODE, BACKLIGHT_CHANNEL, dutyFor(percent));
+  ledc_update_duty(BACKLIGHT_MODE, BACKLIGHT_CHANNEL);
+  target_percent = percent;
+}
+
+void backlightFade(int percent, uint32_t duration_ms)
+{
+  if (duration_ms == 0)
+  {
+    backlightSet(percent);
+    return;
+  }
+
+  ledc_set_fade_with_time(BACKLIGHT_MODE, BACKLIGHT_CHANNEL, dutyFor(percent), duration_ms);
+  ledc_fade_start(BACKLIGHT_MODE, BACKLIGHT_CHANNEL, LEDC_FADE_NO_WAIT);
+  target_percent = percent;
+  fade_ends_at = millis() + duration_ms;
+}
+
+void backlightWait()
+{
+  long left = (long)(fade_ends_at - millis());
+  if (left > 0)
+    delay(left + 1);
+}
+
+int backlightTarget()
+{
+  return target_percent;
+}
@@ -0,0 +1,164 @@
+#include "clip.h"
+
+#include <TJpg_Decoder.h>
+#include "log.h"
+
+#define CLIP_MAGIC "MJP1"
+#define CLIP_HEADER_SIZE 12
+
+static File clip_file;
+static bool playing = false;
+static uint16_t frame_count = 0;
+static uint16_t fps = 0;
+static uint32_t frame_offsets[CLIP_MAX_FRAMES + 1];
+
+// Pacing is done in whole frames since the start of playback
+static unsigned long started_at = 0;
+static uint32_t frame_us = 0;
+static uint32_t next_frame = 0;
+
+// Counters of the current pass through the clip
+static uint32_t pass = 0;
+static unsigned long pass_started_at = 0;
+static uint32_t shown = 0;
+static uint32_t dropped = 0;
+
+// Allocated on first use and kept, playback does not churn the heap
+static uint8_t *frame_buffer = nullptr;
+
+static uint16_t readU16(const uint8_t *p)
+{
+  return p[0] | (p[1] << 8);
+}
+
+static uint32_t readU32(const uint8_t *p)
+{
+  return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+bool clipIsClip(const char *name)
+{
+  size_t length = strlen(name);
+  size_t extension = strlen(CLIP_EXTENSION);
+  return length > extension && strcasecmp(name + length - extension, CLIP_EXTENSION) == 0;
+}
+
+static void reportPass()
+{
+  unsigned long elapsed = micros() - pass_started_at;
+  LOG_INFO("Clip pass %lu: %lu frames shown, %lu dropped, %.1f fps (target %u)",
+           (unsigned long)pass + 1, (unsigned long)shown, (unsigned long)dropped,
+           elapsed > 0 ? shown * 1000000.0 / elapsed : 0.0, fps);
+}
+
+int clipOpen(fs::FS &fs, const char *path, uint16_t *width, uint16_t *height)
+{
+  clipStop();
+
+  if (!frame_buffer)
+  {
+    frame_buffer = (uint8_t *)malloc(CLIP_FRAME_MAX);
+    if (!frame_buffer)
+    {
+      LOG_ERROR("Clip frame buffer could not be allocated");
+      return -1;
+    }
+  }
+
+  clip_file = fs.open(path);
+  if (!clip_file)
+    return -1;
+
+  uint8_t header[CLIP_HEADER_SIZE];
+  bool ok = clip_file.read(header, sizeof(header)) == sizeof(header) &&
+            memcmp(header, CLIP_MAGIC, 4) == 0;
+
+  frame_count = ok ? readU16(header + 10) : 0;
+  fps = ok ? readU16(header + 8) : 0;
+  ok = ok && frame_count > 0 && frame_count <= CLIP_MAX_FRAMES && fps > 0;
+
+  // The index is read in one go into the frame buffer, then unpacked
+  size_t index_size = (frame_count + 1) * sizeof(uint32_t);
+  ok = ok && clip_file.read(frame_buffer, index_size) == index_size;
+
+  if (!ok)
+  {
+    LOG_ERROR("Clip is not valid, rerun scripts/clip.sh");
+    clip_file.close();
+    return -1;
+  }
+
+  for (int i = 0; i <= frame_count; i++)
+  {
+    frame_offsets[i] = readU32(frame_buffer + i * sizeof(uint32_t));
+  }
+
+  *width = readU16(header + 4);
+  *height = readU16(header + 6);
+
+  frame_us = 1000000UL / fps;
+  started_at = micros();
+  pass_started_at = started_at;
+  next_frame = 0;
+  pass = 0;
+  shown = 0;
+  dropped = 0;
+  playing = true;
+
+  LOG_INFO("Clip: %u frames, %ux%u at %u fps", frame_count, *width, *height, fps);
+  return 0;
+}
+
+bool clipTick(int32_t x, int32_t y)
+{
+  if (!playing)
+    return false;
+
+  uint32_t due_frame = (micros() - started_at) / frame_us;
+  if (due_frame < next_frame)
+    return true;
+
+  // Frames whose time has already passed are skipped
+  dropped += due_frame - next_frame;
+  next_frame = due_frame + 1;
+
+  if (due_frame / frame_count != pass)
+  {
+    reportPass();
+    pass = due_frame / frame_count;
+    pass_started_at = micros();
+    shown = 0;
+    dropped = 0;
+  }
+
+  uint16_t frame = due_frame % frame_count;
+  uint32_t offset = frame_offsets[frame];
+  uint32_t length = frame_offsets[frame + 1] - offset;
+
+  if (length == 0 || length > CLIP_FRAME_MAX || !clip_file.seek(offset) ||
+      clip_file.read(frame_buffer, length) != length)
+  {
+    dropped++;
+    return true;
+  }
+
+  TJpgDec.drawJpg(x, y, frame_buffer, length);
+  shown++;
+
+  return true;
+}
+
+void clipStop()
+{
+  if (!playing)
+    return;
+
+  reportPass();
+  clip_file.close();
+  playing = false;
+}
+
+bool clipPlaying()
+{
+  return playing;
+}
@@ -0,0 +1,56 @@
+#include "dirscan.h"
+
+#include <dirent.h>
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/stat.h>
+
+#define DIRSCAN_PATH_MAX 300
+
+// Only reached on file systems whose entries carry no type, never on FAT
+static bool isRegularFile(const char *path, const char *name)
+{
+  char full[DIRSCAN_PATH_MAX];
+  snprintf(full, sizeof(full), "%s/%s", path, name);
+
+  struct stat info;
+  return stat(full, &info) == 0 && S_ISREG(info.st_mode);
+}
+
+bool dirScan(const char *path, void (*found)(void *context, const char *name), void *context, DirScanStats *stats)
+{
+  stats->entries = 0;
+  stats->files = 0;
+
+  DIR *dir = opendir(path);
+  if (!dir)
+    return false;
+
+  struct dirent *entry;
+  while ((entry = readdir(dir)) != nullptr)
+  {
+    stats->entries++;
+
+    // Hidden files, "." and ".."
+    if (entry->d_name[0] == '.')
+      continue;
+
+    bool regular = entry->d_type == DT_REG || (entry->d_type == DT_UNKNOWN && isRegularFile(path, entry->d_name));
+    if (!regular)
+      continue;
+
+    stats->files++;
+    found(context, entry->d_name);
+  }
+
+  closedir(dir);
+  return true;
+}
+
+bool dirHasExtension(const char *name, const char *extension)
+{
+  size_t length = strlen(name);
+  size_t extension_length = strlen(extension);
+  return length > extension_length && strcasecmp(name + length - extension_length, extension) == 0;
+}
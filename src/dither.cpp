@@ -0,0 +1,131 @@
+#include "dither.h"
+
+// The tjpgd copy in the ESP32 mask ROM is built with JD_FORMAT 0, so it hands
+// out RGB888 blocks instead of truncating to RGB565 like TJpg_Decoder does
+#include "esp32/rom/tjpgd.h"
+#include "spans.h"
+
+// 4x4 Bayer threshold matrix, values 0-15
+static const uint8_t bayer4[16] = {
+    0, 8, 2, 10,
+    12, 4, 14, 6,
+    3, 11, 1, 9,
+    15, 7, 13, 5};
+
+// Quantised channel value for every (matrix cell, 8-bit input) pair.
+// 5-bit for red and blue, 6-bit for green, 8 KB in total.
+static uint8_t dither5[16][256];
+static uint8_t dither6[16][256];
+
+static uint8_t workspace[DITHER_WORKSPACE_SIZE] __attribute__((aligned(4)));
+static uint16_t block_buffer[DITHER_BLOCK_PIXELS];
+
+static DitherOutputCallback output_callback = nullptr;
+
+// Per-decode state handed to the ROM decoder through JDEC::device
+struct DitherSource
+{
+  fs::File *file;
+  int32_t x;
+  int32_t y;
+};
+
+uint8_t *ditherWorkspace()
+{
+  return workspace;
+}
+
+uint16_t *ditherBlockBuffer()
+{
+  return block_buffer;
+}
+
+void ditherInit(DitherOutputCallback callback)
+{
+  output_callback = callback;
+
+  for (int cell = 0; cell < 16; cell++)
+  {
+    // Spread the threshold over one quantisation step of each channel
+    int offset5 = (bayer4[cell] * 8) / 16;
+    int offset6 = (bayer4[cell] * 4) / 16;
+
+    for (int v = 0; v < 256; v++)
+    {
+      dither5[cell][v] = min(v + offset5, 255) >> 3;
+      dither6[cell][v] = min(v + offset6, 255) >> 2;
+    }
+  }
+}
+
+static UINT ditherInput(JDEC *jdec, BYTE *buffer, UINT length)
+{
+  SPAN("sd read");
+  DitherSource *source = (DitherSource *)jdec->device;
+
+  // A null buffer means skip ahead
+  if (!buffer)
+  {
+    return source->file->seek(source->file->position() + length) ? length : 0;
+  }
+
+  return source->file->read(buffer, length);
+}
+
+void ditherPackBlock(const uint8_t *rgb, uint16_t stride, uint16_t *out, int32_t x, int32_t y, uint16_t w, uint16_t h, bool dithered)
+{
+  for (uint16_t row = 0; row < h; row++)
+  {
+    const uint8_t *src = rgb + row * stride * 3;
+
+    // Row of the threshold matrix is fixed for the whole line, cell 0 has a
+    // zero threshold and gives plain truncation
+    int cell_row = ((y + row) & 3) << 2;
+
+    for (uint16_t col = 0; col < w; col++)
+    {
+      int cell = dithered ? cell_row | ((x + col) & 3) : 0;
+      uint16_t pixel = (dither5[cell][src[0]] << 11) | (dither6[cell][src[1]] << 5) | dither5[cell][src[2]];
+      src += 3;
+
+      // Byte-swapped so the block can go straight out on the SPI bus
+      *out++ = (pixel >> 8) | (pixel << 8);
+    }
+  }
+}
+
+static UINT ditherOutput(JDEC *jdec, void *bitmap, JRECT *rect)
+{
+  DitherSource *source = (DitherSource *)jdec->device;
+
+  uint16_t w = rect->right - rect->left + 1;
+  uint16_t h = rect->bottom - rect->top + 1;
+  int32_t x = source->x + rect->left;
+  int32_t y = source->y + rect->top;
+
+  ditherPackBlock((const uint8_t *)bitmap, w, block_buffer, x, y, w, h, true);
+
+  return output_callback(x, y, w, h, block_buffer) ? 1 : 0;
+}
+
+int ditherDrawFsJpg(int32_t x, int32_t y, const char *path, fs::FS &fs)
+{
+  if (!output_callback)
+    return JDR_PAR;
+
+  fs::File file = fs.open(path);
+  if (!file)
+    return JDR_INP;
+
+  DitherSource source = {&file, x, y};
+  JDEC jdec;
+
+  JRESULT result = jd_prepare(&jdec, ditherInput, workspace, DITHER_WORKSPACE_SIZE, &source);
+  if (result == JDR_OK)
+  {
+    result = jd_decomp(&jdec, ditherOutput, 0);
+  }
+
+  file.close();
+  return result;
+}
@@ -0,0 +1,130 @@
+#include "exif.h"
+
+// Bytes of the APP1 payload that are inspected. IFD0 sits right after the
+// TIFF header, so the orientation entry is always found well inside this.
+#define EXIF_SCAN_BYTES 512
+
+// Give up after this many segments in front of the Exif block
+#define EXIF_MAX_SEGMENTS 8
+
+#define JPEG_MARKER_SOI 0xD8
+#define JPEG_MARKER_SOS 0xDA
+#define JPEG_MARKER_APP1 0xE1
+
+#define EXIF_TAG_ORIENTATION 0x0112
+#define EXIF_TYPE_SHORT 3
+
+static uint8_t exif_buffer[EXIF_SCAN_BYTES];
+
+static uint16_t readU16(const uint8_t *p, bool little_endian)
+{
+  return little_endian ? (p[0] | (p[1] << 8)) : ((p[0] << 8) | p[1]);
+}
+
+static uint32_t readU32(const uint8_t *p, bool little_endian)
+{
+  return little_endian ? (p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24))
+                       : (((uint32_t)p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3]);
+}
+
+// Parses "Exif\0\0" + TIFF header + IFD0 looking for the orientation tag
+static uint8_t parseExifPayload(const uint8_t *data, size_t len)
+{
+  if (len < 14 || memcmp(data, "Exif\0\0", 6) != 0)
+    return EXIF_ORIENTATION_NORMAL;
+
+  const uint8_t *tiff = data + 6;
+  size_t tiff_len = len - 6;
+
+  bool little_endian;
+  if (tiff[0] == 'I' && tiff[1] == 'I')
+    little_endian = true;
+  else if (tiff[0] == 'M' && tiff[1] == 'M')
+    little_endian = false;
+  else
+    return EXIF_ORIENTATION_NORMAL;
+
+  if (readU16(tiff + 2, little_endian) != 0x002A)
+    return EXIF_ORIENTATION_NORMAL;
+
+  // Offsets come from the file, compare them against what is left of the
+  // buffer so a bogus value near 0xFFFFFFFF cannot wrap past the check
+  uint32_t ifd_offset = readU32(tiff + 4, little_endian);
+  if (ifd_offset > tiff_len - 2)
+    return EXIF_ORIENTATION_NORMAL;
+
+  uint16_t entries = readU16(tiff + ifd_offset, little_endian);
+  size_t offset = ifd_offset + 2;
+
+  for (uint16_t i = 0; i < entries; i++, offset += 12)
+  {
+    if (tiff_len - offset < 12)
+      break;
+
+    const uint8_t *entry = tiff + offset;
+
+    if (readU16(entry, little_endian) != EXIF_TAG_ORIENTATION)
+      continue;
+
+    if (readU16(entry + 2, little_endian) != EXIF_TYPE_SHORT)
+      break;
+
+    uint16_t orientation = readU16(entry + 8, little_endian);
+    if (orientation >= EXIF_ORIENTATION_NORMAL && orientation <= EXIF_ORIENTATION_ROTATE_270)
+      return orientation;
+    break;
+  }
+
+  return EXIF_ORIENTATION_NORMAL;
+}
+
+uint8_t readExifOrientation(fs::FS &fs, const char *path)
+{
+  File file = fs.open(path);
+  if (!file)
+    return EXIF_ORIENTATION_NORMAL;
+
+  uint8_t orientation = EXIF_ORIENTATION_NORMAL;
+  uint8_t header[4];
+
+  if (file.read(header, 2) != 2 || header[0] != 0xFF || header[1] != JPEG_MARKER_SOI)
+  {
+    file.close();
+    return orientation;
+  }
+
+  for (int segment = 0; segment < EXIF_MAX_SEGMENTS; segment++)
+  {
+    if (file.read(header, 4) != 4 || header[0] != 0xFF)
+      break;
+
+    uint8_t marker = header[1];
+    uint16_t length = (header[2] << 8) | header[3];
+
+    // Image data starts here, there is no Exif block
+    if (marker == JPEG_MARKER_SOS || length < 2)
+      break;
+
+    if (marker == JPEG_MARKER_APP1)
+    {
+      size_t wanted = min((size_t)(length - 2), (size_t)EXIF_SCAN_BYTES);
+      size_t got = file.read(exif_buffer, wanted);
+      orientation = parseExifPayload(exif_buffer, got);
+
+      // A second APP1 may be XMP, only the first Exif block counts
+      if (got >= 6 && memcmp(exif_buffer, "Exif", 4) == 0)
+        break;
+
+      if (!file.seek(file.position() + (length - 2) - got))
+        break;
+      continue;
+    }
+
+    // Skip over any other segment
+    if (!file.seek(file.position() + length - 2))
+      break;
+  }
+
+  file.close();
+  return orientation;
+}
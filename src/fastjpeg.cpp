@@ -0,0 +1,963 @@
+#include "fastjpeg.h"
+#include "spans.h"
+
+#include <string.h>
+
+#ifdef ARDUINO_ARCH_ESP32
+#include <esp_attr.h>
+#define FASTJPEG_IRAM IRAM_ATTR
+#else
+#define FASTJPEG_IRAM
+#endif
+
+// Codes up to this length are decoded with one table lookup
+#define FAST_BITS 9
+#define FAST_MASK ((1 << FAST_BITS) - 1)
+
+// Largest MCU is 16x16 pixels
+#define MCU_MAX 16
+
+struct HuffTable
+{
+  uint8_t fast[1 << FAST_BITS];     // index into values, 255 = code longer than FAST_BITS
+  int16_t fast_ac[1 << FAST_BITS];  // value << 8 | run << 4 | total bits, 0 = not covered
+  uint16_t code[256];
+  uint8_t values[256];
+  uint8_t size[257];
+  uint32_t maxcode[18];
+  int32_t delta[17];
+};
+
+struct Component
+{
+  uint8_t id;
+  uint8_t h;
+  uint8_t v;
+  uint8_t tq;
+  uint8_t td;
+  uint8_t ta;
+  int32_t dc_pred;
+};
+
+// Natural order index of each zigzag position, padded so that corrupt runs
+// past the end of a block land on the last coefficient
+static const uint8_t dezigzag[64 + 15] = {
+    0, 1, 8, 16, 9, 2, 3, 10,
+    17, 24, 32, 25, 18, 11, 4, 5,
+    12, 19, 26, 33, 40, 48, 41, 34,
+    27, 20, 13, 6, 7, 14, 21, 28,
+    35, 42, 49, 56, 57, 50, 43, 36,
+    29, 22, 15, 23, 30, 37, 44, 51,
+    58, 59, 52, 45, 38, 31, 39, 46,
+    53, 60, 61, 54, 47, 55, 62, 63,
+    63, 63, 63, 63, 63, 63, 63, 63,
+    63, 63, 63, 63, 63, 63, 63};
+
+// AAN scale factors (cos(k*pi/16)*sqrt(2) per axis) in 14-bit fixed point,
+// folded into the quantisation tables so the IDCT needs no extra multiplies
+static const uint16_t aan_scales[64] = {
+    16384, 22725, 21407, 19266, 16384, 12873, 8867, 4520,
+    22725, 31521, 29692, 26722, 22725, 17855, 12299, 6270,
+    21407, 29692, 27969, 25172, 21407, 16819, 11585, 5906,
+    19266, 26722, 25172, 22654, 19266, 15137, 10426, 5315,
+    16384, 22725, 21407, 19266, 16384, 12873, 8867, 4520,
+    12873, 17855, 16819, 15137, 12873, 10114, 6967, 3552,
+    8867, 12299, 11585, 10426, 8867, 6967, 4799, 2446,
+    4520, 6270, 5906, 5315, 4520, 3552, 2446, 1247};
+
+static FastJpegOutputCallback output_callback = nullptr;
+
+// Tables and frame parameters of the current image
+static HuffTable dc_tables[2];
+static HuffTable ac_tables[2];
+static int32_t quant_tables[4][64]; // natural order, AAN-scaled, 2 extra fraction bits
+static Component components[3];
+static int component_count = 0;
+static int max_h = 1;
+static int max_v = 1;
+static uint16_t image_width = 0;
+static uint16_t image_height = 0;
+static uint16_t restart_interval = 0;
+
+// Input, either streamed through read_callback or a memory block
+static FastJpegReadCallback read_callback = nullptr;
+static void *read_context = nullptr;
+static const uint8_t *input_pos = nullptr;
+static const uint8_t *input_end = nullptr;
+static uint8_t input_buffer[FASTJPEG_INPUT_SIZE];
+
+// Entropy decoder bit buffer, left aligned. Once a marker is reached the
+// buffer is padded with zero bits.
+static uint32_t bit_buffer = 0;
+static int bit_count = 0;
+static int marker = 0;
+
+// Decoded MCU planes and the output strip
+static int32_t coefficients[64];
+static uint8_t planes[3][MCU_MAX * MCU_MAX];
+static uint16_t strip[FASTJPEG_STRIP_WIDTH * MCU_MAX];
+
+void fastJpegInit(FastJpegOutputCallback callback)
+{
+  output_callback = callback;
+}
+
+// ====== INPUT ======
+
+static bool refill()
+{
+  if (!read_callback)
+    return false;
+
+  size_t length = read_callback(read_context, input_buffer, sizeof(input_buffer));
+  if (length == 0)
+    return false;
+
+  input_pos = input_buffer;
+  input_end = input_buffer + length;
+  return true;
+}
+
+// Next input byte or -1 at the end of the data
+static inline int readByte()
+{
+  if (input_pos == input_end && !refill())
+    return -1;
+
+  return *input_pos++;
+}
+
+static int readU16()
+{
+  int high = readByte();
+  int low = readByte();
+  if (high < 0 || low < 0)
+    return -1;
+
+  return (high << 8) | low;
+}
+
+static bool skipBytes(int length)
+{
+  while (length > 0)
+  {
+    if (input_pos == input_end && !refill())
+      return false;
+
+    int chunk = input_end - input_pos;
+    if (chunk > length)
+      chunk = length;
+
+    input_pos += chunk;
+    length -= chunk;
+  }
+
+  return true;
+}
+
+// ====== ENTROPY DECODING ======
+
+static bool buildHuffman(HuffTable *table, const uint8_t *counts, const uint8_t *values, int total, bool ac)
+{
+  int k = 0;
+  for (int length = 0; length < 16; length++)
+  {
+    for (int i = 0; i < counts[length]; i++)
+      table->size[k++] = length + 1;
+  }
+  table->size[k] = 0;
+
+  // Canonical codes, maxcode holds the first code past each length left
+  // aligned to 16 bits
+  uint32_t code = 0;
+  k = 0;
+  for (int length = 1; length <= 16; length++)
+  {
+    table->delta[length] = k - code;
+    if (table->size[k] == length)
+    {
+      while (table->size[k] == length)
+        table->code[k++] = code++;
+
+      // More codes than fit in this many bits
+      if (code - 1 >= (1u << length))
+        return false;
+    }
+
+    table->maxcode[length] = code << (16 - length);
+    code <<= 1;
+  }
+  table->maxcode[17] = 0xFFFFFFFF;
+
+  memset(table->fast, 255, sizeof(table->fast));
+  for (int i = 0; i < k; i++)
+  {
+    int length = table->size[i];
+    if (length > FAST_BITS)
+      continue;
+
+    int first = table->code[i] << (FAST_BITS - length);
+    int fill = 1 << (FAST_BITS - length);
+    for (int j = 0; j < fill; j++)
+      table->fast[first + j] = i;
+  }
+
+  memcpy(table->values, values, total);
+
+  if (!ac)
+    return true;
+
+  // A short code followed by a small coefficient is decoded completely
+  // from the lookup index
+  for (int i = 0; i < (1 << FAST_BITS); i++)
+  {
+    table->fast_ac[i] = 0;
+    uint8_t index = table->fast[i];
+    if (index == 255)
+      continue;
+
+    int run_size = table->values[index];
+    int run = run_size >> 4;
+    int magnitude_bits = run_size & 15;
+    int length = table->size[index];
+    if (magnitude_bits == 0 || length + magnitude_bits > FAST_BITS)
+      continue;
+
+    int value = ((i << length) & FAST_MASK) >> (FAST_BITS - magnitude_bits);
+    if (value < (1 << (magnitude_bits - 1)))
+      value -= (1 << magnitude_bits) - 1;
+
+    if (value >= -128 && value <= 127)
+      table->fast_ac[i] = (int16_t)(value * 256 + run * 16 + length + magnitude_bits);
+  }
+
+  return true;
+}
+
+static FASTJPEG_IRAM void fillBits()
+{
+  while (bit_count <= 24)
+  {
+    int byte = 0;
+    if (!marker)
+    {
+      byte = readByte();
+      if (byte < 0)
+      {
+        // Truncated file, the rest decodes as zero bits
+        marker = 0xD9;
+        byte = 0;
+      }
+      else if (byte == 0xFF)
+      {
+        int next = readByte();
+        while (next == 0xFF)
+          next = readByte();
+
+        // 0xFF00 is a stuffed 0xFF data byte, anything else is a marker
+        if (next != 0)
+        {
+          marker = next < 0 ? 0xD9 : next;
+          byte = 0;
+        }
+      }
+    }
+
+    bit_buffer |= (uint32_t)byte << (24 - bit_count);
+    bit_count += 8;
+  }
+}
+
+static FASTJPEG_IRAM int decodeSymbol(const HuffTable *table)
+{
+  if (bit_count < 16)
+    fillBits();
+
+  int index = table->fast[bit_buffer >> (32 - FAST_BITS)];
+  if (index < 255)
+  {
+    int length = table->size[index];
+    bit_buffer <<= length;
+    bit_count -= length;
+    return table->values[index];
+  }
+
+  // Longer codes are found by comparing against the first code past each length
+  uint32_t top = bit_buffer >> 16;
+  int length = FAST_BITS + 1;
+  while (top >= table->maxcode[length])
+    length++;
+
+  if (length == 17)
+    return -1;
+
+  int code = (bit_buffer >> (32 - length)) + table->delta[length];
+  bit_buffer <<= length;
+  bit_count -= length;
+  return table->values[code & 255];
+}
+
+// Dequantised coefficients are kept in 16 bits, so corrupt data cannot
+// overflow the IDCT arithmetic
+static inline int32_t clamp16(int32_t value)
+{
+  if (value > 32767)
+    return 32767;
+  if (value < -32768)
+    return -32768;
+
+  return value;
+}
+
+// Reads a bits-long coefficient and extends its sign
+static FASTJPEG_IRAM int32_t receiveExtend(int bits)
+{
+  if (bit_count < bits)
+    fillBits();
+
+  int32_t value = bit_buffer >> (32 - bits);
+  bit_buffer <<= bits;
+  bit_count -= bits;
+
+  if (value < (1 << (bits - 1)))
+    value -= (1 << bits) - 1;
+
+  return value;
+}
+
+// Decodes and dequantises one block into coefficients. Returns 0 when the
+// block only carries a DC value, 1 otherwise, -1 on corrupt data.
+static FASTJPEG_IRAM int decodeBlock(Component *component)
+{
+  const HuffTable *ac = &ac_tables[component->ta];
+  const int32_t *quant = quant_tables[component->tq];
+
+  // 8-bit samples never need coefficients wider than 11 bits
+  int size = decodeSymbol(&dc_tables[component->td]);
+  if (size < 0 || size > 11)
+    return -1;
+
+  component->dc_pred = clamp16(component->dc_pred + (size ? receiveExtend(size) : 0));
+
+  memset(coefficients, 0, sizeof(coefficients));
+  coefficients[0] = clamp16(component->dc_pred * quant[0]);
+
+  int has_ac = 0;
+  int k = 1;
+  while (k < 64)
+  {
+    if (bit_count < 16)
+      fillBits();
+
+    int fast = ac->fast_ac[bit_buffer >> (32 - FAST_BITS)];
+    if (fast)
+    {
+      k += (fast >> 4) & 15;
+      int length = fast & 15;
+      bit_buffer <<= length;
+      bit_count -= length;
+
+      int zig = dezigzag[k++];
+      coefficients[zig] = clamp16((fast >> 8) * quant[zig]);
+      has_ac = 1;
+      continue;
+    }
+
+    int run_size = decodeSymbol(ac);
+    if (run_size < 0)
+      return -1;
+
+    int bits = run_size & 15;
+    int run = run_size >> 4;
+    if (bits > 11)
+      return -1;
+
+    if (bits == 0)
+    {
+      // End of block, or a run of 16 zeros
+      if (run != 15)
+        break;
+
+      k += 16;
+      continue;
+    }
+
+    k += run;
+    int zig = dezigzag[k++];
+    coefficients[zig] = clamp16(receiveExtend(bits) * quant[zig]);
+    has_ac = 1;
+  }
+
+  return has_ac;
+}
+
+// ====== IDCT ======
+
+// AAN constants in 8-bit fixed point
+#define FIX_1_082392200 277
+#define FIX_1_414213562 362
+#define FIX_1_847759065 473
+#define FIX_2_613125930 669
+
+#define MULTIPLY(v, c) (((v) * (c)) >> 8)
+
+// Output is descaled by 3 bits for the IDCT and 2 bits for the fraction
+// bits of the quantisation tables, rounded and level shifted from the DC term
+#define OUTPUT_SHIFT 5
+#define OUTPUT_BIAS ((128 << OUTPUT_SHIFT) + (1 << (OUTPUT_SHIFT - 1)))
+
+static inline uint8_t clamp8(int32_t value)
+{
+  if ((uint32_t)value > 255)
+    return value < 0 ? 0 : 255;
+
+  return value;
+}
+
+static FASTJPEG_IRAM void fillBlock(uint8_t *out, int stride)
+{
+  uint8_t value = clamp8((coefficients[0] + OUTPUT_BIAS) >> OUTPUT_SHIFT);
+  for (int row = 0; row < 8; row++)
+    memset(out + row * stride, value, 8);
+}
+
+static FASTJPEG_IRAM void idctBlock(uint8_t *out, int stride)
+{
+  int32_t workspace[64];
+
+  // Columns
+  for (int i = 0; i < 8; i++)
+  {
+    const int32_t *in = coefficients + i;
+    int32_t *ws = workspace + i;
+
+    if (in[8] == 0 && in[16] == 0 && in[24] == 0 && in[32] == 0 &&
+        in[40] == 0 && in[48] == 0 && in[56] == 0)
+    {
+      int32_t dc = in[0];
+      ws[0] = ws[8] = ws[16] = ws[24] = ws[32] = ws[40] = ws[48] = ws[56] = dc;
+      continue;
+    }
+
+    // Even part
+    int32_t tmp10 = in[0] + in[32];
+    int32_t tmp11 = in[0] - in[32];
+    int32_t tmp13 = in[16] + in[48];
+    int32_t tmp12 = MULTIPLY(in[16] - in[48], FIX_1_414213562) - tmp13;
+
+    int32_t tmp0 = tmp10 + tmp13;
+    int32_t tmp3 = tmp10 - tmp13;
+    int32_t tmp1 = tmp11 + tmp12;
+    int32_t tmp2 = tmp11 - tmp12;
+
+    // Odd part
+    int32_t z13 = in[40] + in[24];
+    int32_t z10 = in[40] - in[24];
+    int32_t z11 = in[8] + in[56];
+    int32_t z12 = in[8] - in[56];
+
+    int32_t tmp7 = z11 + z13;
+    int32_t z5 = MULTIPLY(z10 + z12, FIX_1_847759065);
+    int32_t tmp6 = MULTIPLY(z10, -FIX_2_613125930) + z5 - tmp7;
+    int32_t tmp5 = MULTIPLY(z11 - z13, FIX_1_414213562) - tmp6;
+    int32_t tmp4 = MULTIPLY(z12, FIX_1_082392200) - z5 + tmp5;
+
+    ws[0] = tmp0 + tmp7;
+    ws[56] = tmp0 - tmp7;
+    ws[8] = tmp1 + tmp6;
+    ws[48] = tmp1 - tmp6;
+    ws[16] = tmp2 + tmp5;
+    ws[40] = tmp2 - tmp5;
+    ws[32] = tmp3 + tmp4;
+    ws[24] = tmp3 - tmp4;
+  }
+
+  // Rows
+  for (int i = 0; i < 8; i++)
+  {
+    const int32_t *ws = workspace + i * 8;
+    uint8_t *o = out + i * stride;
+    int32_t dc = ws[0] + OUTPUT_BIAS;
+
+    if (ws[1] == 0 && ws[2] == 0 && ws[3] == 0 && ws[4] == 0 &&
+        ws[5] == 0 && ws[6] == 0 && ws[7] == 0)
+    {
+      memset(o, clamp8(dc >> OUTPUT_SHIFT), 8);
+      continue;
+    }
+
+    // Even part
+    int32_t tmp10 = dc + ws[4];
+    int32_t tmp11 = dc - ws[4];
+    int32_t tmp13 = ws[2] + ws[6];
+    int32_t tmp12 = MULTIPLY(ws[2] - ws[6], FIX_1_414213562) - tmp13;
+
+    int32_t tmp0 = tmp10 + tmp13;
+    int32_t tmp3 = tmp10 - tmp13;
+    int32_t tmp1 = tmp11 + tmp12;
+    int32_t tmp2 = tmp11 - tmp12;
+
+    // Odd part
+    int32_t z13 = ws[5] + ws[3];
+    int32_t z10 = ws[5] - ws[3];
+    int32_t z11 = ws[1] + ws[7];
+    int32_t z12 = ws[1] - ws[7];
+
+    int32_t tmp7 = z11 + z13;
+    int32_t z5 = MULTIPLY(z10 + z12, FIX_1_847759065);
+    int32_t tmp6 = MULTIPLY(z10, -FIX_2_613125930) + z5 - tmp7;
+    int32_t tmp5 = MULTIPLY(z11 - z13, FIX_1_414213562) - tmp6;
+    int32_t tmp4 = MULTIPLY(z12, FIX_1_082392200) - z5 + tmp5;
+
+    o[0] = clamp8((tmp0 + tmp7) >> OUTPUT_SHIFT);
+    o[7] = clamp8((tmp0 - tmp7) >> OUTPUT_SHIFT);
+    o[1] = clamp8((tmp1 + tmp6) >> OUTPUT_SHIFT);
+    o[6] = clamp8((tmp1 - tmp6) >> OUTPUT_SHIFT);
+    o[2] = clamp8((tmp2 + tmp5) >> OUTPUT_SHIFT);
+    o[5] = clamp8((tmp2 - tmp5) >> OUTPUT_SHIFT);
+    o[4] = clamp8((tmp3 + tmp4) >> OUTPUT_SHIFT);
+    o[3] = clamp8((tmp3 - tmp4) >> OUTPUT_SHIFT);
+  }
+}
+
+// ====== COLOR CONVERSION ======
+
+// RGB565 with the two bytes swapped, so the pixel goes out on the SPI bus as stored
+static inline uint16_t packSwapped(int32_t r, int32_t g, int32_t b)
+{
+  uint8_t r8 = clamp8(r), g8 = clamp8(g), b8 = clamp8(b);
+  return ((r8 & 0xF8) | (g8 >> 5)) | ((((g8 << 3) & 0xE0) | (b8 >> 3)) << 8);
+}
+
+// Converts a w x h region of the MCU planes into the strip at out
+static FASTJPEG_IRAM void convertMcu(uint16_t *out, int w, int h)
+{
+  if (component_count == 1)
+  {
+    for (int py = 0; py < h; py++)
+    {
+      const uint8_t *y_row = planes[0] + py * MCU_MAX;
+      uint16_t *o = out + py * FASTJPEG_STRIP_WIDTH;
+      for (int px = 0; px < w; px++)
+        o[px] = packSwapped(y_row[px], y_row[px], y_row[px]);
+    }
+    return;
+  }
+
+  // Chroma has one sample per max_h x max_v luma pixels
+  int shift_x = max_h - 1;
+  int shift_y = max_v - 1;
+  int chroma_w = (w + shift_x) >> shift_x;
+
+  int32_t r_add[8], g_add[8], b_add[8];
+  int chroma_row = -1;
+
+  for (int py = 0; py < h; py++)
+  {
+    // Chroma terms are computed once per chroma sample
+    if ((py >> shift_y) != chroma_row)
+    {
+      chroma_row = py >> shift_y;
+      const uint8_t *cb_row = planes[1] + chroma_row * MCU_MAX;
+      const uint8_t *cr_row = planes[2] + chroma_row * MCU_MAX;
+
+      for (int cx = 0; cx < chroma_w; cx++)
+      {
+        int32_t cb = cb_row[cx] - 128;
+        int32_t cr = cr_row[cx] - 128;
+        r_add[cx] = (91881 * cr + 32768) >> 16;
+        g_add[cx] = (-22554 * cb - 46802 * cr + 32768) >> 16;
+        b_add[cx] = (116130 * cb + 32768) >> 16;
+      }
+    }
+
+    const uint8_t *y_row = planes[0] + py * MCU_MAX;
+    uint16_t *o = out + py * FASTJPEG_STRIP_WIDTH;
+    for (int px = 0; px < w; px++)
+    {
+      int cx = px >> shift_x;
+      int32_t y = y_row[px];
+      o[px] = packSwapped(y + r_add[cx], y + g_add[cx], y + b_add[cx]);
+    }
+  }
+}
+
+// ====== HEADERS ======
+
+static int parseHeaders()
+{
+  if (readByte() != 0xFF || readByte() != 0xD8)
+    return FASTJPEG_FMT1;
+
+  bool have_frame = false;
+  restart_interval = 0;
+
+  while (true)
+  {
+    int byte = readByte();
+    if (byte < 0)
+      return FASTJPEG_INP;
+    if (byte != 0xFF)
+      return FASTJPEG_FMT1;
+
+    int code = readByte();
+    while (code == 0xFF)
+      code = readByte();
+    if (code < 0)
+      return FASTJPEG_INP;
+
+    int length = readU16();
+    if (code == 0xD9 || length < 2)
+      return FASTJPEG_FMT1;
+    length -= 2;
+
+    switch (code)
+    {
+    case 0xDB: // DQT
+      while (length > 0)
+      {
+        int pq_tq = readByte();
+        int precision = pq_tq >> 4;
+        int id = pq_tq & 15;
+        if (pq_tq < 0 || id > 3)
+          return FASTJPEG_FMT1;
+
+        for (int i = 0; i < 64; i++)
+        {
+          int q = precision ? readU16() : readByte();
+          if (q < 0)
+            return FASTJPEG_INP;
+
+          // 16-bit tables are meant for 12-bit samples
+          if (q > 255)
+            q = 255;
+
+          int natural = dezigzag[i];
+          quant_tables[id][natural] = ((int32_t)q * aan_scales[natural] + (1 << 11)) >> 12;
+        }
+
+        length -= 1 + 64 * (precision ? 2 : 1);
+      }
+      break;
+
+    case 0xC4: // DHT
+      while (length > 0)
+      {
+        int tc_th = readByte();
+        int table_class = tc_th >> 4;
+        int id = tc_th & 15;
+        if (tc_th < 0 || table_class > 1)
+          return FASTJPEG_FMT1;
+        if (id > 1)
+          return FASTJPEG_FMT3;
+
+        uint8_t counts[16];
+        uint8_t values[256];
+        int total = 0;
+        for (int i = 0; i < 16; i++)
+        {
+          int count = readByte();
+          if (count < 0)
+            return FASTJPEG_INP;
+
+          counts[i] = count;
+          total += count;
+        }
+        if (total > 256)
+          return FASTJPEG_FMT1;
+
+        for (int i = 0; i < total; i++)
+        {
+          int value = readByte();
+          if (value < 0)
+            return FASTJPEG_INP;
+
+          values[i] = value;
+        }
+
+        HuffTable *table = table_class ? &ac_tables[id] : &dc_tables[id];
+        if (!buildHuffman(table, counts, values, total, table_class == 1))
+          return FASTJPEG_FMT1;
+
+        length -= 17 + total;
+      }
+      break;
+
+    case 0xC0: // SOF0 baseline
+    case 0xC1: // SOF1 extended sequential, Huffman
+    {
+      if (readByte() != 8)
+        return FASTJPEG_FMT3;
+
+      int height = readU16();
+      int width = readU16();
+      component_count = readByte();
+      if (width <= 0 || height <= 0)
+        return FASTJPEG_FMT1;
+      if (component_count != 1 && component_count != 3)
+        return FASTJPEG_FMT3;
+
+      image_width = width;
+      image_height = height;
+      max_h = 1;
+      max_v = 1;
+      for (int i = 0; i < component_count; i++)
+      {
+        Component &component = components[i];
+        component.id = readByte();
+        int hv = readByte();
+        component.h = hv >> 4;
+        component.v = hv & 15;
+        component.tq = readByte() & 3;
+
+        if (component.h > max_h)
+          max_h = component.h;
+        if (component.v > max_v)
+          max_v = component.v;
+      }
+
+      // A single component scan is coded in single blocks whatever its sampling
+      if (component_count == 1)
+      {
+        components[0].h = components[0].v = 1;
+        max_h = max_v = 1;
+      }
+
+      // Luma up to 2x2 blocks per MCU, chroma one block per MCU
+      if (components[0].h < 1 || components[0].h > 2 || components[0].v < 1 || components[0].v > 2)
+        return FASTJPEG_FMT3;
+
+      for (int i = 1; i < component_count; i++)
+      {
+        if (components[i].h != 1 || components[i].v != 1)
+          return FASTJPEG_FMT3;
+      }
+
+      have_frame = true;
+      break;
+    }
+
+    case 0xC2: // progressive
+    case 0xC3: // lossless
+    case 0xC5:
+    case 0xC6:
+    case 0xC7:
+    case 0xC9: // arithmetic coding
+    case 0xCA:
+    case 0xCB:
+    case 0xCD:
+    case 0xCE:
+    case 0xCF:
+      return FASTJPEG_FMT3;
+
+    case 0xDD: // DRI
+      restart_interval = readU16();
+      break;
+
+    case 0xDA: // SOS
+    {
+      if (!have_frame)
+        return FASTJPEG_FMT1;
+
+      // Only interleaved scans carrying every component
+      if (readByte() != component_count)
+        return FASTJPEG_FMT3;
+
+      for (int i = 0; i < component_count; i++)
+      {
+        int id = readByte();
+        int tables = readByte();
+        if (id != components[i].id || (tables >> 4) > 1 || (tables & 15) > 1)
+          return FASTJPEG_FMT3;
+
+        components[i].td = tables >> 4;
+        components[i].ta = tables & 15;
+      }
+
+      // Spectral selection and approximation are fixed for sequential files
+      if (!skipBytes(3))
+        return FASTJPEG_INP;
+
+      return FASTJPEG_OK;
+    }
+
+    default: // APPn, COM and anything else is skipped
+      if (!skipBytes(length))
+        return FASTJPEG_INP;
+      break;
+    }
+  }
+}
+
+// ====== SCAN ======
+
+// Skips to the next RSTn marker and resets the predictors
+static bool processRestart()
+{
+  bit_buffer = 0;
+  bit_count = 0;
+
+  while (!marker)
+  {
+    int byte = readByte();
+    if (byte < 0)
+      return false;
+    if (byte != 0xFF)
+      continue;
+
+    int next = readByte();
+    while (next == 0xFF)
+      next = readByte();
+    if (next != 0)
+      marker = next < 0 ? 0xD9 : next;
+  }
+
+  if (marker < 0xD0 || marker > 0xD7)
+    return false;
+
+  marker = 0;
+  for (int i = 0; i < component_count; i++)
+    components[i].dc_pred = 0;
+
+  return true;
+}
+
+static bool flushStrip(int32_t x, int32_t y, int used, int h)
+{
+  // Rows are packed to the strip width the callback expects
+  if (used < FASTJPEG_STRIP_WIDTH)
+  {
+    for (int row = 1; row < h; row++)
+      memmove(strip + row * used, strip + row * FASTJPEG_STRIP_WIDTH, used * sizeof(uint16_t));
+  }
+
+  return output_callback(x, y, used, h, strip);
+}
+
+static int decodeScan(int32_t x, int32_t y)
+{
+  int mcu_w = 8 * max_h;
+  int mcu_h = 8 * max_v;
+  int mcus_x = (image_width + mcu_w - 1) / mcu_w;
+  int mcus_y = (image_height + mcu_h - 1) / mcu_h;
+  int restarts_left = restart_interval;
+
+  bit_buffer = 0;
+  bit_count = 0;
+  marker = 0;
+  for (int i = 0; i < component_count; i++)
+    components[i].dc_pred = 0;
+
+  for (int my = 0; my < mcus_y; my++)
+  {
+    int h = image_height - my * mcu_h;
+    if (h > mcu_h)
+      h = mcu_h;
+
+    int strip_x = 0;
+    int used = 0;
+
+    for (int mx = 0; mx < mcus_x; mx++)
+    {
+      if (restart_interval)
+      {
+        if (restarts_left == 0)
+        {
+          if (!processRestart())
+            return FASTJPEG_FMT1;
+          restarts_left = restart_interval;
+        }
+        restarts_left--;
+      }
+
+      for (int i = 0; i < component_count; i++)
+      {
+        Component *component = &components[i];
+        for (int v = 0; v < component->v; v++)
+        {
+          for (int hb = 0; hb < component->h; hb++)
+          {
+            int result = decodeBlock(component);
+            if (result < 0)
+              return FASTJPEG_FMT1;
+
+            uint8_t *out = planes[i] + v * 8 * MCU_MAX + hb * 8;
+            if (result)
+              idctBlock(out, MCU_MAX);
+            else
+              fillBlock(out, MCU_MAX);
+          }
+        }
+      }
+
+      int w = image_width - mx * mcu_w;
+      if (w > mcu_w)
+        w = mcu_w;
+
+      if (used + w > FASTJPEG_STRIP_WIDTH)
+      {
+        if (!flushStrip(x + strip_x, y + my * mcu_h, used, h))
+          return FASTJPEG_INTR;
+        strip_x += used;
+        used = 0;
+      }
+
+      convertMcu(strip + used, w, h);
+      used += w;
+    }
+
+    if (!flushStrip(x + strip_x, y + my * mcu_h, used, h))
+      return FASTJPEG_INTR;
+  }
+
+  return FASTJPEG_OK;
+}
+
+// ====== PUBLIC ======
+
+static int decode(int32_t x, int32_t y)
+{
+  if (!output_callback)
+    return FASTJPEG_PAR;
+
+  int result = parseHeaders();
+  if (result != FASTJPEG_OK)
+    return result;
+
+  return decodeScan(x, y);
+}
+
+int fastJpegDecode(FastJpegReadCallback read, void *context, int32_t x, int32_t y)
+{
+  read_callback = read;
+  read_context = context;
+  input_pos = input_end = nullptr;
+  return decode(x, y);
+}
+
+int fastJpegDrawMem(int32_t x, int32_t y, const uint8_t *data, size_t size)
+{
+  read_callback = nullptr;
+  input_pos = data;
+  input_end = data + size;
+  return decode(x, y);
+}
+
+#ifdef ARDUINO
+static size_t readFile(void *context, uint8_t *buffer, size_t length)
+{
+  SPAN("sd read");
+  return ((fs::File *)context)->read(buffer, length);
+}
+
+int fastJpegDrawFs(int32_t x, int32_t y, const char *path, fs::FS &fs)
+{
+  fs::File file = fs.open(path);
+  if (!file)
+    return FASTJPEG_INP;
+
+  int result = fastJpegDecode(readFile, &file, x, y);
+  file.close();
+  return result;
+}
+#endif
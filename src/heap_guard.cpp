@@ -0,0 +1,132 @@
+#include "heap_guard.h"
+
+#ifdef HEAP_GUARD
+
+#include <atomic>
+#include <esp_heap_caps.h>
+
+// Print every slide normally, but only every this many slides during a soak
+#define SOAK_REPORT_INTERVAL 1000
+
+static std::atomic<uint32_t> allocations(0);
+static volatile bool armed = false;
+
+extern "C"
+{
+  void *__real_malloc(size_t size);
+  void *__real_calloc(size_t count, size_t size);
+  void *__real_realloc(void *ptr, size_t size);
+
+  void *__wrap_malloc(size_t size)
+  {
+    if (armed)
+      allocations++;
+    return __real_malloc(size);
+  }
+
+  void *__wrap_calloc(size_t count, size_t size)
+  {
+    if (armed)
+      allocations++;
+    return __real_calloc(count, size);
+  }
+
+  void *__wrap_realloc(void *ptr, size_t size)
+  {
+    if (armed)
+      allocations++;
+    return __real_realloc(ptr, size);
+  }
+}
+
+static uint32_t slides = 0;
+static uint32_t last_allocations = 0;
+static uint32_t baseline = 0;     // most allocations of a calibration slide
+static uint32_t over_baseline = 0; // later slides that allocated more
+static size_t armed_blocks = 0;
+static size_t armed_largest = 0;
+static size_t min_largest = 0;
+static size_t max_largest = 0;
+
+// Report lines are formatted here, Serial.printf() mallocs for long lines
+static char report[160];
+
+void heapGuardArm()
+{
+  if (armed)
+    return;
+
+  multi_heap_info_t info;
+  heap_caps_get_info(&info, MALLOC_CAP_8BIT);
+  armed_blocks = info.allocated_blocks;
+  armed_largest = info.largest_free_block;
+  min_largest = armed_largest;
+  max_largest = armed_largest;
+
+  allocations = 0;
+  armed = true;
+
+  snprintf(report, sizeof(report), "Heap guard armed: %u blocks held, largest free block %u\n",
+           (unsigned)armed_blocks, (unsigned)armed_largest);
+  Serial.print(report);
+}
+
+void heapGuardReport()
+{
+  if (!armed)
+    return;
+
+  slides++;
+
+  multi_heap_info_t info;
+  heap_caps_get_info(&info, MALLOC_CAP_8BIT);
+  min_largest = min(min_largest, info.largest_free_block);
+  max_largest = max(max_largest, info.largest_free_block);
+
+  uint32_t total = allocations;
+  uint32_t this_slide = total - last_allocations;
+  last_allocations = total;
+
+  if (slides <= HEAP_GUARD_BASELINE_SLIDES)
+  {
+    baseline = max(baseline, this_slide);
+    if (slides == HEAP_GUARD_BASELINE_SLIDES)
+    {
+      snprintf(report, sizeof(report), "Heap guard baseline: %u allocs per slide\n", (unsigned)baseline);
+      Serial.print(report);
+    }
+  }
+  else if (this_slide > baseline)
+  {
+    over_baseline++;
+    snprintf(report, sizeof(report), "Heap guard FAIL: slide %u made %u allocs, baseline %u\n",
+             (unsigned)slides, (unsigned)this_slide, (unsigned)baseline);
+    Serial.print(report);
+  }
+
+  if (HEAP_SOAK_SLIDES == 0 || slides % SOAK_REPORT_INTERVAL == 0)
+  {
+    snprintf(report, sizeof(report),
+             "Heap guard: slide %u, %u allocs (%u this slide), %d blocks held vs boot, largest free %u (min %u, max %u)\n",
+             (unsigned)slides, (unsigned)total, (unsigned)this_slide,
+             (int)info.allocated_blocks - (int)armed_blocks,
+             (unsigned)info.largest_free_block, (unsigned)min_largest, (unsigned)max_largest);
+    Serial.print(report);
+  }
+
+  if (HEAP_SOAK_SLIDES > 0 && slides == HEAP_SOAK_SLIDES)
+  {
+    snprintf(report, sizeof(report),
+             "Soak finished after %u slides: largest free block %u at start, %u min -> %s, %u slides over the baseline\n",
+             (unsigned)slides, (unsigned)armed_largest, (unsigned)min_largest,
+             min_largest >= armed_largest ? "FLAT" : "SHRANK", (unsigned)over_baseline);
+    Serial.print(report);
+  }
+}
+
+bool heapSoakRunning()
+{
+  return armed && slides < HEAP_SOAK_SLIDES;
+}
+
+#endif
@@ -0,0 +1,282 @@
+#include "input_trace.h"
+
+#ifdef INPUT_TRACE
+
+#include <algorithm>
+#include "spans.h"
+
+#define TRACE_MAX_EVENTS 1024
+#define TRACE_LINE_MAX 64
+
+#define LATENCY_MAX_TYPES 12
+#define LATENCY_MAX_SAMPLES 64
+
+// Replay ends this long after the last event, then the report is printed
+#define REPLAY_SETTLE_TIME 3000
+
+struct TraceEvent
+{
+  uint32_t at; // ms from the start of the trace
+  uint16_t x;
+  uint16_t y;
+  uint16_t z; // touch pressure, 0 = released
+  bool button;
+};
+
+struct LatencyType
+{
+  const char *name;
+  uint16_t count;
+  uint16_t first_pixel[LATENCY_MAX_SAMPLES];
+  uint16_t complete[LATENCY_MAX_SAMPLES];
+};
+
+static TraceEvent trace[TRACE_MAX_EVENTS];
+static int trace_length = 0;
+static bool collecting = false;
+static bool replaying = false;
+static bool recording = false;
+static unsigned long replay_started_at = 0;
+
+static char line[TRACE_LINE_MAX];
+static size_t line_length = 0;
+
+// Live state, used for recording and for press detection
+static bool touch_down = false;
+static bool button_down = false;
+static unsigned long record_started_at = 0;
+
+// Latest press and the reaction it is waiting for
+static unsigned long pressed_at = 0;
+static int pending_type = -1;
+static unsigned long first_pixel_at = 0;
+
+static LatencyType types[LATENCY_MAX_TYPES];
+static int type_count = 0;
+
+// Touch and button state of the trace at the current time
+static bool replayState(bool button, uint16_t *x, uint16_t *y, unsigned long *event_at)
+{
+  unsigned long now = millis() - replay_started_at;
+  bool down = false;
+
+  for (int i = 0; i < trace_length && trace[i].at <= now; i++)
+  {
+    if (trace[i].button != button)
+      continue;
+
+    down = trace[i].z > 0;
+    if (x)
+    {
+      *x = trace[i].x;
+      *y = trace[i].y;
+    }
+    *event_at = replay_started_at + trace[i].at;
+  }
+
+  return down;
+}
+
+static void recordEvent(char kind, uint16_t x, uint16_t y, uint16_t z)
+{
+  if (!recording)
+    return;
+
+  if (kind == 'T')
+    Serial.printf("T %lu %u %u %u\n", millis() - record_started_at, x, y, z);
+  else
+    Serial.printf("B %lu %u\n", millis() - record_started_at, z);
+}
+
+bool inputGetTouch(TFT_eSPI &tft, uint16_t *x, uint16_t *y)
+{
+  bool down;
+  unsigned long event_at = millis();
+
+  if (replaying)
+  {
+    down = replayState(false, x, y, &event_at);
+  }
+  else
+  {
+    down = tft.getTouch(x, y, 600);
+    if (down != touch_down)
+      recordEvent('T', *x, *y, down ? 1 : 0);
+  }
+
+  // Latency is measured from the moment the finger comes down
+  if (down && !touch_down)
+    pressed_at = event_at;
+
+  touch_down = down;
+  return down;
+}
+
+bool inputButtonPressed(uint8_t pin)
+{
+  bool down;
+  unsigned long event_at = millis();
+
+  if (replaying)
+  {
+    down = replayState(true, nullptr, nullptr, &event_at);
+  }
+  else
+  {
+    down = digitalRead(pin) == LOW;
+    if (down != button_down)
+      recordEvent('B', 0, 0, down ? 1 : 0);
+  }
+
+  if (down && !button_down)
+    pressed_at = event_at;
+
+  button_down = down;
+  return down;
+}
+
+static void handleLine()
+{
+  unsigned long at;
+  unsigned int x, y, z;
+
+  if (strcmp(line, "RECORD") == 0)
+  {
+    recording = true;
+    record_started_at = millis();
+  }
+  else if (strcmp(line, "REPLAY BEGIN") == 0)
+  {
+    collecting = true;
+    replaying = false;
+    trace_length = 0;
+  }
+  else if (strcmp(line, "REPLAY END") == 0)
+  {
+    collecting = false;
+    replaying = trace_length > 0;
+    replay_started_at = millis();
+    Serial.printf("Replaying %d events\n", trace_length);
+  }
+  else if (strcmp(line, "REPORT") == 0)
+  {
+    latencyReport();
+  }
+  else if (strcmp(line, "RESET") == 0)
+  {
+    type_count = 0;
+  }
+  else if (strcmp(line, "SPANS") == 0)
+  {
+    spanDump();
+  }
+  else if (collecting && trace_length < TRACE_MAX_EVENTS && sscanf(line, "T %lu %u %u %u", &at, &x, &y, &z) == 4)
+  {
+    trace[trace_length++] = {(uint32_t)at, (uint16_t)x, (uint16_t)y, (uint16_t)z, false};
+  }
+  else if (collecting && trace_length < TRACE_MAX_EVENTS && sscanf(line, "B %lu %u", &at, &z) == 2)
+  {
+    trace[trace_length++] = {(uint32_t)at, 0, 0, (uint16_t)z, true};
+  }
+}
+
+void inputTraceTick()
+{
+  while (Serial.available())
+  {
+    int c = Serial.read();
+
+    if (c == '\n' || c == '\r')
+    {
+      line[line_length] = '\0';
+      if (line_length > 0)
+        handleLine();
+      line_length = 0;
+    }
+    else if (line_length < TRACE_LINE_MAX - 1)
+    {
+      line[line_length++] = c;
+    }
+  }
+
+  if (replaying && millis() - replay_started_at > trace[trace_length - 1].at + REPLAY_SETTLE_TIME)
+  {
+    replaying = false;
+    Serial.println("Replay finished");
+    latencyReport();
+  }
+}
+
+static int findType(const char *name)
+{
+  for (int i = 0; i < type_count; i++)
+  {
+    if (strcmp(types[i].name, name) == 0)
+      return i;
+  }
+
+  if (type_count >= LATENCY_MAX_TYPES)
+    return -1;
+
+  types[type_count].name = name;
+  types[type_count].count = 0;
+  return type_count++;
+}
+
+void latencyGesture(const char *type)
+{
+  pending_type = findType(type);
+  first_pixel_at = 0;
+}
+
+void latencyFirstPixel()
+{
+  if (pending_type >= 0 && first_pixel_at == 0)
+    first_pixel_at = millis();
+}
+
+void latencyComplete()
+{
+  if (pending_type < 0)
+    return;
+
+  unsigned long now = millis();
+  if (first_pixel_at == 0)
+    first_pixel_at = now;
+
+  LatencyType &type = types[pending_type];
+  int slot = type.count % LATENCY_MAX_SAMPLES;
+  type.first_pixel[slot] = min(first_pixel_at - pressed_at, 65535UL);
+  type.complete[slot] = min(now - pressed_at, 65535UL);
+  type.count++;
+
+  pending_type = -1;
+}
+
+static void printDistribution(const char *label, const uint16_t *samples, int count)
+{
+  uint16_t sorted[LATENCY_MAX_SAMPLES];
+  memcpy(sorted, samples, count * sizeof(uint16_t));
+  std::sort(sorted, sorted + count);
+
+  Serial.printf("    %-14s min %5u  p50 %5u  p90 %5u  max %5u ms\n", label,
+                sorted[0], sorted[count / 2], sorted[(count * 9) / 10], sorted[count - 1]);
+}
+
+void latencyReport()
+{
+  Serial.println("Touch-to-photon latency:");
+
+  for (int i = 0; i < type_count; i++)
+  {
+    int count = min((int)types[i].count, LATENCY_MAX_SAMPLES);
+    if (count == 0)
+      continue;
+
+    Serial.printf("  %s (%d samples)\n", types[i].name, count);
+    printDistribution("first pixel", types[i].first_pixel, count);
+    printDistribution("complete", types[i].complete, count);
+  }
+}
+
+#endif
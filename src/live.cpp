@@ -0,0 +1,389 @@
+#include "live.h"
+#include "upload.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define RUN_MIN 2
+#define RUN_MAX (0x7F + RUN_MIN)
+#define LITERAL_MAX 0x80
+
+static_assert(LIVE_TILE_HEADER + UPLOAD_CHUNK + 16 <= UPLOAD_MAX_FRAME, "a TILE fragment must fit in a frame");
+static_assert(LIVE_TILE_SIDE <= 255, "tile sides are sent as one byte");
+
+// ====== RLE ======
+
+size_t liveRleEncode(const uint16_t *pixels, size_t count, uint8_t *out, size_t out_length)
+{
+  size_t pos = 0, written = 0;
+
+  while (pos < count)
+  {
+    size_t run = 1;
+    while (pos + run < count && run < RUN_MAX && pixels[pos + run] == pixels[pos])
+      run++;
+
+    if (run >= RUN_MIN)
+    {
+      if (written + 3 > out_length)
+        return 0;
+      out[written++] = 0x80 | (run - RUN_MIN);
+      memcpy(out + written, pixels + pos, 2);
+      written += 2;
+      pos += run;
+      continue;
+    }
+
+    // Literals up to the next pair of equal pixels
+    size_t literals = 1;
+    while (pos + literals < count && literals < LITERAL_MAX &&
+           !(pos + literals + 1 < count && pixels[pos + literals] == pixels[pos + literals + 1]))
+      literals++;
+
+    if (written + 1 + literals * 2 > out_length)
+      return 0;
+    out[written++] = literals - 1;
+    memcpy(out + written, pixels + pos, literals * 2);
+    written += literals * 2;
+    pos += literals;
+  }
+
+  return written;
+}
+
+bool liveRleDecode(const uint8_t *data, size_t length, uint16_t *pixels, size_t count)
+{
+  size_t pos = 0, written = 0;
+
+  while (pos < length)
+  {
+    uint8_t token = data[pos++];
+    if (token < 0x80)
+    {
+      size_t run = token + 1;
+      if (pos + run * 2 > length || written + run > count)
+        return false;
+      memcpy(pixels + written, data + pos, run * 2);
+      pos += run * 2;
+      written += run;
+    }
+    else
+    {
+      size_t run = (token & 0x7F) + RUN_MIN;
+      if (pos + 2 > length || written + run > count)
+        return false;
+      uint16_t pixel;
+      memcpy(&pixel, data + pos, 2);
+      pos += 2;
+      for (size_t i = 0; i < run; i++)
+        pixels[written++] = pixel;
+    }
+  }
+
+  return written == count;
+}
+
+// ====== RECEIVER ======
+
+static UploadParser parser;
+static uint8_t frame_out[64 + LIVE_FRAME_TILES / 8];
+
+// Allocated for the length of a session
+static uint8_t *tile_data = nullptr;
+static uint16_t *tile_pixels[2] = {nullptr, nullptr};
+static int next_pixels = 0;
+
+// Frame being assembled
+static bool frame_open = false;
+static uint16_t frame_number = 0;
+static uint16_t frame_tiles = 0; // tiles the frame carries
+static uint16_t frame_drawn = 0;
+static uint8_t frame_drawn_bits[LIVE_FRAME_TILES / 8]; // by tile index, reported back
+static uint32_t frame_busy_us = 0;
+
+// Tile being assembled, tile_filled is -1 while skipping a broken one
+static int32_t tile_filled = -1;
+static uint16_t tile_index, tile_x, tile_y, tile_total;
+static uint8_t tile_w, tile_h, tile_format;
+
+// Last FRAME_ACK, sent again when the host repeats an END
+static uint8_t frame_ack[13 + LIVE_FRAME_TILES / 8];
+static size_t frame_ack_length = 0;
+
+static uint32_t consumed = 0; // bytes read off the port since the session opened
+static uint32_t acked = 0;    // consumed, as last reported to the host
+
+static void send(const LiveIo &io, uint8_t type, const uint8_t *payload, size_t length)
+{
+  io.write(io.context, frame_out, uploadEncodeFrame(type, payload, length, frame_out));
+}
+
+static void sendAck(const LiveIo &io)
+{
+  uint8_t payload[4];
+  uploadPut32(payload, consumed);
+  send(io, LIVE_ACK, payload, sizeof(payload));
+  acked = consumed;
+}
+
+static void finishFrame(const LiveIo &io, LiveStats *stats)
+{
+  bool damaged = frame_drawn != frame_tiles;
+  size_t bitmap_bytes = (frame_tiles + 7) / 8;
+
+  uploadPut16(frame_ack, frame_number);
+  frame_ack[2] = damaged ? LIVE_FRAME_DAMAGED : LIVE_FRAME_OK;
+  uploadPut32(frame_ack + 3, consumed);
+  uploadPut32(frame_ack + 7, frame_busy_us);
+  uploadPut16(frame_ack + 11, frame_tiles);
+  memcpy(frame_ack + 13, frame_drawn_bits, bitmap_bytes);
+  frame_ack_length = 13 + bitmap_bytes;
+  send(io, LIVE_FRAME_ACK, frame_ack, frame_ack_length);
+  acked = consumed;
+
+  stats->frames++;
+  if (damaged)
+    stats->damaged++;
+  frame_open = false;
+}
+
+static void drawTile(const LiveIo &io, LiveStats *stats)
+{
+  uint32_t started_at = io.micros(io.context);
+  bool drawn;
+
+  if (tile_format == LIVE_FORMAT_JPEG)
+  {
+    drawn = io.draw_jpeg(io.context, tile_x, tile_y, tile_data, tile_total);
+  }
+  else
+  {
+    uint16_t *pixels = tile_pixels[next_pixels];
+    drawn = liveRleDecode(tile_data, tile_total, pixels, (size_t)tile_w * tile_h);
+    if (drawn)
+    {
+      io.draw_pixels(io.context, tile_x, tile_y, tile_w, tile_h, pixels);
+      next_pixels ^= 1;
+    }
+  }
+
+  uint32_t busy_us = io.micros(io.context) - started_at;
+  frame_busy_us += busy_us;
+  stats->busy_us += busy_us;
+  if (drawn)
+  {
+    frame_drawn_bits[tile_index / 8] |= 1 << (tile_index % 8);
+    frame_drawn++;
+    stats->tiles++;
+  }
+}
+
+static void handleTile(const LiveIo &io, const uint8_t *payload, size_t length, int16_t width, int16_t height,
+                       LiveStats *stats)
+{
+  if (length < LIVE_TILE_HEADER)
+    return;
+
+  uint16_t number = uploadGet16(payload);
+  uint16_t tiles = uploadGet16(payload + 2);
+  uint16_t index = uploadGet16(payload + 4);
+  uint16_t x = uploadGet16(payload + 6);
+  uint16_t y = uploadGet16(payload + 8);
+  uint8_t w = payload[10];
+  uint8_t h = payload[11];
+  uint8_t format = payload[12];
+  uint16_t offset = uploadGet16(payload + 14);
+  uint16_t total = uploadGet16(payload + 16);
+  const uint8_t *data = payload + LIVE_TILE_HEADER;
+  size_t data_length = length - LIVE_TILE_HEADER;
+
+  if (!frame_open || number != frame_number)
+  {
+    // Tiles of a newer frame, whatever is missing from this one is not coming
+    if (frame_open)
+      finishFrame(io, stats);
+
+    frame_open = true;
+    frame_number = number;
+    frame_tiles = tiles < LIVE_FRAME_TILES ? tiles : LIVE_FRAME_TILES;
+    frame_drawn = 0;
+    memset(frame_drawn_bits, 0, sizeof(frame_drawn_bits));
+    frame_busy_us = 0;
+    tile_filled = -1;
+  }
+
+  bool valid = index < frame_tiles && w > 0 && h > 0 && w <= LIVE_TILE_SIDE && h <= LIVE_TILE_SIDE && x + w <= width && y + h <= height &&
+               (format == LIVE_FORMAT_JPEG || format == LIVE_FORMAT_RLE) && total <= LIVE_TILE_BYTES &&
+               offset + data_length <= total;
+
+  if (valid && offset == 0)
+  {
+    tile_index = index;
+    tile_x = x;
+    tile_y = y;
+    tile_w = w;
+    tile_h = h;
+    tile_format = format;
+    tile_total = total;
+    tile_filled = 0;
+  }
+
+  // A fragment went missing or does not belong to the tile in progress,
+  // the tile is left out of the bitmap and the host sends it again
+  if (!valid || tile_filled < 0 || (uint32_t)tile_filled != offset || index != tile_index || total != tile_total)
+  {
+    tile_filled = -1;
+  }
+  else
+  {
+    memcpy(tile_data + offset, data, data_length);
+    tile_filled += data_length;
+
+    if ((uint32_t)tile_filled == tile_total)
+    {
+      drawTile(io, stats);
+      tile_filled = -1;
+    }
+  }
+}
+
+static void handleEnd(const LiveIo &io, const uint8_t *payload, size_t length, LiveStats *stats)
+{
+  if (length < 2)
+    return;
+
+  uint16_t number = uploadGet16(payload);
+  if (frame_open && number == frame_number)
+  {
+    finishFrame(io, stats);
+  }
+  else if (frame_ack_length && number == uploadGet16(frame_ack))
+  {
+    // The FRAME_ACK went missing, the host asks again
+    uploadPut32(frame_ack + 3, consumed);
+    send(io, LIVE_FRAME_ACK, frame_ack, frame_ack_length);
+    acked = consumed;
+  }
+}
+
+static void freeBuffers()
+{
+  free(tile_data);
+  free(tile_pixels[0]);
+  free(tile_pixels[1]);
+  tile_data = nullptr;
+  tile_pixels[0] = tile_pixels[1] = nullptr;
+}
+
+bool liveRun(const LiveIo &io, uint32_t requested_baud, int16_t width, int16_t height, LiveStats *stats)
+{
+  uint32_t baud = requested_baud;
+  if (baud > UPLOAD_MAX_BAUD)
+    baud = UPLOAD_MAX_BAUD;
+  if (baud < UPLOAD_DEFAULT_BAUD)
+    baud = UPLOAD_DEFAULT_BAUD;
+
+  memset(stats, 0, sizeof(*stats));
+  stats->baud = baud;
+
+  size_t pixel_bytes = LIVE_TILE_SIDE * LIVE_TILE_SIDE * sizeof(uint16_t);
+  tile_data = (uint8_t *)malloc(LIVE_TILE_BYTES);
+  tile_pixels[0] = (uint16_t *)malloc(pixel_bytes);
+  tile_pixels[1] = (uint16_t *)malloc(pixel_bytes);
+  if (!tile_data || !tile_pixels[0] || !tile_pixels[1])
+  {
+    freeBuffers();
+    uint8_t status = LIVE_STATUS_MEMORY;
+    send(io, UPLOAD_ERROR, &status, 1);
+    return false;
+  }
+
+  uint32_t started_at = io.millis(io.context);
+
+  // Whatever else writes to the port stops before the sender hears back
+  if (io.event)
+    io.event(io.context, LIVE_EVENT_START);
+
+  // Accepted baud, panel size and the limits the sender keeps within
+  uint8_t ack[13];
+  uploadPut32(ack, baud);
+  uploadPut16(ack + 4, width);
+  uploadPut16(ack + 6, height);
+  ack[8] = LIVE_TILE_SIDE;
+  uploadPut16(ack + 9, LIVE_TILE_BYTES);
+  uploadPut16(ack + 11, LIVE_WINDOW_BYTES);
+  send(io, LIVE_HELLO_ACK, ack, sizeof(ack));
+
+  io.set_baud(io.context, baud);
+  uploadParserReset(parser);
+  parser.crc_errors = 0;
+
+  frame_open = false;
+  frame_ack_length = 0;
+  tile_filled = -1;
+  next_pixels = 0;
+  consumed = 0;
+  acked = 0;
+
+  uint32_t last_frame_at = io.millis(io.context);
+  bool done = false;
+  uint8_t buffer[256];
+
+  while (!done && io.millis(io.context) - last_frame_at < LIVE_IDLE_TIMEOUT)
+  {
+    size_t length = io.read(io.context, buffer, sizeof(buffer));
+    if (length == 0)
+    {
+      // Caught up, let the host fill the window again
+      if (consumed != acked)
+        sendAck(io);
+      continue;
+    }
+    consumed += length;
+
+    for (size_t i = 0; i < length && !done; i++)
+    {
+      if (!uploadParse(parser, buffer[i]))
+        continue;
+
+      last_frame_at = io.millis(io.context);
+      switch (parser.type)
+      {
+      case LIVE_TILE:
+        handleTile(io, parser.payload, parser.payload_length, width, height, stats);
+        break;
+      case LIVE_END:
+        handleEnd(io, parser.payload, parser.payload_length, stats);
+        break;
+      case UPLOAD_PING:
+        sendAck(io);
+        break;
+      case LIVE_BYE:
+        send(io, LIVE_BYE_ACK, nullptr, 0);
+        done = true;
+        break;
+      default:
+        break;
+      }
+    }
+
+    if (consumed - acked >= LIVE_ACK_INTERVAL)
+      sendAck(io);
+  }
+
+  // A frame cut short by the end of the session never made it to the panel
+  if (frame_open)
+  {
+    stats->frames++;
+    stats->damaged++;
+  }
+
+  io.set_baud(io.context, UPLOAD_DEFAULT_BAUD);
+  stats->wire_bytes = consumed;
+  stats->elapsed_ms = io.millis(io.context) - started_at;
+  freeBuffers();
+
+  if (io.event)
+    io.event(io.context, LIVE_EVENT_END);
+  return true;
+}
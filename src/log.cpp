@@ -0,0 +1,145 @@
+#include "log.h"
+#include <atomic>
+#include <stdarg.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+#define LOG_DRAIN_INTERVAL_MS 10
+
+static_assert((LOG_SLOTS & (LOG_SLOTS - 1)) == 0, "LOG_SLOTS must be a power of two");
+
+// Bounded multi-producer queue: a slot is free for the producer holding
+// ticket n when its sequence equals n, and holds a message for the consumer
+// when it equals n + 1
+struct LogSlot
+{
+  std::atomic<uint32_t> sequence;
+  char line[LOG_LINE_MAX];
+};
+
+static LogSlot slots[LOG_SLOTS];
+static std::atomic<uint32_t> enqueue_ticket(0);
+static uint32_t dequeue_ticket = 0; // only touched by the drain task
+static std::atomic<uint32_t> dropped(0);
+static std::atomic<bool> paused(false);
+static std::atomic<bool> printing(false); // the drain task is inside a Serial call
+
+// Claims the port for one write, false once a pause has been requested.
+// Paired with the check in logPause(): the flag is set before paused is
+// read there, paused is set before the flag is read here, so one of the
+// two always sees the other.
+static bool beginPrint()
+{
+  printing.store(true);
+  if (!paused.load())
+    return true;
+
+  printing.store(false);
+  return false;
+}
+
+static void endPrint()
+{
+  printing.store(false);
+}
+
+static void logDrainTask(void *param)
+{
+  uint32_t reported_drops = 0;
+
+  while (true)
+  {
+    while (true)
+    {
+      LogSlot &slot = slots[dequeue_ticket & (LOG_SLOTS - 1)];
+      if (slot.sequence.load(std::memory_order_acquire) != dequeue_ticket + 1)
+        break;
+      if (!beginPrint())
+        break;
+
+      Serial.print(slot.line);
+      endPrint();
+      slot.sequence.store(dequeue_ticket + LOG_SLOTS, std::memory_order_release);
+      dequeue_ticket++;
+    }
+
+    uint32_t drops = dropped.load(std::memory_order_relaxed);
+    if (drops != reported_drops && beginPrint())
+    {
+      Serial.printf("[log] %lu messages dropped\n", (unsigned long)(drops - reported_drops));
+      endPrint();
+      reported_drops = drops;
+    }
+
+    vTaskDelay(pdMS_TO_TICKS(LOG_DRAIN_INTERVAL_MS));
+  }
+}
+
+void logBegin()
+{
+  for (uint32_t i = 0; i < LOG_SLOTS; i++)
+    slots[i].sequence.store(i, std::memory_order_relaxed);
+
+  // Below the slideshow loop, on the core it does not run on
+  xTaskCreatePinnedToCore(logDrainTask, "log", 3072, NULL, 0, NULL, 0);
+}
+
+void logWrite(const char *format, ...)
+{
+  uint32_t ticket = enqueue_ticket.load(std::memory_order_relaxed);
+  LogSlot *slot;
+
+  while (true)
+  {
+    slot = &slots[ticket & (LOG_SLOTS - 1)];
+    int32_t lag = (int32_t)(slot->sequence.load(std::memory_order_acquire) - ticket);
+
+    if (lag == 0)
+    {
+      if (enqueue_ticket.compare_exchange_weak(ticket, ticket + 1, std::memory_order_relaxed))
+        break;
+    }
+    else if (lag < 0)
+    {
+      // The drain task has not written this slot out yet
+      dropped.fetch_add(1, std::memory_order_relaxed);
+      return;
+    }
+    else
+    {
+      ticket = enqueue_ticket.load(std::memory_order_relaxed);
+    }
+  }
+
+  va_list args;
+  va_start(args, format);
+  int length = vsnprintf(slot->line, LOG_LINE_MAX - 1, format, args);
+  va_end(args);
+
+  if (length < 0)
+    length = 0;
+  else if (length > LOG_LINE_MAX - 2)
+    length = LOG_LINE_MAX - 2;
+
+  slot->line[length] = '\n';
+  slot->line[length + 1] = '\0';
+  slot->sequence.store(ticket + 1, std::memory_order_release);
+}
+
+void logPause(bool pause)
+{
+  paused.store(pause);
+  if (!pause)
+    return;
+
+  // A line the drain task already started is finished before the caller
+  // gets the port, and is on the wire before it returns
+  while (printing.load())
+    vTaskDelay(1);
+  Serial.flush();
+}
+
+uint32_t logDropped()
+{
+  return dropped.load(std::memory_order_relaxed);
+}
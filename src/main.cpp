@@ -28,25 +28,72 @@ unsigned long IMAGE_LIFETIME = delay_configs[0].delay;
 #define BUTTON_DEBOUNCE 300  // Button debounce time in milliseconds
 #define TOUCH_DEBOUNCE 150   // Touch debounce time
 #define MULTI_TAP_WINDOW 500 // Time window for detecting multiple taps (milliseconds)
-
-// Screen area config
-#define SCREEN_WIDTH 480
-#define SCREEN_HEIGHT 320
-
-#define SCREEN_CENTER_X SCREEN_WIDTH / 2
-#define SCREEN_CENTER_Y SCREEN_HEIGHT / 2
-
-#define TOUCH_SECTIONS SCREEN_WIDTH / 3
-#define CENTER_TOUCH_LEFT TOUCH_SECTIONS * 1  // Left boundary of center area
-#define CENTER_TOUCH_RIGHT TOUCH_SECTIONS * 2 // Right boundary of center area
+#define PAN_THRESHOLD 20     // Drag distance in pixels that pans a large photo instead of tapping
+#define LONG_PRESS_TIME 800  // Hold time in the center that zooms a large photo in or out (milliseconds)
+
+// Image decode settings
+#define DITHER_DECODE false     // Decode at 24-bit and ordered-dither to RGB565 (removes banding in skies and skin tones)
+#define FAST_JPEG true          // Decode upright photos with the speed-tuned decoder instead of TJpgDec
+#define BACK_BUFFER false       // Decode into an 8-bit off-screen frame and swap it in at once (needs ~180 KB of heap)
+#define SLIDE_TRANSITIONS false // Slide the next photo in with the panel's hardware scroll (needs BACK_BUFFER)
+#define FADE_TRANSITIONS true   // Fade the backlight out and back in around slide changes, the decode happens in the dark
+#ifndef DECODE_BENCHMARK
+#define DECODE_BENCHMARK false  // At boot, time the decode paths over the card and print images per second
+#endif
+#define BENCHMARK_IMAGES 20     // Number of images used by the decode benchmark
+#define FADE_MIN_MS 30          // Shortest slide fade, also the wait before a tap changes the photo
+#define FADE_MAX_MS 250         // Longest slide fade
+#define BRIGHTNESS_FADE_MS 150  // Fade between brightness levels on the settings screen
+#define SLIDE_TIME_MS 400       // Length of a slide transition
+
+// Overlay settings
+#define SHOW_OVERLAY true // Clock, photo counter and file name along the bottom edge of each photo
+
+// Boot behavior
+#define FAST_BOOT true // Resume the last photo and settings from NVS, confirm the file list in the background
+
+// Serial upload
+#define SERIAL_UPLOAD true          // Receive photos over USB serial straight to the SD card (scripts/upload.sh)
+#define UPLOAD_RX_BUFFER 12 * 1024  // Serial receive buffer, holds a full window of DATA frames
+#define LIVE_MODE true              // Show frames streamed from a host over USB serial (scripts/live.sh)
+
+// Screen area config: the panel size, touch areas and screen layouts are
+// compile-time constants of Panel, see include/panel.h. Build with
+// -DPANEL_WIDTH / -DPANEL_HEIGHT (esp32dev_320x240, esp32dev_800x480) for
+// another panel.
 
 #include <Arduino.h>
 #include <SPI.h>
 #include "SD.h"
 #include "FS.h"
 #include <TJpg_Decoder.h>
+#include <freertos/semphr.h>
+#include <sys/time.h>
+#include <time.h>
 #include <vector>
 
+#include "album.h"
+#include "backbuffer.h"
+#include "backlight.h"
+#include "clip.h"
+#include "dirscan.h"
+#include "dither.h"
+#include "exif.h"
+#include "fastjpeg.h"
+#include "heap_guard.h"
+#include "input_trace.h"
+#include "live.h"
+#include "log.h"
+#include "overlay.h"
+#include "panel.h"
+#include "quarantine.h"
+#include "resume.h"
+#include "roi.h"
+#include "scroll.h"
+#include "spans.h"
+#include "thumbs.h"
+#include "upload.h"
+
 #include <TFT_eSPI.h> // Hardware-specific library with built-in touch support
 
 TFT_eSPI tft = TFT_eSPI(); // Invoke custom library
@@ -61,18 +108,60 @@ TFT_eSPI tft = TFT_eSPI(); // Invoke custom library
 #define VSPI_MOSI 23  // SD Card - VSPI pin
 #define VSPI_SCK 18   // SD Card - VSPI pin
 
-// SPI control macros
-#define SPI_ON_SD digitalWrite(SD_CS, LOW)
-#define SPI_OFF_SD digitalWrite(SD_CS, HIGH)
+// Longest SD path built by the slideshow, "/" + file name
+#define MAX_PATH_LENGTH 128
+
+// Where the card is mounted in the VFS, the directory scan reads it there
+#define SD_MOUNT_POINT "/sd"
+
+// SPI control macros, they also hold the SD lock so the background scan
+// and the main loop never use the card at the same time
+#define SPI_ON_SD sdLock()
+#define SPI_OFF_SD sdUnlock()
+
+// Recursive, a locked section may call code that locks again
+SemaphoreHandle_t sd_mutex = nullptr;
+
+void sdLock()
+{
+  xSemaphoreTakeRecursive(sd_mutex, portMAX_DELAY);
+  digitalWrite(SD_CS, LOW);
+}
+
+void sdUnlock()
+{
+  digitalWrite(SD_CS, HIGH);
+  xSemaphoreGiveRecursive(sd_mutex);
+}
 
 // images
 std::vector<String> file_list;
 int file_index = 0;
 bool force_refresh = true;
+size_t validate_index = 0; // next photo checked by the background validation pass
+
+// current image placement, used by tft_output() to remap rotated blocks
+uint8_t img_orientation = EXIF_ORIENTATION_NORMAL;
+uint16_t img_src_w = 0;
+uint16_t img_src_h = 0;
+int16_t img_x_pos = 0;
+int16_t img_y_pos = 0;
+
+// pan and zoom for photos larger than the screen
+bool viewport_active = false; // current photo is drawn through the viewport decoder
+bool viewport_fit = false;    // zoomed out to fit the screen instead of 1:1
+int32_t view_x = 0;           // top left of the 1:1 viewport in image pixels
+int32_t view_y = 0;
+uint8_t fit_scale = 1; // TJpgDec scale and placement of the zoomed out photo
+int16_t fit_x = 0;
+int16_t fit_y = 0;
+char viewport_path[MAX_PATH_LENGTH];
 
 // screen
 bool display_on = true;
 unsigned long button_pressed_at = 0;
+unsigned long redraw_time = 300; // running average of the time a slide spends drawing in the dark (ms)
+int slide_direction = SCROLL_LEFT; // where the next slide transition comes in from
 
 // multi touch tracking
 int taps = 0;
@@ -84,130 +173,589 @@ bool settings_screen_visible = false;
 int current_delay_index = 0;      // Index into delay_configs array
 int current_brightness_pct = 100; // Brightness percentage (10-100 in steps of 10)
 
+// gallery screen
+bool gallery_visible = false;
+int gallery_page = 0;
+
 // runtime tracking
 unsigned long runtime = 0;
+bool first_image_drawn = false;
+
+// Slideshow runs from the built-in flash album because the SD card is unavailable
+bool album_mode = false;
+
+// fast boot
+ResumeState resume_state;
+std::vector<String> scanned_list; // filled by the background scan task
+uint32_t scanned_fingerprint = 0;    // directory fingerprint of scanned_list
+volatile bool scan_complete = false;
 
 // ====== SETTINGS SCREEN ======
 
+// Draws one - or + button of the settings screen
+void drawSettingsButton(const PanelRect &button, const char *glyph)
+{
+  tft.fillRoundRect(button.x, button.y, button.w, button.h, Settings::button_corner, 0xF81F);
+  tft.drawRoundRect(button.x, button.y, button.w, button.h, Settings::button_corner, 0xFFFF);
+  tft.setTextColor(0xFFFF);
+  tft.setTextSize(Settings::value_text);
+  tft.drawString(glyph, button.centerX() + 1, button.centerY() + 1);
+}
+
 void showSettingsScreen()
 {
+  SPAN("showSettingsScreen");
+  latencyFirstPixel();
   tft.fillScreen(0x0000);
   tft.setTextDatum(MC_DATUM);
 
   // Frame Interval section
-  tft.fillRoundRect(20, 20, SCREEN_WIDTH - 40, 100, 12, 0x2104);
+  const PanelRect interval_card = Settings::intervalCard();
+  tft.fillRoundRect(interval_card.x, interval_card.y, interval_card.w, interval_card.h, Settings::corner, 0x2104);
   tft.setTextColor(0xFFFF);
-  tft.setTextSize(2);
+  tft.setTextSize(Settings::label_text);
   tft.setTextDatum(TC_DATUM);
-  tft.drawString("Frame Interval", SCREEN_CENTER_X, 35);
+  tft.drawString("Frame Interval", Panel::center_x, Settings::interval_title_y);
   tft.setTextDatum(MC_DATUM);
 
-  // + button for frame interval
-  tft.fillRoundRect(SCREEN_WIDTH - (110 + 40), 65, 40, 40, 6, 0xF81F);
-  tft.drawRoundRect(SCREEN_WIDTH - (110 + 40), 65, 40, 40, 6, 0xFFFF);
-  tft.setTextColor(0xFFFF);
-  tft.setTextSize(3);
-  tft.drawString("+", SCREEN_WIDTH - (110 + 20 - 1), (85 + 1));
-
-  // - button for frame interval
-  tft.fillRoundRect(110, 65, 40, 40, 6, 0xF81F);
-  tft.drawRoundRect(110, 65, 40, 40, 6, 0xFFFF);
-  tft.setTextColor(0xFFFF);
-  tft.setTextSize(3);
-  tft.drawString("-", (110 + 20 + 1), (85 + 1));
+  // + and - buttons for frame interval
+  drawSettingsButton(Settings::intervalPlus(), "+");
+  drawSettingsButton(Settings::intervalMinus(), "-");
 
   // Display current frame interval value
   tft.setTextColor(0xFFFF);
-  tft.setTextSize(3);
-  tft.drawString(delay_configs[current_delay_index].label, SCREEN_CENTER_X, 85);
+  tft.setTextSize(Settings::value_text);
+  tft.drawString(delay_configs[current_delay_index].label, Panel::center_x, Settings::intervalMinus().centerY());
 
   // Brightness section
-  tft.fillRoundRect(20, 140, SCREEN_WIDTH - 40, 100, 12, 0x2104);
+  const PanelRect brightness_card = Settings::brightnessCard();
+  tft.fillRoundRect(brightness_card.x, brightness_card.y, brightness_card.w, brightness_card.h, Settings::corner, 0x2104);
   tft.setTextColor(0xFFFF);
-  tft.setTextSize(2);
+  tft.setTextSize(Settings::label_text);
   tft.setTextDatum(TC_DATUM);
-  tft.drawString("Brightness", SCREEN_CENTER_X, 155);
+  tft.drawString("Brightness", Panel::center_x, Settings::brightness_title_y);
   tft.setTextDatum(MC_DATUM);
 
-  // + button for brightness
-  tft.fillRoundRect(SCREEN_WIDTH - (110 + 40), 185, 40, 40, 6, 0xF81F);
-  tft.drawRoundRect(SCREEN_WIDTH - (110 + 40), 185, 40, 40, 6, 0xFFFF);
-  tft.setTextColor(0xFFFF);
-  tft.setTextSize(3);
-  tft.drawString("+", SCREEN_WIDTH - (110 + 20 - 1), (205 + 1));
-
-  // - button for brightness
-  tft.fillRoundRect(110, 185, 40, 40, 6, 0xF81F);
-  tft.drawRoundRect(110, 185, 40, 40, 6, 0xFFFF);
-  tft.setTextColor(0xFFFF);
-  tft.setTextSize(3);
-  tft.drawString("-", (110 + 20 + 1), (205 + 1));
+  // + and - buttons for brightness
+  drawSettingsButton(Settings::brightnessPlus(), "+");
+  drawSettingsButton(Settings::brightnessMinus(), "-");
 
   // Display current brightness percentage
   tft.setTextColor(0xFFFF);
-  tft.setTextSize(3);
-  tft.drawString(String(current_brightness_pct) + "%", SCREEN_CENTER_X, 205);
+  tft.setTextSize(Settings::value_text);
+  char brightness_label[8];
+  snprintf(brightness_label, sizeof(brightness_label), "%d%%", current_brightness_pct);
+  tft.drawString(brightness_label, Panel::center_x, Settings::brightnessMinus().centerY());
 
   // Save & Close button
-  tft.fillRoundRect(160, 260, 160, 40, 6, 0xF81F);
-  tft.drawRoundRect(160, 260, 160, 40, 6, 0xFFFF);
+  const PanelRect close = Settings::close();
+  tft.fillRoundRect(close.x, close.y, close.w, close.h, Settings::button_corner, 0xF81F);
+  tft.drawRoundRect(close.x, close.y, close.w, close.h, Settings::button_corner, 0xFFFF);
+  tft.setTextColor(0xFFFF);
+  tft.setTextSize(Settings::label_text);
+  tft.drawString("Save & Close", close.centerX(), close.centerY());
+
+  // reset to default
+  tft.setTextDatum(TL_DATUM);
+
+  latencyComplete();
+}
+
+// ====== GALLERY SCREEN ======
+
+#define GALLERY_TOP Panel::sy(40)       // thumbnail grid starts below the title
+#define GALLERY_COLUMNS 4               // 4 x 3 grid of 120x80 thumbnails
+#define GALLERY_ROWS (THUMBS_PER_PAGE / GALLERY_COLUMNS)
+#define GALLERY_LEFT Panel::centerLeft(GALLERY_COLUMNS * THUMB_WIDTH)
+#define GALLERY_FOOTER_Y Panel::sy(284) // Prev / Close / Next buttons
+#define GALLERY_BUTTON_WIDTH Panel::sx(120)
+
+// Thumbnails keep their 120x80 size, the grid is centered on larger panels
+// and does not fit below the title of smaller ones
+#define GALLERY_FITS (GALLERY_COLUMNS * THUMB_WIDTH <= Panel::width && \
+                      GALLERY_TOP + GALLERY_ROWS * THUMB_HEIGHT <= GALLERY_FOOTER_Y)
+
+void drawGalleryButton(int32_t x, const char *label)
+{
+  tft.fillRoundRect(x, GALLERY_FOOTER_Y, GALLERY_BUTTON_WIDTH, Panel::sy(32), Panel::sy(6), 0xF81F);
+  tft.drawRoundRect(x, GALLERY_FOOTER_Y, GALLERY_BUTTON_WIDTH, Panel::sy(32), Panel::sy(6), 0xFFFF);
+  tft.drawString(label, x + GALLERY_BUTTON_WIDTH / 2, GALLERY_FOOTER_Y + Panel::sy(16) + 1);
+}
+
+void showGalleryScreen()
+{
+  SPAN("showGalleryScreen");
+  unsigned long started_at = millis();
+
+  latencyFirstPixel();
+  tft.fillScreen(0x0000);
   tft.setTextColor(0xFFFF);
-  tft.setTextSize(2);
-  tft.drawString("Save & Close", SCREEN_CENTER_X, 280);
+  tft.setTextSize(Panel::textSize(2));
+  tft.setTextDatum(MC_DATUM);
+
+  // The whole page of thumbnails comes in with one sequential read
+  SPI_ON_SD;
+  int count = thumbsLoadPage(SD, gallery_page);
+  SPI_OFF_SD;
+
+  char title[32];
+  snprintf(title, sizeof(title), "Gallery %d/%d", gallery_page + 1, thumbsPageCount());
+  tft.drawString(title, Panel::center_x, GALLERY_TOP / 2);
+
+  // Thumbnails are decoded from RAM, always upright
+  img_orientation = EXIF_ORIENTATION_NORMAL;
+  for (int slot = 0; slot < count; slot++)
+  {
+    uint32_t size = 0;
+    const uint8_t *data = thumbsData(slot, &size);
+    int32_t x = GALLERY_LEFT + (slot % GALLERY_COLUMNS) * THUMB_WIDTH;
+    int32_t y = GALLERY_TOP + (slot / GALLERY_COLUMNS) * THUMB_HEIGHT;
+    TJpgDec.drawJpg(x, y, data, size);
+  }
+
+  drawGalleryButton(Panel::sx(20), "< Prev");
+  drawGalleryButton(Panel::sx(180), "Close");
+  drawGalleryButton(Panel::sx(340), "Next >");
 
   // reset to default
   tft.setTextDatum(TL_DATUM);
+
+  LOG_INFO("Gallery page %d drawn in %lu ms", gallery_page + 1, millis() - started_at);
+
+  latencyComplete();
 }
 
 // ====== MAIN SCREEN ======
 
-void drawMainScreen()
+// Builds the SD card path for a file name in a caller-owned fixed buffer,
+// so the slideshow never creates String temporaries on the heap
+void buildFilePath(char *path, size_t size, const char *name)
 {
-  // Let TFT_eSPI manage CS internally
-  tft.fillScreen(TFT_BLACK);
+  snprintf(path, size, "/%s", name);
+}
+
+// Draws a JPEG from SD through the selected decode path
+int drawSdImage(int32_t x, int32_t y, const char *path, bool dithered)
+{
+  SPAN("drawSdImage");
+
+  // Rotated photos are placed 16x16 block by block, the fast decoder
+  // hands out whole strips
+  if (!dithered && FAST_JPEG && img_orientation == EXIF_ORIENTATION_NORMAL)
+  {
+    // Fast decoder strips arrive already byte-swapped for the SPI bus
+    tft.setSwapBytes(false);
+    int result = fastJpegDrawFs(x, y, path, SD);
+    tft.setSwapBytes(true);
 
-  // Add "/" prefix to filename for SD card path
-  String filepath = "/" + file_list[file_index];
-  Serial.print("Loading image: ");
-  Serial.println(filepath);
+    return result;
+  }
+
+  if (!dithered)
+    return TJpgDec.drawSdJpg(x, y, path);
+
+  // Dithered blocks arrive already byte-swapped for the SPI bus
+  tft.setSwapBytes(false);
+  int result = ditherDrawFsJpg(x, y, path, SD);
+  tft.setSwapBytes(true);
+
+  return result;
+}
+
+// Draws the current large photo either scaled to fit the screen or as a 1:1
+// viewport at (view_x, view_y), decoding only the MCUs inside the viewport
+int drawViewport()
+{
+  unsigned long started_at = millis();
+  int result;
+
+  if (viewport_fit)
+  {
+    // TJpgDec scales by 1/2, 1/4 or 1/8 while decoding
+    fit_scale = 1;
+    while (fit_scale < 8 && (img_src_w / fit_scale > Panel::width || img_src_h / fit_scale > Panel::height))
+      fit_scale *= 2;
+
+    fit_x = (Panel::width - img_src_w / fit_scale) / 2;
+    fit_y = (Panel::height - img_src_h / fit_scale) / 2;
+
+    TJpgDec.setJpgScale(fit_scale);
+    result = TJpgDec.drawSdJpg(fit_x, fit_y, viewport_path);
+    TJpgDec.setJpgScale(1);
+  }
+  else
+  {
+    // Keep the photo centered along an axis where it is smaller than the screen
+    int32_t dest_x = Panel::centerLeft(img_src_w);
+    int32_t dest_y = Panel::centerTop(img_src_h);
+
+    // Viewport blocks arrive already byte-swapped for the SPI bus
+    tft.setSwapBytes(false);
+    result = roiDraw(SD, view_x, view_y, Panel::width, Panel::height, dest_x, dest_y);
+    tft.setSwapBytes(true);
+  }
+
+  LOG_INFO("Viewport drawn in %lu ms (%s)", millis() - started_at, viewport_fit ? "fit" : "1:1");
+  return result;
+}
+
+// Starts a motion clip centered on screen and shows its first frame,
+// returns 0 on success
+int drawClipFile(const char *filepath)
+{
+  uint16_t clip_w = 0, clip_h = 0;
+  viewport_active = false;
+  roiClose();
+  img_orientation = EXIF_ORIENTATION_NORMAL;
+
+  SPI_ON_SD;
+  int result = clipOpen(SD, filepath, &clip_w, &clip_h);
+  if (result == 0)
+  {
+    img_x_pos = Panel::centerLeft(clip_w);
+    img_y_pos = Panel::centerTop(clip_h);
+    clipTick(img_x_pos, img_y_pos);
+  }
+  SPI_OFF_SD;
+
+  // Frames keep changing under the band, the overlay stays off while the clip plays
+  if (SHOW_OVERLAY)
+  {
+    overlayInvalidate();
+  }
+
+  if (!first_image_drawn)
+  {
+    first_image_drawn = true;
+    LOG_INFO("Time to first image: %lu ms", millis());
+  }
+
+  return result;
+}
+
+// Decodes one image from SD centered on screen, returns 0 on success
+int drawImageFile(const char *filepath)
+{
+  if (clipIsClip(filepath))
+    return drawClipFile(filepath);
 
   // Wrap image rendering with error handling
   // Get image dimensions to center it
   uint16_t img_w = 0, img_h = 0;
+  viewport_active = false;
   SPI_ON_SD;
-  int result = TJpgDec.getFsJpgSize(&img_w, &img_h, filepath.c_str(), SD);
+  int result;
+  {
+    SPAN("getFsJpgSize");
+    result = TJpgDec.getFsJpgSize(&img_w, &img_h, filepath, SD);
+  }
+
+  // The overlay band is captured again from this decode
+  if (SHOW_OVERLAY)
+  {
+    overlayResetBand();
+  }
 
   if (result == 0)
   {
-    // Calculate centered position
-    int16_t x_pos = (tft.width() - img_w) / 2;
-    int16_t y_pos = (tft.height() - img_h) / 2;
+    // Photos copied straight from a phone carry their rotation in the Exif block
+    img_orientation = readExifOrientation(SD, filepath);
+    img_src_w = img_w;
+    img_src_h = img_h;
+
+    // Orientations 5-8 are displayed with width and height swapped
+    if (exifSwapsAxes(img_orientation))
+    {
+      img_w = img_src_h;
+      img_h = img_src_w;
+    }
+
+    // Photos larger than the screen that carry restart markers can be panned and zoomed
+    viewport_active = img_orientation == EXIF_ORIENTATION_NORMAL &&
+                      (img_w > Panel::width || img_h > Panel::height) &&
+                      roiOpen(SD, filepath) == 0;
 
-    // Ensure position is not negative
-    if (x_pos < 0)
-      x_pos = 0;
-    if (y_pos < 0)
-      y_pos = 0;
+    if (viewport_active)
+    {
+      snprintf(viewport_path, sizeof(viewport_path), "%s", filepath);
+
+      // Photos kept at up to twice the screen size start zoomed out, panoramas start 1:1 in the middle
+      viewport_fit = img_w <= 2 * Panel::width && img_h <= 2 * Panel::height;
+      view_x = max(0, (img_w - Panel::width) / 2);
+      view_y = max(0, (img_h - Panel::height) / 2);
+
+      result = drawViewport();
+    }
+    else
+    {
+      // Calculate centered position
+      int16_t x_pos = Panel::centerLeft(img_w);
+      int16_t y_pos = Panel::centerTop(img_h);
 
-    // Try to draw the image
-    result = TJpgDec.drawSdJpg(x_pos, y_pos, filepath.c_str());
+      img_x_pos = x_pos;
+      img_y_pos = y_pos;
+
+      // Try to draw the image, rotated blocks are placed by tft_output()
+      unsigned long draw_started_at = millis();
+      if (img_orientation == EXIF_ORIENTATION_NORMAL)
+        result = drawSdImage(x_pos, y_pos, filepath, DITHER_DECODE);
+      else
+        result = drawSdImage(0, 0, filepath, DITHER_DECODE);
+
+      LOG_INFO("Drawn in %lu ms (orientation %u)", millis() - draw_started_at, img_orientation);
+    }
 
     if (result != 0)
     {
-      Serial.print("Error drawing image (error code: ");
-      Serial.print(result);
-      Serial.println("). Skipping to next image.");
+      LOG_WARN("Error drawing image (error code: %d). Skipping to next image.", result);
     }
   }
   else
   {
-    Serial.print("Error getting image size (error code: ");
-    Serial.print(result);
-    Serial.println("). Skipping to next image.");
+    LOG_WARN("Error getting image size (error code: %d). Skipping to next image.", result);
   }
 
+  // The viewport index is only held while its photo is on screen
+  if (!viewport_active)
+    roiClose();
+
   SPI_OFF_SD;
 
+  if (!first_image_drawn)
+  {
+    first_image_drawn = true;
+    LOG_INFO("Time to first image: %lu ms", millis());
+  }
+
+  return result;
+}
+
+// Decodes one photo of the built-in album centered on screen, returns 0 on success
+int drawAlbumImage(size_t index)
+{
+  uint32_t size = 0;
+  const uint8_t *data = albumData(index, &size);
+  uint16_t img_w = 0, img_h = 0;
+  viewport_active = false;
+  roiClose();
+
+  // Album photos are prepared upright, they carry no Exif rotation
+  img_orientation = EXIF_ORIENTATION_NORMAL;
+
+  if (SHOW_OVERLAY)
+  {
+    overlayResetBand();
+  }
+
+  int result = TJpgDec.getJpgSize(&img_w, &img_h, data, size);
+  if (result == 0)
+  {
+    img_x_pos = Panel::centerLeft(img_w);
+    img_y_pos = Panel::centerTop(img_h);
+
+    // Decoded straight from mapped flash, no file system in between
+    unsigned long draw_started_at = millis();
+    if (FAST_JPEG)
+    {
+      tft.setSwapBytes(false);
+      result = fastJpegDrawMem(img_x_pos, img_y_pos, data, size);
+      tft.setSwapBytes(true);
+    }
+    else
+    {
+      result = TJpgDec.drawJpg(img_x_pos, img_y_pos, data, size);
+    }
+    LOG_INFO("Drawn from flash in %lu ms", millis() - draw_started_at);
+  }
+
+  if (result != 0)
+  {
+    LOG_WARN("Error drawing album image (error code: %d). Skipping to next image.", result);
+  }
+
+  if (!first_image_drawn)
+  {
+    first_image_drawn = true;
+    LOG_INFO("Time to first image: %lu ms", millis());
+  }
+
+  return result;
+}
+
+// Drops a photo from the slideshow and keeps the cursors pointing at the same photos
+void removeFromFileList(size_t index)
+{
+  file_list.erase(file_list.begin() + index);
+
+  if (file_index > index)
+    file_index--;
+  if (file_index >= file_list.size())
+    file_index = 0;
+
+  if (validate_index > index)
+    validate_index--;
+}
+
+// Quarantines a photo that failed to draw when it is broken for good.
+// Returns false for failures that look like a passing read error.
+bool quarantineFailedImage(const char *filepath, int result)
+{
+  int reason = validateJpeg(SD, filepath);
+
+  if (reason != JPEG_VALID)
+  {
+    quarantineAdd(SD, filepath, validateReason(reason));
+  }
+  else if (result >= JDR_FMT1)
+  {
+    // Headers are fine but the image data is corrupt
+    quarantineAdd(SD, filepath, "decode error");
+  }
+  else
+  {
+    return false;
+  }
+
+  LOG_WARN("Quarantined: %s", filepath);
+  return true;
+}
+
+// Wipes what a failed decode left behind, on screen or in the back buffer
+void clearPartialImage(bool buffered)
+{
+  if (buffered)
+    backBufferClear();
+  else
+    tft.fillScreen(TFT_BLACK);
+}
+
+static_assert(!SLIDE_TRANSITIONS || BACK_BUFFER, "slide transitions push the photo from the back buffer");
+
+// Slides the photo decoded into the back buffer in over the one on screen
+void slideInPhoto()
+{
+  backBufferFinish();
+
+  ScrollStats stats;
+  scrollSlide(slide_direction, SLIDE_TIME_MS, backBufferPushColumns, &stats);
+  slide_direction = SCROLL_LEFT;
+
+  LOG_INFO("Slid in over %lu ms in %lu steps (%lu steps/s)", (unsigned long)stats.elapsed_ms,
+           (unsigned long)stats.steps, (unsigned long)(stats.elapsed_ms ? stats.steps * 1000 / stats.elapsed_ms : 0));
+}
+
+// Length of a slide fade, half the measured redraw time so the fade in
+// is over about when the next photo would have finished its wipe
+unsigned long slideFadeTime()
+{
+  return constrain(redraw_time / 2, FADE_MIN_MS, FADE_MAX_MS);
+}
+
+// Brings the backlight back after a fade out that no redraw followed
+void restoreBacklight()
+{
+  if (FADE_TRANSITIONS && display_on && backlightTarget() != current_brightness_pct)
+    backlightFade(current_brightness_pct, FADE_MIN_MS);
+}
+
+void drawMainScreen()
+{
+  SPAN("drawMainScreen");
+  clipStop();
+
+  // With the back buffer the previous photo stays up until the next one is complete
+  bool buffered = BACK_BUFFER && backBufferStart();
+
+  // Without it the screen is cleared and the photo wiped in while the
+  // backlight is dark. The slideshow starts the fade out ahead of time, a
+  // tap gets a short one here. Nothing is drawn before the light is off.
+  bool faded = FADE_TRANSITIONS && !buffered;
+  if (faded)
+  {
+    if (backlightTarget() != 0)
+      backlightFade(0, FADE_MIN_MS);
+    backlightWait();
+  }
+  unsigned long dark_at = millis();
+
+  if (!buffered)
+  {
+    // Let TFT_eSPI manage CS internally
+    tft.fillScreen(TFT_BLACK);
+  }
+
+  // A photo that fails to draw is skipped right away instead of leaving a
+  // black screen up for the whole interval
+  for (size_t attempts = file_list.size(); attempts > 0 && !file_list.empty(); attempts--)
+  {
+    // Add "/" prefix to filename for SD card path
+    char filepath[MAX_PATH_LENGTH];
+    buildFilePath(filepath, sizeof(filepath), file_list[file_index].c_str());
+    LOG_DEBUG("Loading image: %s", filepath);
+
+    // JDR_INTR only means the photo ran off the bottom of the screen
+    int result = album_mode ? drawAlbumImage(file_index) : drawImageFile(filepath);
+    if (result == JDR_OK || result == JDR_INTR)
+      break;
+
+    // The album cannot be fixed on the device and clips are not JPEG
+    // files to validate, just move past them
+    if (album_mode || clipIsClip(filepath))
+    {
+      file_index = (file_index + 1) % file_list.size();
+      clearPartialImage(buffered);
+      continue;
+    }
+
+    SPI_ON_SD;
+    bool quarantined = quarantineFailedImage(filepath, result);
+    SPI_OFF_SD;
+
+    if (quarantined)
+    {
+      removeFromFileList(file_index);
+    }
+    else
+    {
+      file_index = (file_index + 1) % file_list.size();
+    }
+
+    clearPartialImage(buffered);
+  }
+
+  if (faded)
+  {
+    // The fade in runs in hardware while the loop goes on
+    redraw_time = (redraw_time * 3 + (millis() - dark_at)) / 4;
+    backlightFade(current_brightness_pct, slideFadeTime());
+  }
+
+  if (buffered)
+  {
+    latencyFirstPixel();
+    if (SLIDE_TRANSITIONS)
+      slideInPhoto();
+    else
+      backBufferPresent();
+  }
+
+  if (file_list.empty())
+  {
+    force_refresh = false;
+    return;
+  }
+
+  if (SHOW_OVERLAY && !clipPlaying())
+  {
+    overlaySetPhoto(file_list[file_index].c_str(), file_index, file_list.size());
+    overlayDraw();
+  }
+
+  if (FAST_BOOT && !album_mode)
+  {
+    saveResumePosition(file_index, file_list[file_index].c_str());
+  }
+
   file_index++;
   if (file_index >= file_list.size())
   {
@@ -215,117 +763,826 @@ void drawMainScreen()
   }
   runtime = millis();
   force_refresh = false;
+
+  latencyComplete();
+  heapGuardReport();
+}
+
+// ====== HELPER FUNCTIONS ======
+
+// Directory scan in progress
+struct ImageScan
+{
+  const char *path;          // VFS path of the directory
+  std::vector<String> *list; // photos and clips to play
+  uint32_t fingerprint;      // every photo and clip name, quarantined or not
+};
+
+// Adds a directory entry to the list being scanned when it is a photo or a clip
+void addImageEntry(void *context, const char *name)
+{
+  ImageScan &scan = *(ImageScan *)context;
+
+  if (!dirHasExtension(name, ".jpg") && !clipIsClip(name))
+    return;
+
+  scan.fingerprint = fingerprintAddName(scan.fingerprint, name);
+
+  if (quarantineContains(scan.path, name))
+  {
+    // Known broken, skipped without reading it
+    LOG_INFO("Skipping quarantined: %s", name);
+    return;
+  }
+
+  scan.list->push_back(name);
+  LOG_DEBUG("Found: %s", name);
+}
+
+// Gets all image files in the SD card root directory. Names come straight
+// from the directory entries, no file is opened. Returns the directory
+// fingerprint.
+uint32_t get_image_list(const char *dirname, std::vector<String> &wavlist)
+{
+  LOG_INFO("Listing directory: %s", dirname);
+  wavlist.clear(); // Clear any existing entries
+
+  char path[MAX_PATH_LENGTH];
+  snprintf(path, sizeof(path), "%s%s", SD_MOUNT_POINT, dirname);
+
+  ImageScan scan = {path, &wavlist, FINGERPRINT_EMPTY};
+  DirScanStats stats;
+  unsigned long started_at = millis();
+  bool listed = dirScan(path, addImageEntry, &scan, &stats);
+
+  // Entries released during the scan leave the card file once the
+  // directory is closed
+  quarantineSave(SD);
+
+  if (!listed)
+  {
+    LOG_ERROR("Failed to open directory");
+    return scan.fingerprint;
+  }
+  unsigned long elapsed = millis() - started_at;
+
+  LOG_INFO("Found %u images among %lu entries in %lu ms (%lu entries/s)", (unsigned)wavlist.size(),
+           (unsigned long)stats.entries, elapsed, (unsigned long)(elapsed ? (uint64_t)stats.entries * 1000 / elapsed : 0));
+  return scan.fingerprint;
+}
+
+// Records the fingerprint of a fresh scan. When the card contents changed
+// the quarantine is cleared, photos still broken are caught again by the
+// validation pass. Returns true in that case.
+bool updateDirFingerprint(uint32_t fingerprint)
+{
+  if (fingerprint == resume_state.dir_fingerprint)
+    return false;
+
+  resume_state.dir_fingerprint = fingerprint;
+  saveResumeFingerprint(fingerprint);
+
+  SPI_ON_SD;
+  quarantineClear(SD);
+  SPI_OFF_SD;
+  LOG_INFO("Card contents changed, quarantine cleared");
+  return true;
+}
+
+// How each EXIF orientation maps a decoded block into display space.
+// Every orientation is a combination of an optional transpose followed by
+// horizontal and/or vertical mirroring, so the block and its destination
+// rect can be remapped without ever holding more than one MCU.
+struct OrientationRemap
+{
+  bool swap_axes;
+  bool flip_x; // destination x counts from the right
+  bool flip_y; // destination y counts from the bottom
+};
+
+const OrientationRemap orientation_remaps[] = {
+    {false, false, false}, // 1: normal
+    {false, true, false},  // 2: mirror horizontal
+    {false, true, true},   // 3: rotate 180
+    {false, false, true},  // 4: mirror vertical
+    {true, false, false},  // 5: transpose
+    {true, true, false},   // 6: rotate 90 CW
+    {true, true, true},    // 7: transverse
+    {true, false, true},   // 8: rotate 270 CW
+};
+
+// Largest MCU TJpgDec hands out is 16x16 pixels
+uint16_t oriented_block[16 * 16];
+
+// Hands a decoded block to the back buffer while one is being filled, else to the panel
+void pushBlock(int16_t x, int16_t y, uint16_t w, uint16_t h, uint16_t *pixels)
+{
+  if (backBufferCapturing())
+    backBufferCapture(x, y, w, h, pixels, !tft.getSwapBytes());
+  else
+    tft.pushImage(x, y, w, h, pixels);
+}
+
+bool tft_output_oriented(int16_t x, int16_t y, uint16_t w, uint16_t h, uint16_t *bitmap)
+{
+  if (w * h > sizeof(oriented_block) / sizeof(oriented_block[0]))
+    return 0;
+
+  const OrientationRemap &remap = orientation_remaps[img_orientation - 1];
+
+  // Block size and image size in display space
+  uint16_t dw = remap.swap_axes ? h : w;
+  uint16_t dh = remap.swap_axes ? w : h;
+  uint16_t disp_w = remap.swap_axes ? img_src_h : img_src_w;
+  uint16_t disp_h = remap.swap_axes ? img_src_w : img_src_h;
+
+  // Source block position along the display axes
+  int16_t along_x = remap.swap_axes ? y : x;
+  int16_t along_y = remap.swap_axes ? x : y;
+
+  int16_t ox = remap.flip_x ? disp_w - along_x - dw : along_x;
+  int16_t oy = remap.flip_y ? disp_h - along_y - dh : along_y;
+  ox += img_x_pos;
+  oy += img_y_pos;
+
+  // Skip blocks that land fully off screen but keep decoding, with a rotated
+  // image the visible part can come later in the stream
+  if (Panel::offScreen(ox, oy, dw, dh))
+    return 1;
+
+  // Index steps inside the destination block for one source pixel step
+  int step_dx = remap.flip_x ? -1 : 1;
+  int step_dy = remap.flip_y ? -(int)dw : (int)dw;
+  int base = (remap.flip_x ? dw - 1 : 0) + (remap.flip_y ? (dh - 1) * dw : 0);
+  int step_x = remap.swap_axes ? step_dy : step_dx;
+  int step_y = remap.swap_axes ? step_dx : step_dy;
+
+  const uint16_t *src = bitmap;
+  for (uint16_t j = 0; j < h; j++)
+  {
+    int idx = base + j * step_y;
+    for (uint16_t i = 0; i < w; i++)
+    {
+      oriented_block[idx] = *src++;
+      idx += step_x;
+    }
+  }
+
+  if (SHOW_OVERLAY)
+  {
+    overlayCapture(ox, oy, dw, dh, oriented_block, !tft.getSwapBytes());
+  }
+
+  pushBlock(ox, oy, dw, dh, oriented_block);
+  return 1;
+}
+
+// Builds the file list off the main loop while the resumed photo is on screen.
+// The card stays locked for the whole scan, the main loop waits for it at
+// its next card access.
+void backgroundScanTask(void *param)
+{
+  SPI_ON_SD;
+  scanned_fingerprint = get_image_list("/", scanned_list);
+  scan_complete = true;
+  SPI_OFF_SD;
+  vTaskDelete(NULL);
+}
+
+void startBackgroundScan()
+{
+  scan_complete = false;
+  xTaskCreatePinnedToCore(backgroundScanTask, "scan", 8192, NULL, 1, NULL, 0);
+}
+
+// Applies the brightness and interval saved in NVS
+void applyResumeSettings()
+{
+  if (resume_state.delay_index >= 0 && resume_state.delay_index < NUM_DELAY_CONFIGS)
+  {
+    current_delay_index = resume_state.delay_index;
+    IMAGE_LIFETIME = delay_configs[current_delay_index].delay;
+  }
+
+  current_brightness_pct = constrain(resume_state.brightness_pct, 10, 100);
+  backlightSet(current_brightness_pct);
+}
+
+// Plays the built-in flash album when there is no usable SD card.
+// Returns false if the album partition holds no photos either.
+bool startAlbumSlideshow()
+{
+  if (albumCount() == 0)
+    return false;
+
+  album_mode = true;
+  for (int i = 0; i < albumCount(); i++)
+  {
+    file_list.push_back(albumName(i));
+  }
+  file_list.shrink_to_fit();
+
+  // Saved settings still apply, the resume position belongs to the card
+  if (FAST_BOOT)
+  {
+    resumeBegin();
+    if (loadResumeState(resume_state))
+    {
+      applyResumeSettings();
+    }
+  }
+
+  LOG_INFO("Playing %d photos from the built-in album", albumCount());
+  return true;
+}
+
+// Shows the photo that was on screen before the reboot without waiting for
+// the card scan. Returns false if that photo is gone.
+bool resumeSlideshow()
+{
+  char filepath[MAX_PATH_LENGTH];
+  buildFilePath(filepath, sizeof(filepath), resume_state.filename);
+
+  SPI_ON_SD;
+  bool exists = !quarantineContains(SD_MOUNT_POINT "/", resume_state.filename) && SD.exists(filepath);
+  quarantineSave(SD);
+  SPI_OFF_SD;
+
+  if (!exists)
+    return false;
+
+  LOG_INFO("Resuming at: %s", filepath);
+
+  tft.fillScreen(TFT_BLACK);
+  if (drawImageFile(filepath) != 0)
+    return false;
+
+  // Photo count is unknown until the background scan finishes
+  if (SHOW_OVERLAY)
+  {
+    overlaySetPhoto(resume_state.filename, resume_state.file_index, 0);
+    overlayDraw();
+  }
+
+  // Provisional until the background scan confirms the list
+  file_index = resume_state.file_index;
+  runtime = millis();
+  force_refresh = false;
+
+  startBackgroundScan();
+  return true;
+}
+
+bool tft_output(int16_t x, int16_t y, uint16_t w, uint16_t h, uint16_t *bitmap)
+{
+  SPAN("tft_output");
+
+  // Nothing reaches the panel until the back buffer is presented
+  if (!backBufferCapturing())
+  {
+    latencyFirstPixel();
+  }
+
+  if (img_orientation != EXIF_ORIENTATION_NORMAL)
+    return tft_output_oriented(x, y, w, h, bitmap);
+
+  // Stop further decoding as image is running off bottom of screen
+  if (y >= Panel::height)
+    return 0;
+
+  // Keep the pixels under the overlay band so the overlay can be redrawn without decoding again
+  if (SHOW_OVERLAY)
+  {
+    overlayCapture(x, y, w, h, bitmap, !tft.getSwapBytes());
+  }
+
+  // This function will clip the image block rendering automatically at the TFT boundaries
+  pushBlock(x, y, w, h, bitmap);
+
+  // Return 1 to decode next block
+  return 1;
+}
+
+void waitForTouchRelease(uint16_t &touch_x, uint16_t &touch_y)
+{
+  while (inputGetTouch(tft, &touch_x, &touch_y))
+  {
+    delay(50);
+  }
+}
+
+void handleBootButton()
+{
+  if (!inputButtonPressed(BOOT_BUTTON))
+    return;
+
+  if (millis() - button_pressed_at <= BUTTON_DEBOUNCE)
+    return;
+
+  SPAN("handleBootButton");
+  display_on = !display_on;
+
+  if (display_on)
+  {
+    // The backlight comes up with the photo
+    latencyGesture("display on");
+    tft.fillScreen(TFT_BLACK);
+    force_refresh = true;
+    if (!FADE_TRANSITIONS || BACK_BUFFER)
+      backlightSet(current_brightness_pct);
+  }
+  else
+  {
+    backlightFade(0, FADE_MAX_MS);
+
+    // The frame is usually unplugged next, keep the photo it was showing
+    if (FAST_BOOT && !album_mode)
+      resumeFlush();
+  }
+
+  button_pressed_at = millis();
+
+  while (inputButtonPressed(BOOT_BUTTON))
+  {
+    delay(50);
+  }
+}
+
+// Swaps in the file list from the background scan once it is ready
+void handleBackgroundScan()
+{
+  if (!scan_complete)
+    return;
+
+  scan_complete = false;
+  validate_index = 0;
+  file_list.swap(scanned_list);
+  std::vector<String>().swap(scanned_list);
+  file_list.shrink_to_fit();
+
+  bool changed = updateDirFingerprint(scanned_fingerprint);
+  bool index_valid = resume_state.file_index < file_list.size() &&
+                     file_list[resume_state.file_index] == resume_state.filename;
+
+  bool resumed_found = index_valid;
+
+  if (!changed && index_valid)
+  {
+    LOG_INFO("File list confirmed");
+  }
+  else
+  {
+    // Card contents changed, find the resumed photo in the new list
+    file_index = 0;
+    resumed_found = false;
+    for (size_t i = 0; i < file_list.size(); i++)
+    {
+      if (file_list[i] == resume_state.filename)
+      {
+        file_index = i;
+        resumed_found = true;
+        break;
+      }
+    }
+
+    LOG_INFO("File list rebuilt");
+  }
+
+  // Fill in the photo counter that was unknown while resuming
+  if (SHOW_OVERLAY && resumed_found && !settings_screen_visible)
+  {
+    overlaySetPhoto(file_list[file_index].c_str(), file_index, file_list.size());
+    overlayDraw();
+  }
+
+  // file_index points at the photo on screen, continue with the next one.
+  // When that photo is gone the slideshow starts over at the first one.
+  if (resumed_found)
+  {
+    file_index = (file_index + 1) % file_list.size();
+  }
+
+  // The list is final now, anything allocated from here on is a leak
+  heapGuardArm();
+}
+
+void handleAutoAdvance()
+{
+  if (!display_on || settings_screen_visible || gallery_visible || file_list.empty())
+    return;
+
+  bool should_advance = force_refresh || heapSoakRunning() || (IMAGE_LIFETIME > 0 && millis() - runtime >= IMAGE_LIFETIME);
+
+  if (should_advance)
+  {
+    drawMainScreen();
+    return;
+  }
+
+  // Fade out ahead of time, so the screen is dark right when the next photo is due
+  unsigned long fade = slideFadeTime();
+  if (FADE_TRANSITIONS && !BACK_BUFFER && IMAGE_LIFETIME > fade && millis() - runtime >= IMAGE_LIFETIME - fade &&
+      backlightTarget() != 0)
+  {
+    backlightFade(0, fade);
+  }
+}
+
+// Shows the next due frame of a playing clip
+void handleClip()
+{
+  if (!clipPlaying() || !display_on || settings_screen_visible || gallery_visible)
+    return;
+
+  SPI_ON_SD;
+  clipTick(img_x_pos, img_y_pos);
+  SPI_OFF_SD;
+}
+
+// Keeps the overlay clock current by redrawing only the overlay band
+void handleOverlay()
+{
+  if (!SHOW_OVERLAY || !display_on || settings_screen_visible || gallery_visible)
+    return;
+
+  overlayTick();
+}
+
+// Background validation pass: checks one photo per loop pass, so broken
+// files are quarantined before the slideshow gets to them
+void handleValidation()
+{
+  if (album_mode || validate_index >= file_list.size() || settings_screen_visible || gallery_visible)
+    return;
+
+  char filepath[MAX_PATH_LENGTH];
+  buildFilePath(filepath, sizeof(filepath), file_list[validate_index].c_str());
+
+  // Clip frames are checked as they are played
+  int reason = JPEG_VALID;
+  if (!clipIsClip(filepath))
+  {
+    SPI_ON_SD;
+    reason = validateJpeg(SD, filepath);
+    if (reason != JPEG_VALID)
+    {
+      quarantineAdd(SD, filepath, validateReason(reason));
+    }
+    SPI_OFF_SD;
+  }
+
+  if (reason != JPEG_VALID)
+  {
+    LOG_WARN("Quarantined %s (%s)", filepath, validateReason(reason));
+    removeFromFileList(validate_index);
+  }
+  else
+  {
+    validate_index++;
+  }
+
+  if (validate_index == file_list.size())
+  {
+    LOG_INFO("Validation pass complete, %u photos OK", (unsigned)file_list.size());
+  }
+}
+
+// ====== SERIAL UPLOAD ======
+
+File upload_files[2]; // the partial file and its meta file can be open together
+unsigned long upload_progress_at = 0;
+uint32_t live_requested_baud = 0; // set when a host asks for a live session
+
+size_t uploadSerialRead(void *context, uint8_t *buffer, size_t length)
+{
+  size_t available = Serial.available();
+  return Serial.readBytes(buffer, available < length ? available : length);
+}
+
+void uploadSerialWrite(void *context, const uint8_t *data, size_t length)
+{
+  Serial.write(data, length);
+}
+
+void uploadSetBaud(void *context, uint32_t baud)
+{
+  Serial.flush();
+  Serial.updateBaudRate(baud);
+}
+
+uint32_t uploadMillis(void *context)
+{
+  return millis();
+}
+
+void *uploadOpen(void *context, const char *path, const char *mode)
+{
+  // Without a card, or with uploads turned off, every file is refused
+  if (!SERIAL_UPLOAD || album_mode)
+    return nullptr;
+
+  for (File &file : upload_files)
+  {
+    if (file)
+      continue;
+
+    file = SD.open(path, mode[0] == 'r' ? FILE_READ : mode[0] == 'w' ? FILE_WRITE : FILE_APPEND);
+    return file ? &file : nullptr;
+  }
+  return nullptr;
+}
+
+size_t uploadFileRead(void *context, void *file, uint8_t *buffer, size_t length)
+{
+  return ((File *)file)->read(buffer, length);
+}
+
+size_t uploadFileWrite(void *context, void *file, const uint8_t *data, size_t length)
+{
+  return ((File *)file)->write(data, length);
+}
+
+void uploadClose(void *context, void *file)
+{
+  ((File *)file)->close();
 }
 
-// ====== HELPER FUNCTIONS ======
+long uploadSize(void *context, const char *path)
+{
+  if (!SD.exists(path))
+    return -1;
+
+  File file = SD.open(path, FILE_READ);
+  long size = file ? (long)file.size() : -1;
+  file.close();
+  return size;
+}
 
-// Gets all image files in the SD card root directory
-void get_image_list(fs::FS &fs, const char *dirname, std::vector<String> &wavlist)
+bool uploadRemove(void *context, const char *path)
 {
-  Serial.printf("Listing directory: %s\n", dirname);
-  wavlist.clear(); // Clear any existing entries
+  return SD.remove(path);
+}
+
+// Only a finished upload is renamed, into the name it replaces. A broken
+// photo of that name leaves the quarantine, so the rescan picks it up.
+bool uploadRename(void *context, const char *from, const char *to)
+{
+  if (!SD.rename(from, to))
+    return false;
+
+  quarantineRemove(SD, to);
+  return true;
+}
 
-  File root = fs.open(dirname);
-  if (!root)
+// Receiving screen, laid out for 480x320 and scaled to the panel
+#define UPLOAD_TITLE_Y (Panel::center_y - Panel::sy(60))
+#define UPLOAD_NAME_Y (Panel::center_y - Panel::sy(15))
+#define UPLOAD_NAME_HEIGHT Panel::sy(20)
+#define UPLOAD_BAR_X Panel::sx(40)
+#define UPLOAD_BAR_Y (Panel::center_y + Panel::sy(20))
+#define UPLOAD_BAR_WIDTH (Panel::width - 2 * UPLOAD_BAR_X)
+#define UPLOAD_BAR_HEIGHT Panel::sy(24)
+
+// Receiving screen with a progress bar for the current file
+void uploadEvent(void *context, int event, const char *name, uint32_t done, uint32_t total)
+{
+  if (event == UPLOAD_EVENT_START)
   {
-    Serial.println("Failed to open directory");
-    return;
+    // The port carries frames from here on, log lines wait in the queue.
+    // The card is held for the session, after a background scan if one
+    // is still running.
+    logPause(true);
+    clipStop();
+    SPI_ON_SD;
+    restoreBacklight();
+    tft.fillScreen(TFT_BLACK);
+    tft.setTextColor(TFT_WHITE, TFT_BLACK);
+    tft.setTextDatum(TC_DATUM);
+    tft.setTextSize(Panel::textSize(3));
+    tft.drawString("Receiving photos...", Panel::center_x, UPLOAD_TITLE_Y);
+    tft.drawRect(UPLOAD_BAR_X, UPLOAD_BAR_Y, UPLOAD_BAR_WIDTH, UPLOAD_BAR_HEIGHT, TFT_WHITE);
+    upload_progress_at = 0;
   }
-  if (!root.isDirectory())
+  else if (event == UPLOAD_EVENT_PROGRESS)
   {
-    Serial.println("Not a directory");
-    return;
+    // Drawing steals time from the link, a few updates per second are enough
+    if (done != total && millis() - upload_progress_at < 250)
+      return;
+    upload_progress_at = millis();
+
+    tft.setTextSize(Panel::textSize(2));
+    tft.fillRect(0, UPLOAD_NAME_Y, Panel::width, UPLOAD_NAME_HEIGHT, TFT_BLACK);
+    tft.drawString(name, Panel::center_x, UPLOAD_NAME_Y);
+
+    // Filled inside the 1 px frame with a 1 px gap
+    int32_t bar_x = UPLOAD_BAR_X + 2;
+    int32_t bar_y = UPLOAD_BAR_Y + 2;
+    int32_t bar_width = UPLOAD_BAR_WIDTH - 4;
+    int32_t bar_height = UPLOAD_BAR_HEIGHT - 4;
+    int32_t filled = total ? (int32_t)((uint64_t)bar_width * done / total) : bar_width;
+    tft.fillRect(bar_x, bar_y, filled, bar_height, TFT_GREEN);
+    tft.fillRect(bar_x + filled, bar_y, bar_width - filled, bar_height, TFT_BLACK);
   }
-
-  File file = root.openNextFile();
-  while (file)
+  else if (event == UPLOAD_EVENT_END)
   {
-    if (file.isDirectory())
-    {
-      // Skip directories
-    }
-    else
-    {
-      String temp = file.name();
-
-      // Skip hidden files (starting with .)
-      if (!temp.startsWith(".") && !temp.startsWith("/."))
-      {
-        // Check if file is JPG
-        temp.toLowerCase();
-        if (temp.endsWith(".jpg"))
-        {
-          wavlist.push_back(file.name());
-          Serial.print("Found: ");
-          Serial.println(wavlist.back());
-        }
-      }
-    }
-    file = root.openNextFile();
+    SPI_OFF_SD;
+    tft.setTextDatum(TL_DATUM);
+    logPause(false);
   }
 }
 
-bool tft_output(int16_t x, int16_t y, uint16_t w, uint16_t h, uint16_t *bitmap)
+// The frame has no clock of its own, the overlay clock runs on the time
+// the host sends with every upload and live HELLO
+void uploadSetClock(void *context, uint32_t utc, int32_t utc_offset)
 {
-  // Stop further decoding as image is running off bottom of screen
-  if (y >= tft.height())
-    return 0;
-
-  // This function will clip the image block rendering automatically at the TFT boundaries
-  tft.pushImage(x, y, w, h, bitmap);
-
-  // Return 1 to decode next block
-  return 1;
+  struct timeval now = {(time_t)utc, 0};
+  settimeofday(&now, nullptr);
+
+  // POSIX TZ counts hours west of UTC
+  int32_t west = -utc_offset;
+  int32_t minutes = (west < 0 ? -west : west) / 60;
+  char tz[16];
+  snprintf(tz, sizeof(tz), "UTC%c%d:%02d", west < 0 ? '-' : '+', (int)(minutes / 60), (int)(minutes % 60));
+  setenv("TZ", tz, 1);
+  tzset();
+
+  LOG_INFO("Clock set from host: %lu (%s)", (unsigned long)utc, tz);
 }
 
-void waitForTouchRelease(uint16_t &touch_x, uint16_t &touch_y)
+// Frames outside an upload session, a live session request is run next,
+// a span dump is printed right away
+void uploadFrame(void *context, uint8_t type, const uint8_t *payload, size_t length)
 {
-  while (tft.getTouch(&touch_x, &touch_y, 600))
+  if (LIVE_MODE && type == LIVE_HELLO && length >= UPLOAD_HELLO_LENGTH)
   {
-    delay(50);
+    live_requested_baud = uploadGet32(payload);
+    if (length >= UPLOAD_HELLO_CLOCK_LENGTH)
+      uploadSetClock(context, uploadGet32(payload + 4), (int32_t)uploadGet32(payload + 8));
+  }
+  else if (type == SPAN_REQUEST)
+  {
+    spanDump();
   }
 }
 
-void handleBootButton()
+// Runs an upload session when the host sender says hello, then rescans the
+// card so the new photos join the slideshow
+void handleSerialUpload()
 {
-  if (digitalRead(BOOT_BUTTON) != LOW)
+  // Live sessions and span dumps are requested through the same poll
+#ifndef SPAN_TRACE
+  if (!SERIAL_UPLOAD && !LIVE_MODE)
     return;
+#endif
+
+  static const UploadIo io = {
+      nullptr,
+      uploadSerialRead,
+      uploadSerialWrite,
+      uploadSetBaud,
+      uploadMillis,
+      uploadOpen,
+      uploadFileRead,
+      uploadFileWrite,
+      uploadClose,
+      uploadSize,
+      uploadRemove,
+      uploadRename,
+      uploadEvent,
+      uploadFrame,
+      uploadSetClock,
+  };
 
-  if (millis() - button_pressed_at <= BUTTON_DEBOUNCE)
+  // Nothing touches the card until a HELLO arrives, the session takes the
+  // SD lock in its START event
+  UploadStats stats;
+  if (!uploadPoll(io, &stats))
     return;
 
-  display_on = !display_on;
+  LOG_INFO("Received %d file(s), %lu KB in %lu ms at %lu baud (%lu KB/s)", stats.files,
+           (unsigned long)(stats.bytes / 1024), (unsigned long)stats.elapsed_ms, (unsigned long)stats.baud,
+           (unsigned long)(stats.elapsed_ms ? (uint64_t)stats.bytes * 1000 / 1024 / stats.elapsed_ms : 0));
 
-  if (display_on)
+  // A background scan that finished meanwhile is applied first, the
+  // rebuild below then replaces its list
+  handleBackgroundScan();
+
+  if (stats.files > 0)
   {
-    analogWrite(TFT_BL, (current_brightness_pct * 255) / 100);
-    tft.fillScreen(TFT_BLACK);
-    force_refresh = true;
+    SPI_ON_SD;
+    uint32_t fingerprint = get_image_list("/", file_list);
+    validate_index = 0;
+    if (file_index >= (int)file_list.size())
+      file_index = 0;
+    if (FAST_BOOT)
+      updateDirFingerprint(fingerprint);
+    SPI_OFF_SD;
   }
+
+  tft.fillScreen(TFT_BLACK);
+  force_refresh = true;
+}
+
+// ====== LIVE MODE ======
+
+static_assert(LIVE_WINDOW_BYTES < UPLOAD_RX_BUFFER, "the live window must fit in the serial receive buffer");
+
+bool live_dma = false; // tiles go to the panel by DMA, false when the back buffer owns the DMA setup
+
+uint32_t liveMicros(void *context)
+{
+  return micros();
+}
+
+// JPEG tiles go through tft_output like any photo
+bool liveDrawJpeg(void *context, int16_t x, int16_t y, const uint8_t *data, size_t length)
+{
+  if (live_dma)
+    tft.dmaWait();
+  return fastJpegDrawMem(x, y, data, length) == FASTJPEG_OK;
+}
+
+// RLE tiles are pushed while the next one is received and decoded
+void liveDrawPixels(void *context, int16_t x, int16_t y, uint16_t w, uint16_t h, uint16_t *pixels)
+{
+  if (live_dma)
+    tft.pushImageDMA(x, y, w, h, pixels);
   else
-  {
-    analogWrite(TFT_BL, 0);
-  }
+    tft.pushImage(x, y, w, h, pixels);
+}
 
-  button_pressed_at = millis();
+void liveEvent(void *context, int event)
+{
+  if (event == LIVE_EVENT_START)
+  {
+    logPause(true);
+    clipStop();
+    restoreBacklight();
+    img_orientation = EXIF_ORIENTATION_NORMAL;
+    tft.fillScreen(TFT_BLACK);
 
-  while (digitalRead(BOOT_BUTTON) == LOW)
+    // Tiles arrive byte-swapped, and the bus is held for the whole session
+    tft.setSwapBytes(false);
+    if (live_dma)
+      tft.startWrite();
+  }
+  else if (event == LIVE_EVENT_END)
   {
-    delay(50);
+    if (live_dma)
+    {
+      tft.dmaWait();
+      tft.endWrite();
+    }
+    tft.setSwapBytes(true);
+    logPause(false);
   }
 }
 
-void handleAutoAdvance()
+// Runs a live session requested during the upload poll, then returns to
+// the slideshow
+void handleLiveMode()
 {
-  if (!display_on || settings_screen_visible)
+  if (!LIVE_MODE || live_requested_baud == 0)
     return;
 
-  bool should_advance = force_refresh || (IMAGE_LIFETIME > 0 && millis() - runtime >= IMAGE_LIFETIME);
+  static const LiveIo io = {
+      nullptr,
+      uploadSerialRead,
+      uploadSerialWrite,
+      uploadSetBaud,
+      uploadMillis,
+      liveMicros,
+      liveDrawJpeg,
+      liveDrawPixels,
+      liveEvent,
+  };
 
-  if (should_advance)
+  if (!live_dma && !BACK_BUFFER)
   {
-    drawMainScreen();
+    live_dma = tft.initDMA();
+  }
+
+  LiveStats stats;
+  uint32_t baud = live_requested_baud;
+  live_requested_baud = 0;
+  if (!liveRun(io, baud, Panel::width, Panel::height, &stats))
+  {
+    LOG_ERROR("Live mode: not enough memory for the tile buffers");
+    return;
   }
+
+  LOG_INFO("Live mode: %lu frames (%lu damaged) in %lu ms, %lu.%lu fps, %lu tiles, %lu KB at %lu baud",
+           (unsigned long)stats.frames, (unsigned long)stats.damaged, (unsigned long)stats.elapsed_ms,
+           (unsigned long)(stats.elapsed_ms ? stats.frames * 1000 / stats.elapsed_ms : 0),
+           (unsigned long)(stats.elapsed_ms ? stats.frames * 10000 / stats.elapsed_ms % 10 : 0),
+           (unsigned long)stats.tiles, (unsigned long)(stats.wire_bytes / 1024), (unsigned long)stats.baud);
+  if (stats.frames > 0)
+  {
+    LOG_INFO("Live mode: %lu us decoding and drawing per frame", (unsigned long)(stats.busy_us / stats.frames));
+  }
+
+  tft.fillScreen(TFT_BLACK);
+  force_refresh = true;
 }
 
 void handleMultiTapTimeout()
@@ -338,10 +1595,20 @@ void handleMultiTapTimeout()
 
   if (taps == 2)
   {
+    latencyGesture("settings");
+    overlayInvalidate();
     settings_screen_visible = true;
     showSettingsScreen();
   }
 
+  if (taps == 3 && GALLERY_FITS && thumbsCount() > 0)
+  {
+    latencyGesture("gallery");
+    overlayInvalidate();
+    gallery_visible = true;
+    showGalleryScreen();
+  }
+
   taps = 0;
 }
 
@@ -360,6 +1627,7 @@ void adjustDelayIndex(int direction)
   }
 
   IMAGE_LIFETIME = delay_configs[current_delay_index].delay;
+  latencyGesture("settings adjust");
   showSettingsScreen();
 }
 
@@ -377,70 +1645,130 @@ void adjustBrightness(int delta)
     current_brightness_pct = 100;
   }
 
-  analogWrite(TFT_BL, (current_brightness_pct * 255) / 100);
+  backlightFade(current_brightness_pct, BRIGHTNESS_FADE_MS);
+  latencyGesture("settings adjust");
   showSettingsScreen();
 }
 
 void handleSettingsTouch(uint16_t touch_x, uint16_t touch_y)
 {
-  // Frame Interval buttons (y: 65-105)
-  if (touch_y >= 65 && touch_y <= 105)
+  SPAN("handleSettingsTouch");
+  // Frame Interval buttons
+  if (Settings::intervalMinus().contains(touch_x, touch_y))
   {
-    if (touch_x >= 110 && touch_x <= 150)
-    {
-      adjustDelayIndex(-1);
-      waitForTouchRelease(touch_x, touch_y);
-      return;
-    }
+    adjustDelayIndex(-1);
+    waitForTouchRelease(touch_x, touch_y);
+    return;
+  }
+
+  if (Settings::intervalPlus().contains(touch_x, touch_y))
+  {
+    adjustDelayIndex(1);
+    waitForTouchRelease(touch_x, touch_y);
+    return;
+  }
+
+  // Brightness buttons
+  if (Settings::brightnessMinusTouch().contains(touch_x, touch_y))
+  {
+    adjustBrightness(-10);
+    waitForTouchRelease(touch_x, touch_y);
+    return;
+  }
 
-    if (touch_x >= 330 && touch_x <= 370)
+  if (Settings::brightnessPlusTouch().contains(touch_x, touch_y))
+  {
+    adjustBrightness(10);
+    waitForTouchRelease(touch_x, touch_y);
+    return;
+  }
+
+  // Save & Close button
+  if (Settings::closeTouch().contains(touch_x, touch_y))
+  {
+    if (FAST_BOOT)
     {
-      adjustDelayIndex(1);
-      waitForTouchRelease(touch_x, touch_y);
-      return;
+      saveResumeSettings(current_delay_index, current_brightness_pct);
     }
+
+    latencyGesture("settings close");
+    settings_screen_visible = false;
+    force_refresh = true;
+    runtime = millis();
+    waitForTouchRelease(touch_x, touch_y);
   }
+}
+
+void closeGallery()
+{
+  gallery_visible = false;
+  force_refresh = true;
+  runtime = millis();
+}
+
+void handleGalleryTouch(uint16_t touch_x, uint16_t touch_y)
+{
+  SPAN("handleGalleryTouch");
+  int pages = thumbsPageCount();
 
-  // Brightness buttons (y: 192-232)
-  if (touch_y >= 192 && touch_y <= 232)
+  // Prev / Close / Next buttons
+  if (touch_y >= GALLERY_FOOTER_Y)
   {
-    if (touch_x >= 128 && touch_x <= 168)
+    latencyGesture("gallery page");
+
+    if (touch_x < Panel::sx(160))
     {
-      adjustBrightness(-10);
-      waitForTouchRelease(touch_x, touch_y);
-      return;
+      gallery_page = (gallery_page + pages - 1) % pages;
+      showGalleryScreen();
     }
-
-    if (touch_x >= 312 && touch_x <= 352)
+    else if (touch_x < Panel::sx(320))
     {
-      adjustBrightness(10);
-      waitForTouchRelease(touch_x, touch_y);
-      return;
+      closeGallery();
     }
+    else
+    {
+      gallery_page = (gallery_page + 1) % pages;
+      showGalleryScreen();
+    }
+
+    waitForTouchRelease(touch_x, touch_y);
+    return;
   }
 
-  // Save & Close button (x: 172-312, y: 264-304)
-  if (touch_x >= 172 && touch_x <= 312 && touch_y >= 264 && touch_y <= 304)
+  // Tapping a thumbnail opens its photo
+  if (touch_y >= GALLERY_TOP && touch_y < GALLERY_TOP + GALLERY_ROWS * THUMB_HEIGHT &&
+      touch_x >= GALLERY_LEFT && touch_x < GALLERY_LEFT + GALLERY_COLUMNS * THUMB_WIDTH)
   {
-    settings_screen_visible = false;
-    force_refresh = true;
-    runtime = millis();
+    int slot = ((touch_y - GALLERY_TOP) / THUMB_HEIGHT) * GALLERY_COLUMNS + (touch_x - GALLERY_LEFT) / THUMB_WIDTH;
+    const char *name = thumbsName(slot);
+
+    for (size_t i = 0; i < file_list.size(); i++)
+    {
+      if (file_list[i] == name)
+      {
+        latencyGesture("gallery open");
+        file_index = i;
+        closeGallery();
+        break;
+      }
+    }
+
     waitForTouchRelease(touch_x, touch_y);
   }
 }
 
 void handleCenterTap(uint16_t touch_x, uint16_t touch_y)
 {
+  SPAN("handleCenterTap");
   if (millis() - tapped_at < MULTI_TAP_WINDOW && tapped_at > 0)
   {
     taps++;
-    Serial.print("Incremented taps to: ");
-    Serial.println(taps);
+    LOG_DEBUG("Incremented taps to: %d", taps);
   }
   else
   {
     taps = 1;
-    Serial.println("Starting new tap sequence");
+    LOG_DEBUG("Starting new tap sequence");
   }
 
   tapped_at = millis();
@@ -449,27 +1777,111 @@ void handleCenterTap(uint16_t touch_x, uint16_t touch_y)
 
 void handleSideTouch(uint16_t touch_x, uint16_t touch_y)
 {
-  if (millis() - touched_at <= TOUCH_DEBOUNCE)
+  SPAN("handleSideTouch");
+  if (millis() - touched_at <= TOUCH_DEBOUNCE || file_list.empty())
     return;
 
   touched_at = millis();
 
-  if (touch_x < CENTER_TOUCH_LEFT)
+  if (touch_x < Panel::center_touch_left)
   {
+    latencyGesture("previous");
     file_index = (file_index + file_list.size() - 2) % file_list.size();
+    slide_direction = SCROLL_RIGHT;
     force_refresh = true;
   }
   else
   {
+    latencyGesture("next");
     force_refresh = true;
   }
 
   waitForTouchRelease(touch_x, touch_y);
 }
 
+// Redraws the large photo after a pan or zoom
+void redrawViewport()
+{
+  // Only clear when the new view leaves part of the screen uncovered
+  if (viewport_fit || img_src_w < Panel::width || img_src_h < Panel::height)
+  {
+    tft.fillScreen(TFT_BLACK);
+  }
+
+  if (SHOW_OVERLAY)
+  {
+    overlayResetBand();
+  }
+
+  SPI_ON_SD;
+  drawViewport();
+  SPI_OFF_SD;
+
+  if (SHOW_OVERLAY)
+  {
+    overlayDraw();
+  }
+
+  // Give the viewer time to look before the slideshow moves on
+  runtime = millis();
+
+  latencyComplete();
+}
+
+// Drag pans a large photo, a long press in the center zooms in on the
+// pressed point or back out. Returns false for plain taps so navigation
+// and the settings gesture keep working.
+bool handleViewportTouch(uint16_t touch_x, uint16_t touch_y)
+{
+  SPAN("handleViewportTouch");
+  uint16_t start_x = touch_x, start_y = touch_y;
+  unsigned long pressed_at = millis();
+  waitForTouchRelease(touch_x, touch_y);
+
+  int drag_x = touch_x - start_x;
+  int drag_y = touch_y - start_y;
+
+  if (abs(drag_x) >= PAN_THRESHOLD || abs(drag_y) >= PAN_THRESHOLD)
+  {
+    if (viewport_fit)
+      return true;
+
+    // The photo follows the finger
+    view_x = constrain(view_x - drag_x, 0, max(0, img_src_w - Panel::width));
+    view_y = constrain(view_y - drag_y, 0, max(0, img_src_h - Panel::height));
+    latencyGesture("pan");
+    redrawViewport();
+    return true;
+  }
+
+  bool in_center = start_x >= Panel::center_touch_left && start_x <= Panel::center_touch_right;
+  if (in_center && millis() - pressed_at >= LONG_PRESS_TIME)
+  {
+    if (viewport_fit)
+    {
+      // Center the 1:1 viewport on the pressed point
+      int32_t image_x = (start_x - fit_x) * fit_scale;
+      int32_t image_y = (start_y - fit_y) * fit_scale;
+      view_x = constrain(image_x - Panel::center_x, 0, max(0, img_src_w - Panel::width));
+      view_y = constrain(image_y - Panel::center_y, 0, max(0, img_src_h - Panel::height));
+    }
+
+    viewport_fit = !viewport_fit;
+    latencyGesture("zoom");
+    redrawViewport();
+    return true;
+  }
+
+  return false;
+}
+
 void handleSlideshowTouch(uint16_t touch_x, uint16_t touch_y)
 {
-  if (touch_x >= CENTER_TOUCH_LEFT && touch_x <= CENTER_TOUCH_RIGHT)
+  SPAN("handleSlideshowTouch");
+  if (viewport_active && handleViewportTouch(touch_x, touch_y))
+    return;
+
+  if (touch_x >= Panel::center_touch_left && touch_x <= Panel::center_touch_right)
   {
     handleCenterTap(touch_x, touch_y);
   }
@@ -483,36 +1895,141 @@ void handleTouchInput()
 {
   uint16_t touch_x = 0, touch_y = 0;
 
-  if (!tft.getTouch(&touch_x, &touch_y, 600))
+  if (!inputGetTouch(tft, &touch_x, &touch_y))
     return;
 
+  SPAN("handleTouchInput");
   if (settings_screen_visible)
   {
     handleSettingsTouch(touch_x, touch_y);
   }
+  else if (gallery_visible)
+  {
+    handleGalleryTouch(touch_x, touch_y);
+  }
   else
   {
     handleSlideshowTouch(touch_x, touch_y);
   }
+
+  // A touch just before the next photo was due keeps the screen lit,
+  // unless it changed the photo itself
+  if (!force_refresh)
+    restoreBacklight();
+}
+
+// ====== BENCHMARK ======
+
+// Decode paths timed by the benchmark
+enum BenchmarkPath
+{
+  BENCHMARK_TJPGDEC,
+  BENCHMARK_DITHERED,
+  BENCHMARK_FAST,
+  BENCHMARK_PATHS
+};
+
+const char *benchmark_labels[BENCHMARK_PATHS] = {"TJpgDec RGB565 swap", "dithered RGB888", "fast decoder"};
+
+// Decodes the first BENCHMARK_IMAGES photos with TJpgDec, the dithered path
+// and the fast decoder and prints images per second for each, so both
+// alternatives can be checked against the setSwapBytes(true) baseline
+void runDecodeBenchmark()
+{
+  size_t count = min(file_list.size(), (size_t)BENCHMARK_IMAGES);
+  if (count == 0)
+    return;
+
+  LOG_INFO("Decode benchmark over %u images on a %dx%d panel", (unsigned)count, Panel::width, Panel::height);
+
+  for (int pass = 0; pass < BENCHMARK_PATHS; pass++)
+  {
+    unsigned long started_at = millis();
+
+    SPI_ON_SD;
+    for (size_t i = 0; i < count; i++)
+    {
+      char filepath[MAX_PATH_LENGTH];
+      buildFilePath(filepath, sizeof(filepath), file_list[i].c_str());
+      if (clipIsClip(filepath))
+        continue;
+
+      uint16_t img_w = 0, img_h = 0;
+      TJpgDec.getFsJpgSize(&img_w, &img_h, filepath, SD);
+
+      img_orientation = EXIF_ORIENTATION_NORMAL;
+      int32_t x = Panel::centerLeft(img_w);
+      int32_t y = Panel::centerTop(img_h);
+
+      if (pass == BENCHMARK_TJPGDEC)
+      {
+        TJpgDec.drawSdJpg(x, y, filepath);
+      }
+      else if (pass == BENCHMARK_DITHERED)
+      {
+        drawSdImage(x, y, filepath, true);
+      }
+      else
+      {
+        tft.setSwapBytes(false);
+        fastJpegDrawFs(x, y, filepath, SD);
+        tft.setSwapBytes(true);
+      }
+    }
+    SPI_OFF_SD;
+
+    unsigned long elapsed = millis() - started_at;
+    LOG_INFO("  %s: %lu ms total, %lu ms/image, %.2f images/s",
+             benchmark_labels[pass], elapsed, elapsed / count,
+             elapsed > 0 ? count * 1000.0 / elapsed : 0.0);
+  }
+
+  // Same decoder fed from mapped flash, the gap to the SD pass is the cost of the SD bus
+  size_t album_images = min((size_t)albumCount(), (size_t)BENCHMARK_IMAGES);
+  if (album_images == 0)
+    return;
+
+  unsigned long started_at = millis();
+  img_orientation = EXIF_ORIENTATION_NORMAL;
+
+  for (size_t i = 0; i < album_images; i++)
+  {
+    uint32_t size = 0;
+    const uint8_t *data = albumData(i, &size);
+    uint16_t img_w = 0, img_h = 0;
+    TJpgDec.getJpgSize(&img_w, &img_h, data, size);
+    TJpgDec.drawJpg(Panel::centerLeft(img_w), Panel::centerTop(img_h), data, size);
+  }
+
+  unsigned long elapsed = millis() - started_at;
+  LOG_INFO("  flash album RGB565 swap: %u images, %lu ms total, %lu ms/image, %.2f images/s",
+           (unsigned)album_images, elapsed, elapsed / album_images,
+           elapsed > 0 ? album_images * 1000.0 / elapsed : 0.0);
 }
 
 // ====== SETUP ======
 
 void setup(void)
 {
-  Serial.begin(115200);
-  Serial.println("ESP32-32E Photo Frame Starting...");
+  if (SERIAL_UPLOAD || LIVE_MODE)
+  {
+    // Set before begin(), a full window of DATA frames must fit
+    Serial.setRxBufferSize(UPLOAD_RX_BUFFER);
+  }
+  Serial.begin(UPLOAD_DEFAULT_BAUD);
+  logBegin();
+  LOG_INFO("ESP32-32E Photo Frame Starting...");
 
   // Initialize boot button
   pinMode(BOOT_BUTTON, INPUT_PULLUP);
 
-  // Initialize backlight pin with PWM
-  pinMode(TFT_BL, OUTPUT);
-  analogWrite(TFT_BL, (current_brightness_pct * 255) / 100); // Set initial brightness with PWM
+  // Initialize backlight pin with PWM, faded by the LEDC hardware
+  backlightBegin(TFT_BL, current_brightness_pct);
 
   // Initialize chip select pin for SD
+  sd_mutex = xSemaphoreCreateRecursiveMutex();
   pinMode(SD_CS, OUTPUT);
-  SPI_OFF_SD;
+  digitalWrite(SD_CS, HIGH);
 
   // Initialize TFT (TFT_eSPI handles its own SPI and touch setup)
   tft.init();
@@ -523,30 +2040,49 @@ void setup(void)
   tft.setSwapBytes(true);
 
   // Display "Booting up..." message
-  int16_t title_y = SCREEN_CENTER_Y - 40;
-  tft.setTextSize(4);
-  tft.drawString("Booting up...", SCREEN_CENTER_X, title_y);
+  int16_t title_y = Panel::center_y - Panel::sy(40);
+  tft.setTextSize(Panel::textSize(4));
+  tft.drawString("Booting up...", Panel::center_x, title_y);
 
   // Helper function to display setup steps
   auto displayStep = [&](const char *step)
   {
-    int16_t step_y = title_y + 50;
+    int16_t step_y = title_y + Panel::sy(50);
 
     // Clear previous step text area
-    tft.setTextSize(2);
-    tft.fillRect(0, step_y, tft.width(), 25, TFT_BLACK);
-    tft.drawString(step, SCREEN_CENTER_X, step_y);
+    tft.setTextSize(Panel::textSize(2));
+    tft.fillRect(0, step_y, Panel::width, Panel::sy(25), TFT_BLACK);
+    tft.drawString(step, Panel::center_x, step_y);
   };
 
   // Calibrate touch for rotation 1 (landscape)
   uint16_t calData[5] = TOUCH_CALIBRATION;
   tft.setTouch(calData);
 
-  Serial.println("TFT and Touch initialized");
+  LOG_INFO("TFT and Touch initialized");
 
   // Initialize TJpg_Decoder
   TJpgDec.setJpgScale(1);
   TJpgDec.setCallback(tft_output);
+  ditherInit(tft_output);
+  fastJpegInit(tft_output);
+  roiInit(tft_output, DITHER_DECODE);
+
+  if (SHOW_OVERLAY)
+  {
+    overlayBegin(tft);
+  }
+
+  if (BACK_BUFFER && backBufferBegin(tft) && SLIDE_TRANSITIONS)
+  {
+    scrollBegin(tft);
+  }
+
+  // Built-in album, played when the SD card is unavailable
+  if (albumOpen())
+  {
+    LOG_INFO("Found %d photos in the built-in album", albumCount());
+  }
 
   // Initialize VSPI for SD Card (separate bus from TFT)
   SPI.begin(VSPI_SCK, VSPI_MISO, VSPI_MOSI, SD_CS);
@@ -554,29 +2090,87 @@ void setup(void)
   // Initialize SD Card on VSPI
   displayStep("Mounting SD card...");
   SPI_ON_SD;
-  if (!SD.begin(SD_CS, SPI, 4000000))
+  if (!SD.begin(SD_CS, SPI, 4000000, SD_MOUNT_POINT))
   {
     displayStep("SD Card Mount Failed!");
-    Serial.println("SD Card Mount Failed!");
+    LOG_ERROR("SD Card Mount Failed!");
     SPI_OFF_SD;
+
+    if (startAlbumSlideshow())
+    {
+      displayStep("Playing built-in album");
+      delay(800);
+      heapGuardArm();
+      tft.fillScreen(TFT_BLACK);
+      return;
+    }
+
     while (1)
       delay(1000);
   }
-  Serial.println("SD Card Mount Succeeded");
+  LOG_INFO("SD Card Mount Succeeded");
+
+  // Known broken photos are skipped while scanning
+  quarantineLoad(SD);
+
+  // Gallery is only available when the card carries a thumbnail file
+  if (thumbsOpen(SD))
+  {
+    LOG_INFO("Found %d thumbnails", thumbsCount());
+  }
+  SPI_OFF_SD;
+
+  bool has_resume = false;
+  if (FAST_BOOT)
+  {
+    resumeBegin();
+    has_resume = loadResumeState(resume_state);
+  }
+
+  if (has_resume)
+  {
+    applyResumeSettings();
+  }
+
+  // Fast boot: show the last photo now and scan the card in the background.
+  // Benchmark builds always take the full scan, the benchmark runs after it.
+  if (has_resume && !DECODE_BENCHMARK && resumeSlideshow())
+  {
+    LOG_INFO("Fast boot complete!");
+    return;
+  }
+
   delay(300);
 
   displayStep("Scanning SD card...");
-  get_image_list(SD, "/", file_list);
+  SPI_ON_SD;
+  uint32_t fingerprint = get_image_list("/", file_list);
   delay(300);
 
   // Display photo count
-  String photo_count = "Found " + String(file_list.size()) + " photos";
-  displayStep(photo_count.c_str());
+  char photo_count[32];
+  snprintf(photo_count, sizeof(photo_count), "Found %u photos", (unsigned)file_list.size());
+  displayStep(photo_count);
   delay(800);
 
   SPI_OFF_SD;
 
-  Serial.println("Initialization complete!");
+  if (FAST_BOOT)
+  {
+    updateDirFingerprint(fingerprint);
+  }
+
+  if (DECODE_BENCHMARK)
+  {
+    displayStep("Running decode benchmark...");
+    runDecodeBenchmark();
+  }
+
+  LOG_INFO("Initialization complete!");
+
+  // The file list is built, the slideshow must not allocate from here on
+  file_list.shrink_to_fit();
+  heapGuardArm();
 
   // Clear screen before starting slideshow
   tft.fillScreen(TFT_BLACK);
@@ -586,8 +2180,18 @@ void setup(void)
 
 void loop()
 {
+  inputTraceTick();
+  handleBackgroundScan();
   handleBootButton();
   handleAutoAdvance();
+  handleClip();
+  handleOverlay();
+  handleValidation();
+#ifndef INPUT_TRACE
+  // Input trace replays its events from the same port
+  handleSerialUpload();
+  handleLiveMode();
+#endif
   handleMultiTapTimeout();
   handleTouchInput();
 }
@@ -0,0 +1,148 @@
+#include "overlay.h"
+#include <time.h>
+#include "panel.h"
+#include "log.h"
+
+#define OVERLAY_TEXT_COLOR TFT_WHITE
+#define OVERLAY_SHADOW_COLOR TFT_BLACK
+#define OVERLAY_FONT 2
+#define OVERLAY_MARGIN 6
+
+// System time before this is treated as "not set" and the clock is hidden
+#define OVERLAY_MIN_VALID_TIME 1600000000
+
+static TFT_eSPI *overlay_tft = nullptr;
+static TFT_eSprite *overlay_sprite = nullptr;
+
+static constexpr int16_t band_width = Panel::width;
+static constexpr int16_t band_y = Panel::height - OVERLAY_HEIGHT;
+static uint16_t *band_pixels = nullptr; // decoded photo under the band, byte-swapped
+static bool band_valid = false;
+
+static char caption[64];
+static char counter[16];
+static time_t drawn_minute = -1;
+
+bool overlayBegin(TFT_eSPI &tft)
+{
+  overlay_tft = &tft;
+
+  // Both buffers live for the whole run, nothing is allocated per slide
+  band_pixels = (uint16_t *)malloc(band_width * OVERLAY_HEIGHT * sizeof(uint16_t));
+
+  overlay_sprite = new TFT_eSprite(&tft);
+  overlay_sprite->setColorDepth(16);
+
+  if (!band_pixels || !overlay_sprite->createSprite(band_width, OVERLAY_HEIGHT))
+  {
+    LOG_ERROR("Overlay buffers could not be allocated");
+    return false;
+  }
+
+  overlayResetBand();
+  return true;
+}
+
+void overlayResetBand()
+{
+  if (!band_pixels)
+    return;
+
+  memset(band_pixels, 0, band_width * OVERLAY_HEIGHT * sizeof(uint16_t));
+  band_valid = true;
+}
+
+void overlayCapture(int16_t x, int16_t y, uint16_t w, uint16_t h, const uint16_t *pixels, bool swapped)
+{
+  if (!band_pixels || y + h <= band_y || y >= band_y + OVERLAY_HEIGHT)
+    return;
+
+  int16_t row_start = max(y, band_y);
+  int16_t row_end = min((int16_t)(y + h), (int16_t)(band_y + OVERLAY_HEIGHT));
+  int16_t col_start = max(x, (int16_t)0);
+  int16_t col_end = min((int16_t)(x + w), band_width);
+
+  for (int16_t row = row_start; row < row_end; row++)
+  {
+    const uint16_t *src = pixels + (row - y) * w + (col_start - x);
+    uint16_t *dst = band_pixels + (row - band_y) * band_width + col_start;
+
+    for (int16_t col = col_start; col < col_end; col++)
+    {
+      uint16_t pixel = *src++;
+      *dst++ = swapped ? pixel : (pixel >> 8) | (pixel << 8);
+    }
+  }
+}
+
+void overlaySetPhoto(const char *name, int index, int count)
+{
+  snprintf(caption, sizeof(caption), "%s", name);
+
+  if (count > 0)
+    snprintf(counter, sizeof(counter), "%d/%d", index + 1, count);
+  else
+    counter[0] = '\0';
+}
+
+// Text with a one pixel shadow so it stays readable on bright photos
+static void drawShadowedString(const char *text, int32_t x, int32_t y)
+{
+  overlay_sprite->setTextColor(OVERLAY_SHADOW_COLOR);
+  overlay_sprite->drawString(text, x + 1, y + 1);
+  overlay_sprite->setTextColor(OVERLAY_TEXT_COLOR);
+  overlay_sprite->drawString(text, x, y);
+}
+
+void overlayDraw()
+{
+  if (!band_pixels || !band_valid)
+    return;
+
+  unsigned long started_at = micros();
+
+  // Start from the clean photo strip, sprites keep 16-bit pixels byte-swapped
+  memcpy(overlay_sprite->getPointer(), band_pixels, band_width * OVERLAY_HEIGHT * sizeof(uint16_t));
+
+  int32_t text_y = OVERLAY_HEIGHT / 2;
+  overlay_sprite->setTextFont(OVERLAY_FONT);
+  overlay_sprite->setTextSize(1);
+
+  overlay_sprite->setTextDatum(ML_DATUM);
+  drawShadowedString(caption, OVERLAY_MARGIN, text_y);
+
+  overlay_sprite->setTextDatum(MC_DATUM);
+  drawShadowedString(counter, band_width / 2, text_y);
+
+  time_t now = time(nullptr);
+  drawn_minute = now / 60;
+
+  if (now >= OVERLAY_MIN_VALID_TIME)
+  {
+    struct tm local;
+    localtime_r(&now, &local);
+
+    char clock[8];
+    snprintf(clock, sizeof(clock), "%02d:%02d", local.tm_hour, local.tm_min);
+
+    overlay_sprite->setTextDatum(MR_DATUM);
+    drawShadowedString(clock, band_width - OVERLAY_MARGIN, text_y);
+  }
+
+  overlay_sprite->pushSprite(0, band_y);
+
+  LOG_INFO("Overlay drawn in %lu us", micros() - started_at);
+}
+
+void overlayTick()
+{
+  if (!band_valid || time(nullptr) / 60 == drawn_minute)
+    return;
+
+  overlayDraw();
+}
+
+void overlayInvalidate()
+{
+  band_valid = false;
+}
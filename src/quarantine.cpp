@@ -0,0 +1,372 @@
+#include "quarantine.h"
+#include "log.h"
+
+#include <sys/stat.h>
+
+#define JPEG_MARKER_SOI 0xD8
+#define JPEG_MARKER_EOI 0xD9
+#define JPEG_MARKER_SOF0 0xC0
+#define JPEG_MARKER_DHT 0xC4
+#define JPEG_MARKER_JPG 0xC8
+#define JPEG_MARKER_DAC 0xCC
+#define JPEG_MARKER_SOS 0xDA
+
+// Trailing bytes searched for EOI, some cameras pad the end of the file
+#define EOI_SEARCH_BYTES 32
+
+#define QUARANTINE_TEMP_PATH "/quarantine.tmp"
+
+// Size of entries written before sizes were recorded, never matches
+#define QUARANTINE_NO_SIZE 0xFFFFFFFFu
+
+// Longest line read back from the list
+#define QUARANTINE_LINE_MAX 160
+
+#define FNV_OFFSET_BASIS 2166136261u
+#define FNV_PRIME 16777619u
+
+struct QuarantineEntry
+{
+  uint32_t name_hash;
+  uint32_t size; // file size when it was quarantined
+};
+
+static QuarantineEntry quarantine_entries[QUARANTINE_MAX];
+static int quarantine_count = 0;
+static bool quarantine_dirty = false; // entries dropped since the last save
+
+static const char *reasons[] = {
+    "valid",
+    "not a JPEG",
+    "broken header",
+    "unsupported frame type",
+    "unsupported subsampling",
+    "truncated"};
+
+const char *validateReason(int reason)
+{
+  if (reason < 0 || reason >= (int)(sizeof(reasons) / sizeof(reasons[0])))
+    return "unknown";
+
+  return reasons[reason];
+}
+
+static int validateFrame(const uint8_t *sof, uint16_t length)
+{
+  // precision, height, width, component count, then 3 bytes per component
+  if (length < 8 || sof[0] != 8)
+    return JPEG_UNSUPPORTED;
+
+  uint16_t height = (sof[1] << 8) | sof[2];
+  uint16_t width = (sof[3] << 8) | sof[4];
+  uint8_t components = sof[5];
+
+  if (width == 0 || height == 0 || (components != 1 && components != 3) || length < 8 + components * 3)
+    return JPEG_BAD_HEADER;
+
+  if (components == 3)
+  {
+    uint8_t luma = sof[7];
+    if (luma != 0x11 && luma != 0x21 && luma != 0x22)
+      return JPEG_BAD_SUBSAMPLING;
+
+    // Chroma is never subsampled relative to the MCU
+    if (sof[10] != 0x11 || sof[13] != 0x11)
+      return JPEG_BAD_SUBSAMPLING;
+  }
+
+  return JPEG_VALID;
+}
+
+int validateJpeg(fs::FS &fs, const char *path)
+{
+  File file = fs.open(path);
+  if (!file)
+    return JPEG_BAD_HEADER;
+
+  uint8_t bytes[EOI_SEARCH_BYTES];
+  int result = JPEG_BAD_HEADER;
+  bool has_frame = false;
+
+  if (file.read(bytes, 2) != 2 || bytes[0] != 0xFF || bytes[1] != JPEG_MARKER_SOI)
+  {
+    file.close();
+    return JPEG_NOT_JPEG;
+  }
+
+  while (file.read(bytes, 4) == 4 && bytes[0] == 0xFF)
+  {
+    uint8_t marker = bytes[1];
+    uint16_t length = (bytes[2] << 8) | bytes[3];
+    if (length < 2)
+      break;
+
+    if (marker == JPEG_MARKER_SOS)
+    {
+      result = has_frame ? JPEG_VALID : JPEG_BAD_HEADER;
+      break;
+    }
+
+    if (marker == JPEG_MARKER_SOF0)
+    {
+      uint8_t sof[8 + 3 * 3];
+      size_t wanted = min((size_t)(length - 2), sizeof(sof));
+      if (file.read(sof, wanted) != wanted)
+        break;
+
+      result = validateFrame(sof, length);
+      if (result != JPEG_VALID)
+        break;
+
+      has_frame = true;
+      result = JPEG_BAD_HEADER;
+      if (!file.seek(file.position() + (length - 2) - wanted))
+        break;
+      continue;
+    }
+
+    // Any other start-of-frame is progressive, lossless or arithmetic coded
+    if (marker >= 0xC1 && marker <= 0xCF && marker != JPEG_MARKER_DHT &&
+        marker != JPEG_MARKER_JPG && marker != JPEG_MARKER_DAC)
+    {
+      result = JPEG_UNSUPPORTED;
+      break;
+    }
+
+    if (!file.seek(file.position() + length - 2))
+      break;
+  }
+
+  // A file cut short while copying has no EOI at its end
+  if (result == JPEG_VALID)
+  {
+    size_t size = file.size();
+    size_t tail = min(size, (size_t)EOI_SEARCH_BYTES);
+    result = JPEG_TRUNCATED;
+
+    if (file.seek(size - tail) && file.read(bytes, tail) == tail)
+    {
+      for (size_t i = 0; i + 1 < tail; i++)
+      {
+        if (bytes[i] == 0xFF && bytes[i + 1] == JPEG_MARKER_EOI)
+        {
+          result = JPEG_VALID;
+          break;
+        }
+      }
+    }
+  }
+
+  file.close();
+  return result;
+}
+
+static uint32_t hashName(const char *name)
+{
+  // Names can come with or without the leading "/"
+  if (*name == '/')
+    name++;
+
+  uint32_t hash = FNV_OFFSET_BASIS;
+  for (; *name; name++)
+    hash = (hash ^ (uint8_t)*name) * FNV_PRIME;
+
+  return hash;
+}
+
+static int findEntry(uint32_t hash)
+{
+  for (int i = 0; i < quarantine_count; i++)
+  {
+    if (quarantine_entries[i].name_hash == hash)
+      return i;
+  }
+
+  return -1;
+}
+
+static void addEntry(uint32_t hash, uint32_t size)
+{
+  if (quarantine_count >= QUARANTINE_MAX)
+    return;
+
+  quarantine_entries[quarantine_count].name_hash = hash;
+  quarantine_entries[quarantine_count].size = size;
+  quarantine_count++;
+}
+
+static void removeEntry(int index)
+{
+  quarantine_entries[index] = quarantine_entries[quarantine_count - 1];
+  quarantine_count--;
+  quarantine_dirty = true;
+}
+
+// Reads one line without its newline. Returns false at the end of the file.
+static bool readLine(File &file, char *line, size_t size)
+{
+  size_t length = 0;
+  int c;
+
+  while ((c = file.read()) >= 0 && c != '\n')
+  {
+    if (length < size - 1)
+      line[length++] = c;
+  }
+
+  line[length] = '\0';
+  return c >= 0 || length > 0;
+}
+
+// Splits "name<TAB>size<TAB>reason" in place. Lines from before sizes were
+// recorded are "name<TAB>reason" and get QUARANTINE_NO_SIZE.
+static bool parseLine(char *line, QuarantineEntry &entry)
+{
+  char *tab = strchr(line, '\t');
+  if (tab)
+    *tab = '\0';
+  if (line[0] == '\0')
+    return false;
+
+  entry.name_hash = hashName(line);
+  entry.size = QUARANTINE_NO_SIZE;
+
+  if (tab)
+  {
+    char *end;
+    unsigned long size = strtoul(tab + 1, &end, 10);
+    if (end != tab + 1 && (*end == '\t' || *end == '\0'))
+      entry.size = size;
+  }
+
+  return true;
+}
+
+void quarantineLoad(fs::FS &fs)
+{
+  File file = fs.open(QUARANTINE_PATH);
+  if (!file)
+    return;
+
+  char line[QUARANTINE_LINE_MAX];
+  QuarantineEntry entry;
+
+  while (readLine(file, line, sizeof(line)))
+  {
+    if (parseLine(line, entry) && findEntry(entry.name_hash) < 0)
+      addEntry(entry.name_hash, entry.size);
+  }
+
+  file.close();
+  LOG_INFO("Quarantine list: %d files", quarantine_count);
+}
+
+bool quarantineContains(const char *dir, const char *name)
+{
+  if (*name == '/')
+    name++;
+
+  int index = findEntry(hashName(name));
+  if (index < 0)
+    return false;
+
+  char path[QUARANTINE_LINE_MAX];
+  snprintf(path, sizeof(path), "%s%s", dir, name);
+
+  struct stat info;
+  if (stat(path, &info) == 0 && (uint32_t)info.st_size == quarantine_entries[index].size)
+    return true;
+
+  // Replaced, gone, or a different file with a colliding name hash
+  removeEntry(index);
+  LOG_INFO("Released from quarantine: %s", name);
+  return false;
+}
+
+void quarantineAdd(fs::FS &fs, const char *path, const char *reason)
+{
+  const char *name = *path == '/' ? path + 1 : path;
+  uint32_t hash = hashName(name);
+
+  if (findEntry(hash) >= 0)
+    return;
+
+  File file = fs.open(path);
+  if (!file)
+    return;
+  uint32_t size = file.size();
+  file.close();
+
+  addEntry(hash, size);
+
+  file = fs.open(QUARANTINE_PATH, FILE_APPEND);
+  if (!file)
+    return;
+
+  file.print(name);
+  file.print("\t");
+  file.print(size);
+  file.print("\t");
+  file.println(reason);
+  file.close();
+}
+
+void quarantineRemove(fs::FS &fs, const char *path)
+{
+  int index = findEntry(hashName(path));
+  if (index < 0)
+    return;
+
+  removeEntry(index);
+  quarantineSave(fs);
+}
+
+void quarantineSave(fs::FS &fs)
+{
+  if (!quarantine_dirty)
+    return;
+
+  quarantine_dirty = false;
+
+  File in = fs.open(QUARANTINE_PATH);
+  if (!in)
+    return;
+
+  File out = fs.open(QUARANTINE_TEMP_PATH, FILE_WRITE);
+  if (!out)
+  {
+    in.close();
+    return;
+  }
+
+  // Lines are copied as they are while their entry is still listed
+  char line[QUARANTINE_LINE_MAX];
+  char fields[QUARANTINE_LINE_MAX];
+  QuarantineEntry entry;
+
+  while (readLine(in, line, sizeof(line)))
+  {
+    memcpy(fields, line, sizeof(fields));
+    if (!parseLine(fields, entry))
+      continue;
+
+    int index = findEntry(entry.name_hash);
+    if (index >= 0 && quarantine_entries[index].size == entry.size)
+      out.println(line);
+  }
+
+  in.close();
+  out.close();
+
+  fs.remove(QUARANTINE_PATH);
+  fs.rename(QUARANTINE_TEMP_PATH, QUARANTINE_PATH);
+}
+
+void quarantineClear(fs::FS &fs)
+{
+  quarantine_count = 0;
+  quarantine_dirty = false;
+
+  if (fs.exists(QUARANTINE_PATH))
+    fs.remove(QUARANTINE_PATH);
+}
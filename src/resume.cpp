@@ -0,0 +1,81 @@
+#include "resume.h"
+#include <Preferences.h>
+
+#define RESUME_NAMESPACE "photoframe"
+
+#define FNV_PRIME 16777619u
+
+static Preferences prefs;
+
+// Position recorded since the last NVS write
+static int pending_index = 0;
+static char pending_file[RESUME_NAME_MAX];
+static uint32_t pending_slides = 0;
+static unsigned long saved_at = 0;
+
+void resumeBegin()
+{
+  prefs.begin(RESUME_NAMESPACE, false);
+}
+
+bool loadResumeState(ResumeState &state)
+{
+  // The fingerprint is kept even before a position was saved
+  state.dir_fingerprint = prefs.getUInt("dirfp", 0);
+  if (!prefs.isKey("file"))
+    return false;
+
+  state.file_index = prefs.getInt("index", 0);
+  prefs.getString("file", state.filename, sizeof(state.filename));
+  state.delay_index = prefs.getInt("delay", 0);
+  state.brightness_pct = prefs.getInt("bright", 100);
+
+  return state.filename[0] != '\0';
+}
+
+void saveResumePosition(int file_index, const char *filename)
+{
+  pending_index = file_index;
+  snprintf(pending_file, sizeof(pending_file), "%s", filename);
+  pending_slides++;
+
+  if (pending_slides >= RESUME_SAVE_SLIDES || millis() - saved_at >= RESUME_SAVE_MS)
+    resumeFlush();
+}
+
+void resumeFlush()
+{
+  if (pending_slides == 0)
+    return;
+
+  prefs.putInt("index", pending_index);
+  prefs.putString("file", pending_file);
+  pending_slides = 0;
+  saved_at = millis();
+}
+
+void saveResumeSettings(int delay_index, int brightness_pct)
+{
+  resumeFlush();
+  prefs.putInt("delay", delay_index);
+  prefs.putInt("bright", brightness_pct);
+}
+
+void saveResumeFingerprint(uint32_t fingerprint)
+{
+  prefs.putUInt("dirfp", fingerprint);
+}
+
+static uint32_t fnvMix(uint32_t hash, uint8_t byte)
+{
+  return (hash ^ byte) * FNV_PRIME;
+}
+
+uint32_t fingerprintAddName(uint32_t fingerprint, const char *name)
+{
+  for (const char *c = name; *c; c++)
+    fingerprint = fnvMix(fingerprint, *c);
+
+  // Separator so "ab","c" and "a","bc" differ
+  return fnvMix(fingerprint, '/');
+}
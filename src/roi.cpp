@@ -0,0 +1,440 @@
+#include "roi.h"
+#include "esp32/rom/tjpgd.h"
+#include "log.h"
+
+#define ROI_HEADER_MAX 2048
+#define ROI_SCAN_CHUNK 512
+
+#define JPEG_SOI 0xD8
+#define JPEG_EOI 0xD9
+#define JPEG_SOF0 0xC0
+#define JPEG_DHT 0xC4
+#define JPEG_SOS 0xDA
+#define JPEG_DQT 0xDB
+#define JPEG_DRI 0xDD
+#define JPEG_RST0 0xD0
+#define JPEG_RST7 0xD7
+
+// Restart interval index of the open file, on the heap while it is open
+struct RoiIndex
+{
+  char path[128];
+  uint16_t width;
+  uint16_t height;
+  uint8_t mcu_w;
+  uint8_t mcu_h;
+  uint16_t mcus_x;
+  uint16_t restart_interval; // MCUs per interval
+  uint32_t interval_count;
+  uint32_t data_end;  // file offset of EOI
+  uint16_t sof_at;    // offset of the SOF payload inside header
+  uint16_t header_len;
+  uint8_t header[ROI_HEADER_MAX]; // SOI, DQT, SOF, DHT, DRI and SOS, without APPn/COM
+};
+
+static RoiIndex *roi_index = nullptr;
+static uint32_t *interval_offsets = nullptr; // first entropy byte of each interval
+static bool index_valid = false;
+
+static uint8_t scan_buffer[ROI_SCAN_CHUNK];
+
+static DitherOutputCallback output_callback = nullptr;
+static bool output_dithered = true;
+
+// One MCU row run fed to the decoder: headers, then intervals first..last.
+// No EOI follows, the input simply ends after the last interval and
+// decodeRun() accepts the short read that leaves.
+struct RoiStream
+{
+  fs::File *file;
+  uint16_t header_pos;
+  uint32_t first;   // first interval of the run
+  uint32_t last;    // last interval of the run
+  uint32_t current; // interval being streamed
+  uint32_t file_pos;
+  uint32_t file_end;
+  uint8_t marker[2]; // renumbered restart marker between intervals
+  uint8_t marker_pos;
+  bool done;
+
+  // Where the run lands
+  uint16_t row;
+  uint16_t col_first;
+  uint16_t col_last;
+  int32_t view_x;
+  int32_t view_y;
+  uint16_t view_w;
+  uint16_t view_h;
+  int32_t dest_x;
+  int32_t dest_y;
+};
+
+static RoiStream stream;
+
+void roiInit(DitherOutputCallback callback, bool dithered)
+{
+  output_callback = callback;
+  output_dithered = dithered;
+}
+
+uint16_t roiImageWidth()
+{
+  return index_valid ? roi_index->width : 0;
+}
+
+uint16_t roiImageHeight()
+{
+  return index_valid ? roi_index->height : 0;
+}
+
+void roiClose()
+{
+  free(interval_offsets);
+  free(roi_index);
+  interval_offsets = nullptr;
+  roi_index = nullptr;
+  index_valid = false;
+}
+
+// Copies the decoder relevant segments into the index header
+static bool indexHeaders(fs::File &file)
+{
+  uint8_t bytes[4];
+  if (file.read(bytes, 2) != 2 || bytes[0] != 0xFF || bytes[1] != JPEG_SOI)
+    return false;
+
+  roi_index->header[0] = 0xFF;
+  roi_index->header[1] = JPEG_SOI;
+  roi_index->header_len = 2;
+  roi_index->restart_interval = 0;
+  roi_index->mcu_w = 0;
+
+  while (true)
+  {
+    if (file.read(bytes, 4) != 4 || bytes[0] != 0xFF)
+      return false;
+
+    uint8_t marker = bytes[1];
+    uint16_t length = (bytes[2] << 8) | bytes[3];
+    bool keep = marker == JPEG_DQT || marker == JPEG_SOF0 || marker == JPEG_DHT ||
+                marker == JPEG_DRI || marker == JPEG_SOS;
+
+    // Progressive and other frame types are not supported by tjpgd
+    if (marker >= 0xC1 && marker <= 0xCF && marker != JPEG_DHT && marker != 0xC8 && marker != 0xCC)
+      return false;
+
+    if (!keep)
+    {
+      if (!file.seek(file.position() + length - 2))
+        return false;
+      continue;
+    }
+
+    if (roi_index->header_len + 2 + length > ROI_HEADER_MAX)
+      return false;
+
+    uint8_t *segment = roi_index->header + roi_index->header_len;
+    memcpy(segment, bytes, 4);
+    if (file.read(segment + 4, length - 2) != (size_t)(length - 2))
+      return false;
+
+    if (marker == JPEG_SOF0)
+    {
+      roi_index->sof_at = roi_index->header_len + 4;
+      roi_index->height = (segment[5] << 8) | segment[6];
+      roi_index->width = (segment[7] << 8) | segment[8];
+
+      // MCU size follows the luma sampling factors
+      uint8_t components = segment[9];
+      uint8_t sampling = components == 3 ? segment[11] : 0x11;
+      roi_index->mcu_w = (sampling >> 4) * 8;
+      roi_index->mcu_h = (sampling & 0x0F) * 8;
+    }
+    else if (marker == JPEG_DRI)
+    {
+      roi_index->restart_interval = (segment[4] << 8) | segment[5];
+    }
+
+    roi_index->header_len += 2 + length;
+
+    if (marker == JPEG_SOS)
+      return roi_index->mcu_w > 0 && roi_index->mcu_w <= 16 && roi_index->mcu_h <= 16;
+  }
+}
+
+// Records the start of every restart interval in the entropy coded data,
+// into the expected count allocated by roiOpen()
+static bool indexIntervals(fs::File &file, uint32_t expected)
+{
+  uint32_t count = 0;
+  interval_offsets[count++] = file.position();
+
+  bool after_ff = false;
+  uint32_t chunk_start = file.position();
+  size_t got;
+
+  while ((got = file.read(scan_buffer, ROI_SCAN_CHUNK)) > 0)
+  {
+    for (size_t i = 0; i < got; i++)
+    {
+      uint8_t byte = scan_buffer[i];
+
+      if (after_ff)
+      {
+        after_ff = byte == 0xFF;
+
+        if (byte >= JPEG_RST0 && byte <= JPEG_RST7)
+        {
+          if (count >= expected)
+            return false;
+          interval_offsets[count++] = chunk_start + i + 1;
+        }
+        else if (byte == JPEG_EOI)
+        {
+          roi_index->data_end = chunk_start + i - 1;
+          roi_index->interval_count = count;
+          return true;
+        }
+        continue;
+      }
+
+      after_ff = byte == 0xFF;
+    }
+
+    chunk_start += got;
+  }
+
+  return false;
+}
+
+int roiOpen(fs::FS &fs, const char *path)
+{
+  if (index_valid && strcmp(roi_index->path, path) == 0)
+    return JDR_OK;
+
+  roiClose();
+
+  roi_index = (RoiIndex *)malloc(sizeof(RoiIndex));
+  if (!roi_index)
+    return JDR_MEM1;
+
+  fs::File file = fs.open(path);
+  if (!file)
+  {
+    roiClose();
+    return JDR_INP;
+  }
+
+  unsigned long started_at = millis();
+  bool ok = indexHeaders(file) && roi_index->restart_interval > 0;
+
+  // The header tells how many intervals there are, the offsets are sized to it
+  uint32_t expected = 0;
+  if (ok)
+  {
+    roi_index->mcus_x = (roi_index->width + roi_index->mcu_w - 1) / roi_index->mcu_w;
+    uint32_t mcus_y = (roi_index->height + roi_index->mcu_h - 1) / roi_index->mcu_h;
+    expected = ((uint32_t)roi_index->mcus_x * mcus_y + roi_index->restart_interval - 1) / roi_index->restart_interval;
+    ok = expected > 0 && expected <= ROI_MAX_INTERVALS;
+  }
+
+  if (ok)
+  {
+    interval_offsets = (uint32_t *)malloc(expected * sizeof(uint32_t));
+    ok = interval_offsets && indexIntervals(file, expected);
+  }
+  file.close();
+
+  if (!ok || roi_index->interval_count != expected)
+  {
+    roiClose();
+    return JDR_FMT1;
+  }
+
+  snprintf(roi_index->path, sizeof(roi_index->path), "%s", path);
+  index_valid = true;
+
+  LOG_INFO("Indexed %u restart intervals in %lu ms", (unsigned)roi_index->interval_count, millis() - started_at);
+  return JDR_OK;
+}
+
+// Bytes of an interval's entropy data, without its trailing restart marker
+static uint32_t intervalEnd(uint32_t interval)
+{
+  return interval + 1 < roi_index->interval_count ? interval_offsets[interval + 1] - 2 : roi_index->data_end;
+}
+
+static void startInterval(uint32_t interval)
+{
+  stream.current = interval;
+  stream.file_pos = interval_offsets[interval];
+  stream.file_end = intervalEnd(interval);
+  stream.marker_pos = 2;
+  stream.file->seek(stream.file_pos);
+}
+
+static UINT roiInput(JDEC *jdec, BYTE *buffer, UINT length)
+{
+  UINT produced = 0;
+
+  while (produced < length && !stream.done)
+  {
+    uint8_t *out = buffer ? buffer + produced : nullptr;
+    UINT wanted = length - produced;
+    UINT n;
+
+    if (stream.header_pos < roi_index->header_len)
+    {
+      n = min(wanted, (UINT)(roi_index->header_len - stream.header_pos));
+      if (out)
+        memcpy(out, roi_index->header + stream.header_pos, n);
+      stream.header_pos += n;
+    }
+    else if (stream.marker_pos < 2)
+    {
+      n = min(wanted, (UINT)(2 - stream.marker_pos));
+      if (out)
+        memcpy(out, stream.marker + stream.marker_pos, n);
+      stream.marker_pos += n;
+
+      if (stream.marker_pos == 2)
+        startInterval(stream.current + 1);
+    }
+    else if (stream.file_pos < stream.file_end)
+    {
+      n = min(wanted, (UINT)(stream.file_end - stream.file_pos));
+      if (out)
+        n = stream.file->read(out, n);
+      else
+        stream.file->seek(stream.file_pos + n);
+
+      if (n == 0)
+        return produced;
+      stream.file_pos += n;
+    }
+    else if (stream.current < stream.last)
+    {
+      // Restart markers are renumbered from RST0 for the run
+      uint32_t restart = stream.current - stream.first;
+      stream.marker[0] = 0xFF;
+      stream.marker[1] = JPEG_RST0 + (restart & 7);
+      stream.marker_pos = 0;
+      continue;
+    }
+    else
+    {
+      stream.done = true;
+      break;
+    }
+
+    produced += n;
+  }
+
+  return produced;
+}
+
+static UINT roiOutput(JDEC *jdec, void *bitmap, JRECT *rect)
+{
+  // Each rect is one MCU of the run, find where it sits in the image
+  uint32_t mcu = stream.first * roi_index->restart_interval + rect->left / roi_index->mcu_w;
+  uint16_t row = mcu / roi_index->mcus_x;
+  uint16_t col = mcu % roi_index->mcus_x;
+
+  if (row != stream.row || col < stream.col_first || col > stream.col_last)
+    return 1;
+
+  // Image space rect of the MCU, cut to the image and the viewport
+  int32_t left = max((int32_t)col * roi_index->mcu_w, stream.view_x);
+  int32_t top = max((int32_t)row * roi_index->mcu_h, stream.view_y);
+  int32_t right = min((int32_t)(col + 1) * roi_index->mcu_w, min((int32_t)roi_index->width, stream.view_x + stream.view_w));
+  int32_t bottom = min((int32_t)(row + 1) * roi_index->mcu_h, min((int32_t)roi_index->height, stream.view_y + stream.view_h));
+
+  if (right <= left || bottom <= top)
+    return 1;
+
+  uint16_t stride = rect->right - rect->left + 1;
+  const uint8_t *rgb = (const uint8_t *)bitmap + ((top - row * roi_index->mcu_h) * stride + (left - col * roi_index->mcu_w)) * 3;
+
+  int32_t x = stream.dest_x + left - stream.view_x;
+  int32_t y = stream.dest_y + top - stream.view_y;
+  uint16_t w = right - left;
+  uint16_t h = bottom - top;
+
+  uint16_t *block = ditherBlockBuffer();
+  ditherPackBlock(rgb, stride, block, x, y, w, h, output_dithered);
+
+  return output_callback(x, y, w, h, block) ? 1 : 0;
+}
+
+// Decodes the MCUs col_first..col_last of one MCU row
+static JRESULT decodeRun(fs::File &file, uint16_t row, uint16_t col_first, uint16_t col_last)
+{
+  uint32_t first_mcu = (uint32_t)row * roi_index->mcus_x + col_first;
+  uint32_t last_mcu = (uint32_t)row * roi_index->mcus_x + col_last;
+
+  stream.file = &file;
+  stream.first = first_mcu / roi_index->restart_interval;
+  stream.last = last_mcu / roi_index->restart_interval;
+  stream.row = row;
+  stream.col_first = col_first;
+  stream.col_last = col_last;
+  stream.header_pos = 0;
+  stream.done = false;
+  startInterval(stream.first);
+
+  // The run is presented as a one MCU row image just wide enough for it.
+  // The stored SOF is patched in place, the real size is kept in the index.
+  uint16_t run_width = (stream.last - stream.first + 1) * roi_index->restart_interval * roi_index->mcu_w;
+  uint8_t *sof = roi_index->header + roi_index->sof_at;
+  sof[1] = 0;
+  sof[2] = roi_index->mcu_h;
+  sof[3] = run_width >> 8;
+  sof[4] = run_width & 0xFF;
+
+  JDEC jdec;
+  JRESULT result = jd_prepare(&jdec, roiInput, ditherWorkspace(), DITHER_WORKSPACE_SIZE, &stream);
+  if (result == JDR_OK)
+  {
+    result = jd_decomp(&jdec, roiOutput, 0);
+  }
+
+  // The last interval of a run may stop short of the full run width
+  return result == JDR_INP && stream.done ? JDR_OK : result;
+}
+
+int roiDraw(fs::FS &fs, int32_t view_x, int32_t view_y, uint16_t view_w, uint16_t view_h, int32_t dest_x, int32_t dest_y)
+{
+  if (!index_valid || !output_callback)
+    return JDR_PAR;
+
+  if (view_x < 0 || view_y < 0 || view_x >= roi_index->width || view_y >= roi_index->height)
+    return JDR_PAR;
+
+  view_w = min((int32_t)view_w, (int32_t)roi_index->width - view_x);
+  view_h = min((int32_t)view_h, (int32_t)roi_index->height - view_y);
+
+  fs::File file = fs.open(roi_index->path);
+  if (!file)
+    return JDR_INP;
+
+  stream.view_x = view_x;
+  stream.view_y = view_y;
+  stream.view_w = view_w;
+  stream.view_h = view_h;
+  stream.dest_x = dest_x;
+  stream.dest_y = dest_y;
+
+  uint16_t col_first = view_x / roi_index->mcu_w;
+  uint16_t col_last = (view_x + view_w - 1) / roi_index->mcu_w;
+  uint16_t row_first = view_y / roi_index->mcu_h;
+  uint16_t row_last = (view_y + view_h - 1) / roi_index->mcu_h;
+
+  JRESULT result = JDR_OK;
+  for (uint16_t row = row_first; row <= row_last && result == JDR_OK; row++)
+  {
+    result = decodeRun(file, row, col_first, col_last);
+  }
+
+  file.close();
+  return result;
+}
@@ -0,0 +1,74 @@
+#include "scroll.h"
+#include "panel.h"
+
+#define SCROLL_VSCRDEF 0x33  // vertical scrolling definition: top fixed, scroll area, bottom fixed
+#define SCROLL_VSCRSADD 0x37 // vertical scroll start address
+
+static TFT_eSPI *scroll_tft = nullptr;
+static constexpr int16_t scroll_width = Panel::width;
+
+static void writeData16(uint16_t value)
+{
+  scroll_tft->writedata(value >> 8);
+  scroll_tft->writedata(value & 0xFF);
+}
+
+static void setStart(int16_t line)
+{
+  scroll_tft->writecommand(SCROLL_VSCRSADD);
+  writeData16(line);
+}
+
+void scrollBegin(TFT_eSPI &tft)
+{
+  scroll_tft = &tft;
+
+  // No fixed areas, every line scrolls
+  tft.writecommand(SCROLL_VSCRDEF);
+  writeData16(0);
+  writeData16(scroll_width);
+  writeData16(0);
+  setStart(0);
+}
+
+// Columns scrolled in after elapsed_ms, fast at first and settling at the end
+static int16_t slidePosition(uint32_t elapsed_ms, uint32_t duration_ms)
+{
+  if (elapsed_ms >= duration_ms)
+    return scroll_width;
+
+  float left = 1.0f - (float)elapsed_ms / duration_ms;
+  return (int16_t)((1.0f - left * left * left) * scroll_width);
+}
+
+void scrollSlide(int direction, uint32_t duration_ms, ScrollColumnsCallback push, ScrollStats *stats)
+{
+  stats->steps = 0;
+  unsigned long started_at = millis();
+
+  int16_t done = 0;
+  while (done < scroll_width)
+  {
+    int16_t next = slidePosition(millis() - started_at, duration_ms);
+    if (next <= done)
+      continue;
+
+    if (direction == SCROLL_LEFT)
+    {
+      // The lines of columns done .. next just left on the left, they show on the right now
+      setStart(next % scroll_width);
+      push(done, next - done);
+    }
+    else
+    {
+      // And the other way round
+      setStart((scroll_width - next) % scroll_width);
+      push(scroll_width - next, next - done);
+    }
+
+    done = next;
+    stats->steps++;
+  }
+
+  stats->elapsed_ms = millis() - started_at;
+}
@@ -0,0 +1,64 @@
+#include "spans.h"
+
+#ifdef SPAN_TRACE
+
+#include <Arduino.h>
+#include <atomic>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include "log.h"
+
+static_assert((SPAN_RING & (SPAN_RING - 1)) == 0, "SPAN_RING must be a power of two");
+
+struct Span
+{
+  const char *name;
+  uint32_t start;  // cycle count on entry
+  uint32_t cycles; // cycles until the scope ended
+  uint32_t end;    // tick count at the end, core in the top bit
+};
+
+static Span ring[SPAN_RING];
+static std::atomic<uint32_t> recorded(0);
+static std::atomic<bool> dumping(false);
+
+void spanRecord(const char *name, uint32_t start, uint32_t end)
+{
+  if (dumping.load(std::memory_order_relaxed))
+    return;
+
+  // Slots are claimed, so both cores can record at once
+  Span &span = ring[recorded.fetch_add(1, std::memory_order_relaxed) & (SPAN_RING - 1)];
+  span.name = name;
+  span.start = start;
+  span.cycles = end - start;
+  span.end = (xTaskGetTickCount() & 0x7FFFFFFF) | ((uint32_t)xPortGetCoreID() << 31);
+}
+
+void spanDump()
+{
+  dumping.store(true, std::memory_order_relaxed);
+  logPause(true);
+  Serial.flush();
+
+  uint32_t total = recorded.load(std::memory_order_relaxed);
+  uint32_t first = total > SPAN_RING ? total - SPAN_RING : 0;
+
+  Serial.printf("\nSPANS BEGIN %x %x %x %x\n", (unsigned)getCpuFrequencyMhz(), (unsigned)configTICK_RATE_HZ,
+                (unsigned)(total - first), (unsigned)total);
+  for (uint32_t i = first; i != total; i++)
+  {
+    const Span &span = ring[i & (SPAN_RING - 1)];
+    Serial.printf("%x %x %x %x %s\n", (unsigned)(span.end >> 31), (unsigned)(span.end & 0x7FFFFFFF),
+                  (unsigned)span.start, (unsigned)span.cycles, span.name);
+  }
+  Serial.printf("SPANS END\n");
+  Serial.flush();
+
+  // The next dump starts from an empty ring
+  recorded.store(0, std::memory_order_relaxed);
+  logPause(false);
+  dumping.store(false, std::memory_order_relaxed);
+}
+
+#endif
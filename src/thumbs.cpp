@@ -0,0 +1,134 @@
+#include "thumbs.h"
+#include "log.h"
+
+#define THUMBS_MAGIC "THB1"
+#define THUMBS_HEADER_SIZE 12
+
+struct ThumbEntry
+{
+  uint32_t offset;
+  uint32_t length;
+  char name[THUMB_NAME_MAX];
+};
+
+static uint16_t thumb_count = 0;
+static ThumbEntry page_entries[THUMBS_PER_PAGE];
+static int page_loaded = 0;
+
+// Allocated on first use and kept, the gallery does not churn the heap
+static uint8_t *page_buffer = nullptr;
+
+static uint16_t readU16(const uint8_t *p)
+{
+  return p[0] | (p[1] << 8);
+}
+
+static uint32_t readU32(const uint8_t *p)
+{
+  return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+bool thumbsOpen(fs::FS &fs)
+{
+  thumb_count = 0;
+
+  File file = fs.open(THUMBS_PATH);
+  if (!file)
+    return false;
+
+  uint8_t header[THUMBS_HEADER_SIZE];
+  bool ok = file.read(header, sizeof(header)) == sizeof(header) &&
+            memcmp(header, THUMBS_MAGIC, 4) == 0 &&
+            readU16(header + 6) == THUMB_WIDTH &&
+            readU16(header + 8) == THUMB_HEIGHT;
+  file.close();
+
+  if (!ok)
+  {
+    LOG_ERROR("Thumbnail file is not valid, rerun scripts/thumbnails.sh");
+    return false;
+  }
+
+  thumb_count = readU16(header + 4);
+  return true;
+}
+
+int thumbsCount()
+{
+  return thumb_count;
+}
+
+int thumbsPageCount()
+{
+  return (thumb_count + THUMBS_PER_PAGE - 1) / THUMBS_PER_PAGE;
+}
+
+int thumbsLoadPage(fs::FS &fs, int page)
+{
+  int first = page * THUMBS_PER_PAGE;
+  int count = min(THUMBS_PER_PAGE, thumb_count - first);
+  if (first < 0 || count <= 0)
+    return -1;
+
+  if (!page_buffer)
+  {
+    page_buffer = (uint8_t *)malloc(THUMBS_PER_PAGE * THUMB_MAX_BYTES);
+    if (!page_buffer)
+    {
+      LOG_ERROR("Thumbnail page buffer could not be allocated");
+      return -1;
+    }
+  }
+
+  File file = fs.open(THUMBS_PATH);
+  if (!file)
+    return -1;
+
+  // Entry table of the page
+  uint8_t raw[THUMBS_PER_PAGE * sizeof(ThumbEntry)];
+  size_t entries_size = count * sizeof(ThumbEntry);
+  if (!file.seek(THUMBS_HEADER_SIZE + first * sizeof(ThumbEntry)) || file.read(raw, entries_size) != entries_size)
+  {
+    file.close();
+    return -1;
+  }
+
+  for (int i = 0; i < count; i++)
+  {
+    const uint8_t *entry = raw + i * sizeof(ThumbEntry);
+    page_entries[i].offset = readU32(entry);
+    page_entries[i].length = readU32(entry + 4);
+    memcpy(page_entries[i].name, entry + 8, THUMB_NAME_MAX);
+    page_entries[i].name[THUMB_NAME_MAX - 1] = '\0';
+  }
+
+  // All thumbnails of the page in one sequential read
+  uint32_t start = page_entries[0].offset;
+  uint32_t end = page_entries[count - 1].offset + page_entries[count - 1].length;
+  bool ok = end > start && end - start <= THUMBS_PER_PAGE * THUMB_MAX_BYTES &&
+            file.seek(start) && file.read(page_buffer, end - start) == end - start;
+  file.close();
+
+  if (!ok)
+    return -1;
+
+  page_loaded = count;
+  return count;
+}
+
+const uint8_t *thumbsData(int slot, uint32_t *size)
+{
+  if (slot < 0 || slot >= page_loaded)
+    return nullptr;
+
+  *size = page_entries[slot].length;
+  return page_buffer + (page_entries[slot].offset - page_entries[0].offset);
+}
+
+const char *thumbsName(int slot)
+{
+  if (slot < 0 || slot >= page_loaded)
+    return "";
+
+  return page_entries[slot].name;
+}
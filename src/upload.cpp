@@ -0,0 +1,544 @@
+#include "upload.h"
+
+#include <string.h>
+
+#define SYNC_0 0xA5
+#define SYNC_1 0x5A
+#define HEADER_SIZE 5 // sync, type, length
+#define CRC_SIZE 4
+
+#define META_MAGIC "UPL1"
+#define MATCH_MIN 3
+#define MATCH_MAX (0x7F + MATCH_MIN)
+#define LITERAL_MAX 0x80
+#define HASH_BITS 12
+
+static uint32_t crc_table[256];
+static bool crc_table_ready = false;
+
+uint32_t uploadCrc32(uint32_t crc, const uint8_t *data, size_t length)
+{
+  if (!crc_table_ready)
+  {
+    for (uint32_t i = 0; i < 256; i++)
+    {
+      uint32_t c = i;
+      for (int bit = 0; bit < 8; bit++)
+        c = (c & 1) ? 0xEDB88320 ^ (c >> 1) : c >> 1;
+      crc_table[i] = c;
+    }
+    crc_table_ready = true;
+  }
+
+  crc = ~crc;
+  while (length--)
+    crc = crc_table[(crc ^ *data++) & 0xFF] ^ (crc >> 8);
+  return ~crc;
+}
+
+size_t uploadEncodeFrame(uint8_t type, const uint8_t *payload, size_t length, uint8_t *out)
+{
+  out[0] = SYNC_0;
+  out[1] = SYNC_1;
+  out[2] = type;
+  uploadPut16(out + 3, length);
+  if (length)
+    memcpy(out + HEADER_SIZE, payload, length);
+
+  uploadPut32(out + HEADER_SIZE + length, uploadCrc32(0, out + 2, HEADER_SIZE - 2 + length));
+  return HEADER_SIZE + length + CRC_SIZE;
+}
+
+void uploadParserReset(UploadParser &parser)
+{
+  parser.length = 0;
+  parser.payload = nullptr;
+}
+
+bool uploadParse(UploadParser &parser, uint8_t byte)
+{
+  if (parser.length == 0)
+  {
+    if (byte == SYNC_0)
+      parser.frame[parser.length++] = byte;
+    return false;
+  }
+
+  if (parser.length == 1)
+  {
+    if (byte == SYNC_1)
+      parser.frame[parser.length++] = byte;
+    else if (byte != SYNC_0)
+      parser.length = 0;
+    return false;
+  }
+
+  parser.frame[parser.length++] = byte;
+
+  if (parser.length == HEADER_SIZE)
+  {
+    parser.payload_length = uploadGet16(parser.frame + 3);
+    if (HEADER_SIZE + parser.payload_length + CRC_SIZE > UPLOAD_MAX_FRAME)
+      parser.length = 0; // cannot be a frame, look for the next sync
+    return false;
+  }
+
+  if (parser.length < HEADER_SIZE || parser.length < (size_t)HEADER_SIZE + parser.payload_length + CRC_SIZE)
+    return false;
+
+  parser.length = 0;
+  uint32_t crc = uploadGet32(parser.frame + HEADER_SIZE + parser.payload_length);
+  if (crc != uploadCrc32(0, parser.frame + 2, HEADER_SIZE - 2 + parser.payload_length))
+  {
+    parser.crc_errors++;
+    return false;
+  }
+
+  parser.type = parser.frame[2];
+  parser.payload = parser.frame + HEADER_SIZE;
+  return true;
+}
+
+// ====== COMPRESSION ======
+// Tokens: a byte below 0x80 is followed by that many plus one literal
+// bytes, a byte from 0x80 up copies (byte & 0x7F) + 3 bytes from the u16
+// distance that follows.
+
+static inline uint32_t hash3(const uint8_t *p)
+{
+  return ((p[0] << 16 | p[1] << 8 | p[2]) * 2654435761u) >> (32 - HASH_BITS);
+}
+
+size_t uploadCompress(const uint8_t *data, size_t length, uint8_t *out, size_t out_length)
+{
+  static int32_t last_seen[1 << HASH_BITS];
+  for (size_t i = 0; i < (1 << HASH_BITS); i++)
+    last_seen[i] = -1;
+
+  size_t pos = 0, written = 0, literal_start = 0;
+
+  auto flushLiterals = [&](size_t end) -> bool
+  {
+    while (literal_start < end)
+    {
+      size_t run = end - literal_start < LITERAL_MAX ? end - literal_start : LITERAL_MAX;
+      if (written + 1 + run > out_length)
+        return false;
+      out[written++] = run - 1;
+      memcpy(out + written, data + literal_start, run);
+      written += run;
+      literal_start += run;
+    }
+    return true;
+  };
+
+  while (pos + MATCH_MIN <= length)
+  {
+    uint32_t h = hash3(data + pos);
+    int32_t candidate = last_seen[h];
+    last_seen[h] = pos;
+
+    size_t match = 0;
+    if (candidate >= 0 && pos - candidate <= 0xFFFF)
+    {
+      while (pos + match < length && match < MATCH_MAX && data[candidate + match] == data[pos + match])
+        match++;
+    }
+
+    if (match < MATCH_MIN)
+    {
+      pos++;
+      continue;
+    }
+
+    if (!flushLiterals(pos) || written + 3 > out_length)
+      return 0;
+
+    out[written++] = 0x80 | (match - MATCH_MIN);
+    uploadPut16(out + written, pos - candidate);
+    written += 2;
+    pos += match;
+    literal_start = pos;
+  }
+
+  if (!flushLiterals(length) || written >= length)
+    return 0;
+  return written;
+}
+
+size_t uploadDecompress(const uint8_t *data, size_t length, uint8_t *out, size_t out_length)
+{
+  size_t pos = 0, written = 0;
+
+  while (pos < length)
+  {
+    uint8_t token = data[pos++];
+    if (token < 0x80)
+    {
+      size_t run = token + 1;
+      if (pos + run > length || written + run > out_length)
+        return 0;
+      memcpy(out + written, data + pos, run);
+      pos += run;
+      written += run;
+    }
+    else
+    {
+      size_t match = (token & 0x7F) + MATCH_MIN;
+      if (pos + 2 > length)
+        return 0;
+      size_t distance = uploadGet16(data + pos);
+      pos += 2;
+      if (distance == 0 || distance > written || written + match > out_length)
+        return 0;
+
+      // Byte by byte, the copy may overlap its own output
+      for (size_t i = 0; i < match; i++, written++)
+        out[written] = out[written - distance];
+    }
+  }
+
+  return written;
+}
+
+// ====== RECEIVER ======
+
+static UploadParser parser;
+static uint8_t frame_out[UPLOAD_MAX_FRAME];
+static uint8_t chunk[UPLOAD_CHUNK];
+
+// Current file
+static void *part_file = nullptr;
+static char file_name[UPLOAD_NAME_MAX];
+static uint32_t file_size = 0;
+static uint32_t file_crc = 0;
+static uint32_t received = 0;      // bytes on the card, the next expected offset
+static uint32_t received_crc = 0;  // CRC of those bytes
+static uint32_t nak_offset = 0;    // expected offset a NAK was last sent for
+static bool nak_sent = false;
+
+static void send(const UploadIo &io, uint8_t type, const uint8_t *payload, size_t length)
+{
+  io.write(io.context, frame_out, uploadEncodeFrame(type, payload, length, frame_out));
+}
+
+static void sendOffset(const UploadIo &io, uint8_t type, uint32_t offset)
+{
+  uint8_t payload[4];
+  uploadPut32(payload, offset);
+  send(io, type, payload, sizeof(payload));
+}
+
+static void sendStatus(const UploadIo &io, uint8_t type, uint8_t status)
+{
+  send(io, type, &status, 1);
+}
+
+static void closePart(const UploadIo &io)
+{
+  if (part_file)
+  {
+    io.close(io.context, part_file);
+    part_file = nullptr;
+  }
+}
+
+static bool validName(const char *name, size_t length)
+{
+  if (length == 0 || length >= UPLOAD_NAME_MAX || name[0] == '.')
+    return false;
+
+  for (size_t i = 0; i < length; i++)
+  {
+    if (name[i] == '/' || name[i] == '\\' || (uint8_t)name[i] < ' ')
+      return false;
+  }
+  return true;
+}
+
+// Offset an interrupted upload of this file can resume from, 0 if none
+static uint32_t resumeOffset(const UploadIo &io)
+{
+  uint8_t meta[12 + UPLOAD_NAME_MAX];
+  void *file = io.open(io.context, UPLOAD_META_PATH, "r");
+  if (!file)
+    return 0;
+
+  size_t length = io.file_read(io.context, file, meta, sizeof(meta));
+  io.close(io.context, file);
+
+  if (length != sizeof(meta) || memcmp(meta, META_MAGIC, 4) != 0 || uploadGet32(meta + 4) != file_size ||
+      uploadGet32(meta + 8) != file_crc || strncmp((const char *)meta + 12, file_name, UPLOAD_NAME_MAX) != 0)
+    return 0;
+
+  long part_size = io.size(io.context, UPLOAD_PART_PATH);
+  if (part_size <= 0 || part_size > (long)file_size)
+    return 0;
+
+  // The CRC of the whole file is checked at the end, catch up on what is there
+  file = io.open(io.context, UPLOAD_PART_PATH, "r");
+  if (!file)
+    return 0;
+
+  uint32_t offset = 0;
+  received_crc = 0;
+  while (offset < (uint32_t)part_size)
+  {
+    size_t n = io.file_read(io.context, file, chunk, sizeof(chunk));
+    if (n == 0)
+      break;
+    received_crc = uploadCrc32(received_crc, chunk, n);
+    offset += n;
+  }
+  io.close(io.context, file);
+
+  return offset == (uint32_t)part_size ? offset : 0;
+}
+
+static void handleOpen(const UploadIo &io, const uint8_t *payload, size_t length)
+{
+  closePart(io);
+
+  if (length < 9 || !validName((const char *)payload + 8, length - 8))
+  {
+    sendStatus(io, UPLOAD_ERROR, UPLOAD_STATUS_NAME);
+    return;
+  }
+
+  file_size = uploadGet32(payload);
+  file_crc = uploadGet32(payload + 4);
+  memset(file_name, 0, sizeof(file_name));
+  memcpy(file_name, payload + 8, length - 8);
+
+  received = resumeOffset(io);
+  if (received == 0)
+  {
+    received_crc = 0;
+    io.remove(io.context, UPLOAD_PART_PATH);
+
+    uint8_t meta[12 + UPLOAD_NAME_MAX];
+    memcpy(meta, META_MAGIC, 4);
+    uploadPut32(meta + 4, file_size);
+    uploadPut32(meta + 8, file_crc);
+    memcpy(meta + 12, file_name, UPLOAD_NAME_MAX);
+
+    void *file = io.open(io.context, UPLOAD_META_PATH, "w");
+    bool written = file && io.file_write(io.context, file, meta, sizeof(meta)) == sizeof(meta);
+    if (file)
+      io.close(io.context, file);
+
+    part_file = written ? io.open(io.context, UPLOAD_PART_PATH, "w") : nullptr;
+  }
+  else
+  {
+    part_file = io.open(io.context, UPLOAD_PART_PATH, "a");
+  }
+
+  if (!part_file)
+  {
+    sendStatus(io, UPLOAD_ERROR, UPLOAD_STATUS_STORAGE);
+    return;
+  }
+
+  nak_sent = false;
+  sendOffset(io, UPLOAD_OPEN_ACK, received);
+
+  if (io.event)
+    io.event(io.context, UPLOAD_EVENT_PROGRESS, file_name, received, file_size);
+}
+
+static void handleData(const UploadIo &io, const uint8_t *payload, size_t length, UploadStats *stats)
+{
+  if (!part_file || length < 5)
+  {
+    sendStatus(io, UPLOAD_ERROR, UPLOAD_STATUS_STATE);
+    return;
+  }
+
+  uint32_t offset = uploadGet32(payload);
+  if (offset < received)
+  {
+    // Already written, the ACK must have been lost
+    sendOffset(io, UPLOAD_ACK, received);
+    return;
+  }
+
+  if (offset > received)
+  {
+    // A frame went missing, one NAK per gap, the frames behind it are dropped
+    if (!nak_sent || nak_offset != received)
+    {
+      sendOffset(io, UPLOAD_NAK, received);
+      nak_offset = received;
+      nak_sent = true;
+    }
+    return;
+  }
+
+  const uint8_t *data = payload + 5;
+  size_t data_length = length - 5;
+  if (payload[4] & UPLOAD_DATA_COMPRESSED)
+  {
+    data_length = uploadDecompress(data, data_length, chunk, sizeof(chunk));
+    data = chunk;
+  }
+
+  if (data_length == 0 || data_length > UPLOAD_CHUNK || received + data_length > file_size)
+  {
+    sendOffset(io, UPLOAD_NAK, received);
+    return;
+  }
+
+  if (io.file_write(io.context, part_file, data, data_length) != data_length)
+  {
+    closePart(io);
+    sendStatus(io, UPLOAD_ERROR, UPLOAD_STATUS_STORAGE);
+    return;
+  }
+
+  received += data_length;
+  received_crc = uploadCrc32(received_crc, data, data_length);
+  stats->bytes += data_length;
+  nak_sent = false;
+  sendOffset(io, UPLOAD_ACK, received);
+
+  if (io.event)
+    io.event(io.context, UPLOAD_EVENT_PROGRESS, file_name, received, file_size);
+}
+
+static void handleClose(const UploadIo &io, UploadStats *stats)
+{
+  if (!part_file || received != file_size)
+  {
+    sendStatus(io, UPLOAD_CLOSE_ACK, UPLOAD_STATUS_STATE);
+    return;
+  }
+  closePart(io);
+
+  if (received_crc != file_crc)
+  {
+    // Something on the card does not match, start this file over
+    io.remove(io.context, UPLOAD_PART_PATH);
+    io.remove(io.context, UPLOAD_META_PATH);
+    sendStatus(io, UPLOAD_CLOSE_ACK, UPLOAD_STATUS_CRC);
+    return;
+  }
+
+  char path[UPLOAD_NAME_MAX + 1];
+  path[0] = '/';
+  memcpy(path + 1, file_name, UPLOAD_NAME_MAX);
+
+  io.remove(io.context, path);
+  if (!io.rename(io.context, UPLOAD_PART_PATH, path))
+  {
+    sendStatus(io, UPLOAD_CLOSE_ACK, UPLOAD_STATUS_STORAGE);
+    return;
+  }
+  io.remove(io.context, UPLOAD_META_PATH);
+
+  stats->files++;
+  sendStatus(io, UPLOAD_CLOSE_ACK, UPLOAD_STATUS_OK);
+}
+
+static void runSession(const UploadIo &io, uint32_t requested_baud, UploadStats *stats)
+{
+  uint32_t baud = requested_baud;
+  if (baud > UPLOAD_MAX_BAUD)
+    baud = UPLOAD_MAX_BAUD;
+  if (baud < UPLOAD_DEFAULT_BAUD)
+    baud = UPLOAD_DEFAULT_BAUD;
+
+  memset(stats, 0, sizeof(*stats));
+  stats->baud = baud;
+  uint32_t started_at = io.millis(io.context);
+
+  // Whatever else writes to the port stops before the sender hears back
+  if (io.event)
+    io.event(io.context, UPLOAD_EVENT_START, nullptr, 0, 0);
+
+  // Accepted baud, largest chunk and window, the sender keeps within both
+  uint8_t ack[7];
+  uploadPut32(ack, baud);
+  uploadPut16(ack + 4, UPLOAD_CHUNK);
+  ack[6] = UPLOAD_WINDOW;
+  send(io, UPLOAD_HELLO_ACK, ack, sizeof(ack));
+
+  io.set_baud(io.context, baud);
+  uploadParserReset(parser);
+
+  uint32_t last_frame_at = io.millis(io.context);
+  bool done = false;
+  uint8_t buffer[256];
+
+  while (!done && io.millis(io.context) - last_frame_at < UPLOAD_IDLE_TIMEOUT)
+  {
+    size_t length = io.read(io.context, buffer, sizeof(buffer));
+    stats->wire_bytes += length;
+
+    for (size_t i = 0; i < length && !done; i++)
+    {
+      if (!uploadParse(parser, buffer[i]))
+        continue;
+
+      last_frame_at = io.millis(io.context);
+      switch (parser.type)
+      {
+      case UPLOAD_PING:
+        send(io, UPLOAD_PONG, nullptr, 0);
+        break;
+      case UPLOAD_OPEN:
+        handleOpen(io, parser.payload, parser.payload_length);
+        break;
+      case UPLOAD_DATA:
+        handleData(io, parser.payload, parser.payload_length, stats);
+        break;
+      case UPLOAD_CLOSE:
+        handleClose(io, stats);
+        break;
+      case UPLOAD_BYE:
+        send(io, UPLOAD_BYE_ACK, nullptr, 0);
+        done = true;
+        break;
+      default:
+        break;
+      }
+    }
+  }
+
+  // An unfinished file stays on the card to be resumed
+  closePart(io);
+  io.set_baud(io.context, UPLOAD_DEFAULT_BAUD);
+  stats->elapsed_ms = io.millis(io.context) - started_at;
+
+  if (io.event)
+    io.event(io.context, UPLOAD_EVENT_END, nullptr, 0, 0);
+}
+
+bool uploadPoll(const UploadIo &io, UploadStats *stats)
+{
+  uint8_t buffer[64];
+  size_t length;
+
+  while ((length = io.read(io.context, buffer, sizeof(buffer))) > 0)
+  {
+    for (size_t i = 0; i < length; i++)
+    {
+      if (!uploadParse(parser, buffer[i]))
+        continue;
+
+      if (parser.type == UPLOAD_HELLO && parser.payload_length >= UPLOAD_HELLO_LENGTH)
+      {
+        if (io.set_clock && parser.payload_length >= UPLOAD_HELLO_CLOCK_LENGTH)
+          io.set_clock(io.context, uploadGet32(parser.payload + 4), (int32_t)uploadGet32(parser.payload + 8));
+
+        runSession(io, uploadGet32(parser.payload), stats);
+        return true;
+      }
+
+      if (io.frame)
+        io.frame(io.context, parser.type, parser.payload, parser.payload_length);
+    }
+  }
+
+  return false;
+}
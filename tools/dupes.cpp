@@ -0,0 +1,412 @@
+// Host near-duplicate finder for the preparation pipeline.
+//
+//   dupes hash <file.jpg>...
+//     Decodes each photo with the fast decoder (src/fastjpeg.cpp) and prints
+//     "<hash> <path>" lines with a 64-bit dHash: luma averaged over a 9x8
+//     grid, one bit per horizontal neighbour pair telling whether brightness
+//     rises. Burst shots and re-exports of the same photo land within a few
+//     bits of each other.
+//
+//   dupes cluster <distance> <spread|drop> [gap]
+//     Reads the hash lines on stdin, in display order, and groups photos
+//     whose hashes differ in at most <distance> bits. The report goes to
+//     stderr, the plan to stdout:
+//       spread  every photo in a new display order that keeps photos of one
+//               cluster at least [gap] slides apart where possible
+//       drop    the photos to remove, keeping the largest file of each cluster
+//
+// The search splits the hash into distance + 1 chunks. Two hashes within
+// the distance must agree exactly on at least one chunk, so only photos
+// sharing a chunk value are compared, which keeps 100k photos at the
+// default distance to about a second. Built and run by scripts/dupes.sh.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "fastjpeg.h"
+
+#define GRID_COLS 9
+#define GRID_ROWS 8
+#define MAX_DISTANCE 10 // beyond this the chunks get too short to narrow the search
+#define SPREAD_LOOKAHEAD 256
+
+// Grid cell boundaries of the photo being hashed, and the luma sums per cell
+static int col_start[GRID_COLS + 1];
+static int row_cell[8192];
+static uint64_t cell_sum[GRID_ROWS][GRID_COLS];
+
+static double nowMs()
+{
+  using namespace std::chrono;
+  return duration<double, std::milli>(steady_clock::now().time_since_epoch()).count();
+}
+
+static bool readFile(const char *path, std::vector<uint8_t> &data)
+{
+  FILE *file = fopen(path, "rb");
+  if (!file)
+    return false;
+
+  fseek(file, 0, SEEK_END);
+  data.resize(ftell(file));
+  fseek(file, 0, SEEK_SET);
+  bool ok = fread(data.data(), 1, data.size(), file) == data.size();
+  fclose(file);
+  return ok;
+}
+
+// Image size from the SOF marker, so the grid can be set up first
+static bool jpegSize(const std::vector<uint8_t> &data, int *width, int *height)
+{
+  for (size_t i = 2; i + 9 < data.size();)
+  {
+    if (data[i] != 0xFF)
+      return false;
+
+    uint8_t code = data[i + 1];
+    size_t length = (data[i + 2] << 8) | data[i + 3];
+    if (code >= 0xC0 && code <= 0xCF && code != 0xC4 && code != 0xC8 && code != 0xCC)
+    {
+      *height = (data[i + 5] << 8) | data[i + 6];
+      *width = (data[i + 7] << 8) | data[i + 8];
+      return true;
+    }
+    i += 2 + length;
+  }
+  return false;
+}
+
+// Adds a decoded strip to the grid. Each strip row is converted to luma in
+// a branch-free loop and summed over the contiguous column range of each
+// cell, both of which the compiler vectorises.
+static bool gridOutput(int16_t x, int16_t y, uint16_t w, uint16_t h, uint16_t *pixels)
+{
+  static uint16_t luma[FASTJPEG_STRIP_WIDTH];
+
+  for (int row = 0; row < h; row++)
+  {
+    const uint16_t *src = pixels + row * w;
+    for (int i = 0; i < w; i++)
+    {
+      uint16_t pixel = (uint16_t)((src[i] >> 8) | (src[i] << 8));
+      uint16_t r = (pixel >> 11) << 3;
+      uint16_t g = ((pixel >> 5) & 0x3F) << 2;
+      uint16_t b = (pixel & 0x1F) << 3;
+      luma[i] = (uint16_t)((r * 77 + g * 150 + b * 29) >> 8);
+    }
+
+    uint64_t *cells = cell_sum[row_cell[y + row]];
+    for (int cx = 0; cx < GRID_COLS; cx++)
+    {
+      int lo = std::max<int>(x, col_start[cx]) - x;
+      int hi = std::min<int>(x + w, col_start[cx + 1]) - x;
+
+      uint32_t sum = 0;
+      for (int i = lo; i < hi; i++)
+        sum += luma[i];
+      cells[cx] += sum;
+    }
+  }
+  return true;
+}
+
+static bool hashFile(const char *path, uint64_t *hash)
+{
+  std::vector<uint8_t> data;
+  int width, height;
+  if (!readFile(path, data) || !jpegSize(data, &width, &height) ||
+      width < GRID_COLS || height < GRID_ROWS || height > (int)(sizeof(row_cell) / sizeof(row_cell[0])))
+    return false;
+
+  for (int cx = 0; cx <= GRID_COLS; cx++)
+    col_start[cx] = cx * width / GRID_COLS;
+  for (int row = 0; row < height; row++)
+    row_cell[row] = row * GRID_ROWS / height;
+  memset(cell_sum, 0, sizeof(cell_sum));
+
+  if (fastJpegDrawMem(0, 0, data.data(), data.size()) != FASTJPEG_OK)
+    return false;
+
+  // Cells differ in size by a pixel at most, compare means rather than sums
+  *hash = 0;
+  for (int cy = 0; cy < GRID_ROWS; cy++)
+  {
+    int rows = 0;
+    for (int row = 0; row < height; row++)
+      rows += row_cell[row] == cy;
+
+    for (int cx = 0; cx < GRID_COLS - 1; cx++)
+    {
+      double left = (double)cell_sum[cy][cx] / ((col_start[cx + 1] - col_start[cx]) * rows);
+      double right = (double)cell_sum[cy][cx + 1] / ((col_start[cx + 2] - col_start[cx + 1]) * rows);
+      *hash = (*hash << 1) | (left < right);
+    }
+  }
+  return true;
+}
+
+static int hashFiles(int count, char **paths)
+{
+  fastJpegInit(gridOutput);
+
+  // Several processes share one output file, whole lines keep their
+  // writes from interleaving mid-line
+  setvbuf(stdout, nullptr, _IOLBF, 0);
+
+  int failed = 0;
+  for (int i = 0; i < count; i++)
+  {
+    uint64_t hash;
+    if (!hashFile(paths[i], &hash))
+    {
+      fprintf(stderr, "%s: not a decodable JPEG, skipped\n", paths[i]);
+      failed++;
+      continue;
+    }
+    printf("%016llx %s\n", (unsigned long long)hash, paths[i]);
+  }
+
+  return failed ? 1 : 0;
+}
+
+// ====== CLUSTERING ======
+
+struct Photo
+{
+  uint64_t hash;
+  std::string path;
+};
+
+static std::vector<uint32_t> parent;
+
+static uint32_t findRoot(uint32_t i)
+{
+  while (parent[i] != i)
+  {
+    parent[i] = parent[parent[i]];
+    i = parent[i];
+  }
+  return i;
+}
+
+static void join(uint32_t a, uint32_t b)
+{
+  a = findRoot(a);
+  b = findRoot(b);
+  if (a != b)
+    parent[std::max(a, b)] = std::min(a, b); // the root stays the earliest photo
+}
+
+static const char *baseName(const std::string &path)
+{
+  size_t slash = path.rfind('/');
+  return path.c_str() + (slash == std::string::npos ? 0 : slash + 1);
+}
+
+// Joins every pair of photos within distance bits, returns the number of
+// pairs compared
+static uint64_t findNearPairs(const std::vector<Photo> &photos, int distance)
+{
+  int chunks = distance + 1;
+  uint64_t compared = 0;
+
+  std::vector<uint64_t> masks(chunks);
+  for (int c = 0; c < chunks; c++)
+  {
+    int lo = c * 64 / chunks, hi = (c + 1) * 64 / chunks;
+    masks[c] = (hi - lo == 64 ? ~0ull : ((1ull << (hi - lo)) - 1) << lo);
+  }
+
+  std::vector<std::pair<uint64_t, uint32_t>> keys(photos.size());
+  for (int c = 0; c < chunks; c++)
+  {
+    for (uint32_t i = 0; i < photos.size(); i++)
+      keys[i] = {photos[i].hash & masks[c], i};
+    std::sort(keys.begin(), keys.end());
+
+    for (size_t start = 0; start < keys.size();)
+    {
+      size_t end = start + 1;
+      while (end < keys.size() && keys[end].first == keys[start].first)
+        end++;
+
+      compared += (end - start) * (end - start - 1) / 2;
+      for (size_t a = start; a < end; a++)
+      {
+        for (size_t b = a + 1; b < end; b++)
+        {
+          // Pairs agreeing on several chunks are compared more than once,
+          // joining them again is harmless
+          uint64_t diff = photos[keys[a].second].hash ^ photos[keys[b].second].hash;
+          if (__builtin_popcountll(diff) <= distance)
+            join(keys[a].second, keys[b].second);
+        }
+      }
+      start = end;
+    }
+  }
+
+  return compared;
+}
+
+// Greedy reorder: each slide takes the earliest remaining photo whose
+// cluster was last shown at least gap slides ago, looking a bounded number
+// of photos ahead, or the photo whose cluster waited longest otherwise
+static std::vector<uint32_t> spreadOrder(const std::vector<Photo> &photos, const std::vector<uint32_t> &cluster, int gap)
+{
+  size_t count = photos.size();
+  std::vector<uint32_t> next(count + 1);
+  for (size_t i = 0; i <= count; i++)
+    next[i] = i + 1; // next[count] is the head of the list of remaining photos
+  uint32_t head_slot = count;
+  next[head_slot] = 0;
+
+  std::vector<long> shown_at(count, -(long)count - gap);
+  std::vector<uint32_t> order;
+  order.reserve(count);
+
+  for (size_t slot = 0; slot < count; slot++)
+  {
+    uint32_t prev = head_slot, best_prev = head_slot;
+    long best_wait = -1;
+
+    for (int seen = 0; next[prev] < count && seen < SPREAD_LOOKAHEAD; seen++, prev = next[prev])
+    {
+      uint32_t candidate = next[prev];
+      long wait = (long)slot - shown_at[cluster[candidate]];
+      if (wait >= gap)
+      {
+        best_prev = prev;
+        break;
+      }
+      if (wait > best_wait)
+      {
+        best_wait = wait;
+        best_prev = prev;
+      }
+    }
+
+    uint32_t chosen = next[best_prev];
+    next[best_prev] = next[chosen];
+    shown_at[cluster[chosen]] = slot;
+    order.push_back(chosen);
+  }
+
+  return order;
+}
+
+static int clusterHashes(int distance, bool drop, int gap)
+{
+  std::vector<Photo> photos;
+  char line[4096];
+  while (fgets(line, sizeof(line), stdin))
+  {
+    line[strcspn(line, "\r\n")] = '\0';
+    char *space = strchr(line, ' ');
+    if (!space)
+      continue;
+
+    *space = '\0';
+    photos.push_back({strtoull(line, nullptr, 16), space + 1});
+  }
+
+  parent.resize(photos.size());
+  for (uint32_t i = 0; i < photos.size(); i++)
+    parent[i] = i;
+
+  double started_at = nowMs();
+  uint64_t compared = findNearPairs(photos, distance);
+  double search_ms = nowMs() - started_at;
+
+  std::vector<uint32_t> cluster(photos.size());
+  std::vector<std::vector<uint32_t>> members(photos.size());
+  for (uint32_t i = 0; i < photos.size(); i++)
+  {
+    cluster[i] = findRoot(i);
+    members[cluster[i]].push_back(i);
+  }
+
+  int clusters = 0, duplicates = 0;
+  for (uint32_t root = 0; root < photos.size(); root++)
+  {
+    if (members[root].size() < 2)
+      continue;
+
+    clusters++;
+    duplicates += members[root].size() - 1;
+    fprintf(stderr, "Cluster %d (%zu photos):", clusters, members[root].size());
+    for (uint32_t i : members[root])
+      fprintf(stderr, " %s", baseName(photos[i].path));
+    fprintf(stderr, "\n");
+  }
+
+  fprintf(stderr, "Searched %zu hashes in %.1f ms (%llu pairs compared, distance %d)\n", photos.size(), search_ms,
+          (unsigned long long)compared, distance);
+  fprintf(stderr, "Found %d clusters, %d near-duplicates\n", clusters, duplicates);
+
+  if (drop)
+  {
+    for (uint32_t root = 0; root < photos.size(); root++)
+    {
+      if (members[root].size() < 2)
+        continue;
+
+      // The largest file usually carries the most detail
+      uint32_t keep = root;
+      off_t keep_size = -1;
+      for (uint32_t i : members[root])
+      {
+        struct stat info;
+        if (stat(photos[i].path.c_str(), &info) == 0 && info.st_size > keep_size)
+        {
+          keep = i;
+          keep_size = info.st_size;
+        }
+      }
+
+      for (uint32_t i : members[root])
+      {
+        if (i != keep)
+          printf("%s\n", photos[i].path.c_str());
+      }
+    }
+  }
+  else
+  {
+    for (uint32_t i : spreadOrder(photos, cluster, gap))
+      printf("%s\n", photos[i].path.c_str());
+  }
+
+  return 0;
+}
+
+int main(int argc, char **argv)
+{
+  if (argc >= 2 && strcmp(argv[1], "hash") == 0)
+    return hashFiles(argc - 2, argv + 2);
+
+  if (argc >= 4 && strcmp(argv[1], "cluster") == 0)
+  {
+    int distance = atoi(argv[2]);
+    bool drop = strcmp(argv[3], "drop") == 0;
+    int gap = argc >= 5 ? atoi(argv[4]) : 20;
+
+    if (distance < 0 || distance > MAX_DISTANCE || (!drop && strcmp(argv[3], "spread") != 0))
+    {
+      fprintf(stderr, "Distance must be 0-%d and the mode spread or drop\n", MAX_DISTANCE);
+      return 2;
+    }
+    return clusterHashes(distance, drop, gap);
+  }
+
+  fprintf(stderr, "Usage: %s hash <file.jpg>...\n", argv[0]);
+  fprintf(stderr, "       %s cluster <distance> <spread|drop> [gap] < hashes\n", argv[0]);
+  return 2;
+}
@@ -0,0 +1,267 @@
+// Host benchmark for the fast JPEG decoder (src/fastjpeg.cpp).
+//
+// Decodes every file given on the command line with the fast decoder and,
+// when built with WITH_TJPGD, with the tjpgd core of TJpg_Decoder as well.
+// Prints decode time per image for both, the speedup, and how close the
+// fast decoder's RGB565 output is to TJpgDec's (exact pixels and PSNR).
+// Exits non-zero when a file fails to decode or the PSNR drops below
+// MIN_PSNR. Built and run by scripts/jpegbench.sh.
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <chrono>
+#include <vector>
+
+#include "fastjpeg.h"
+
+#ifdef WITH_TJPGD
+#include "tjpgd.h"
+#endif
+
+// RGB565 truncation alone costs about 40 dB, anything well below that is
+// a decoding difference rather than rounding
+#define MIN_PSNR 36.0
+
+// Each decoder runs for at least this long per image
+#define MIN_BENCH_MS 200.0
+
+static int canvas_width = 0;
+static int canvas_height = 0;
+static std::vector<uint16_t> fast_canvas;
+static std::vector<uint16_t> tjpgd_canvas;
+
+static double nowMs()
+{
+  using namespace std::chrono;
+  return duration<double, std::milli>(steady_clock::now().time_since_epoch()).count();
+}
+
+static bool readFile(const char *path, std::vector<uint8_t> &data)
+{
+  FILE *file = fopen(path, "rb");
+  if (!file)
+    return false;
+
+  fseek(file, 0, SEEK_END);
+  data.resize(ftell(file));
+  fseek(file, 0, SEEK_SET);
+  bool ok = fread(data.data(), 1, data.size(), file) == data.size();
+  fclose(file);
+  return ok;
+}
+
+// Stores byte-swapped blocks in native RGB565, clipped to the canvas
+static bool fastOutput(int16_t x, int16_t y, uint16_t w, uint16_t h, uint16_t *pixels)
+{
+  for (int row = 0; row < h && y + row < canvas_height; row++)
+  {
+    for (int col = 0; col < w && x + col < canvas_width; col++)
+    {
+      uint16_t pixel = pixels[row * w + col];
+      fast_canvas[(y + row) * canvas_width + x + col] = (pixel >> 8) | (pixel << 8);
+    }
+  }
+  return true;
+}
+
+#ifdef WITH_TJPGD
+struct TjpgdSource
+{
+  const uint8_t *data;
+  size_t size;
+  size_t pos;
+};
+
+static size_t tjpgdInput(JDEC *jdec, uint8_t *buffer, size_t length)
+{
+  TjpgdSource *source = (TjpgdSource *)jdec->device;
+  if (length > source->size - source->pos)
+    length = source->size - source->pos;
+
+  // A null buffer means skip ahead
+  if (buffer)
+    memcpy(buffer, source->data + source->pos, length);
+
+  source->pos += length;
+  return length;
+}
+
+static int tjpgdOutput(JDEC *jdec, void *bitmap, JRECT *rect)
+{
+  const uint16_t *pixels = (const uint16_t *)bitmap;
+  int w = rect->right - rect->left + 1;
+
+  for (int y = rect->top; y <= rect->bottom && y < canvas_height; y++)
+  {
+    for (int x = rect->left; x <= rect->right && x < canvas_width; x++)
+      tjpgd_canvas[y * canvas_width + x] = pixels[(y - rect->top) * w + x - rect->left];
+  }
+  return 1;
+}
+
+static int tjpgdDecode(const std::vector<uint8_t> &data, uint16_t *width, uint16_t *height)
+{
+  static uint8_t workspace[32768];
+  TjpgdSource source = {data.data(), data.size(), 0};
+  JDEC jdec;
+
+  int result = jd_prepare(&jdec, tjpgdInput, workspace, sizeof(workspace), &source);
+  if (result != JDR_OK)
+    return result;
+
+  *width = jdec.width;
+  *height = jdec.height;
+  return jd_decomp(&jdec, tjpgdOutput, 0);
+}
+#endif
+
+// Image size from the SOF marker, so the canvas can be set up first
+static bool jpegSize(const std::vector<uint8_t> &data, int *width, int *height)
+{
+  for (size_t i = 2; i + 9 < data.size();)
+  {
+    if (data[i] != 0xFF)
+      return false;
+
+    uint8_t code = data[i + 1];
+    size_t length = (data[i + 2] << 8) | data[i + 3];
+    if (code >= 0xC0 && code <= 0xCF && code != 0xC4 && code != 0xC8 && code != 0xCC)
+    {
+      *height = (data[i + 5] << 8) | data[i + 6];
+      *width = (data[i + 7] << 8) | data[i + 8];
+      return true;
+    }
+    i += 2 + length;
+  }
+  return false;
+}
+
+template <typename Decode>
+static double benchMs(Decode decode)
+{
+  int runs = 0;
+  double started_at = nowMs();
+  double elapsed = 0;
+
+  while (elapsed < MIN_BENCH_MS)
+  {
+    decode();
+    runs++;
+    elapsed = nowMs() - started_at;
+  }
+
+  return elapsed / runs;
+}
+
+#ifdef WITH_TJPGD
+// PSNR over the RGB565 channels expanded to 8 bits, and the share of
+// identical pixels
+static double comparePsnr(double *exact)
+{
+  double squared_error = 0;
+  size_t same = 0;
+  size_t count = fast_canvas.size();
+
+  for (size_t i = 0; i < count; i++)
+  {
+    uint16_t a = fast_canvas[i], b = tjpgd_canvas[i];
+    same += a == b;
+
+    int diff[3] = {((a >> 11) - (b >> 11)) << 3, (((a >> 5) & 63) - ((b >> 5) & 63)) << 2, ((a & 31) - (b & 31)) << 3};
+    for (int c = 0; c < 3; c++)
+      squared_error += diff[c] * diff[c];
+  }
+
+  *exact = 100.0 * same / count;
+  double mse = squared_error / (count * 3);
+  return mse > 0 ? 10 * log10(255.0 * 255.0 / mse) : 99.0;
+}
+#endif
+
+int main(int argc, char **argv)
+{
+  if (argc < 2)
+  {
+    fprintf(stderr, "Usage: %s <file.jpg>...\n", argv[0]);
+    return 2;
+  }
+
+  fastJpegInit(fastOutput);
+
+  bool failed = false;
+  double fast_total = 0;
+#ifdef WITH_TJPGD
+  double tjpgd_total = 0;
+#endif
+
+#ifdef WITH_TJPGD
+  printf("%-24s %9s %11s %11s %8s %8s %7s\n", "file", "size", "TJpgDec ms", "fast ms", "speedup", "PSNR dB", "exact");
+#else
+  printf("%-24s %9s %11s\n", "file", "size", "fast ms");
+#endif
+
+  for (int i = 1; i < argc; i++)
+  {
+    const char *name = strrchr(argv[i], '/') ? strrchr(argv[i], '/') + 1 : argv[i];
+    std::vector<uint8_t> data;
+    if (!readFile(argv[i], data) || !jpegSize(data, &canvas_width, &canvas_height))
+    {
+      printf("%-24s not a readable JPEG\n", name);
+      failed = true;
+      continue;
+    }
+
+    char size[16];
+    snprintf(size, sizeof(size), "%dx%d", canvas_width, canvas_height);
+    fast_canvas.assign(canvas_width * canvas_height, 0);
+    tjpgd_canvas.assign(canvas_width * canvas_height, 0);
+
+    int result = fastJpegDrawMem(0, 0, data.data(), data.size());
+    if (result != FASTJPEG_OK)
+    {
+      printf("%-24s %9s fast decoder error %d\n", name, size, result);
+      failed = true;
+      continue;
+    }
+
+    double fast_ms = benchMs([&]
+                             { fastJpegDrawMem(0, 0, data.data(), data.size()); });
+    fast_total += fast_ms;
+
+#ifdef WITH_TJPGD
+    uint16_t width, height;
+    result = tjpgdDecode(data, &width, &height);
+    if (result != JDR_OK)
+    {
+      printf("%-24s %9s TJpgDec error %d\n", name, size, result);
+      failed = true;
+      continue;
+    }
+
+    double tjpgd_ms = benchMs([&]
+                              { tjpgdDecode(data, &width, &height); });
+    tjpgd_total += tjpgd_ms;
+
+    double exact;
+    double psnr = comparePsnr(&exact);
+    failed |= psnr < MIN_PSNR;
+
+    printf("%-24s %9s %11.3f %11.3f %7.2fx %8.2f %6.1f%%%s\n", name, size, tjpgd_ms, fast_ms,
+           tjpgd_ms / fast_ms, psnr, exact, psnr < MIN_PSNR ? "  FAIL" : "");
+#else
+    printf("%-24s %9s %11.3f\n", name, size, fast_ms);
+#endif
+  }
+
+#ifdef WITH_TJPGD
+  if (fast_total > 0)
+    printf("\nTotal: TJpgDec %.3f ms, fast %.3f ms, %.2fx\n", tjpgd_total, fast_total, tjpgd_total / fast_total);
+#else
+  printf("\nTotal: fast %.3f ms\n", fast_total);
+#endif
+
+  return failed ? 1 : 0;
+}
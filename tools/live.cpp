@@ -0,0 +1,765 @@
+// Host sender for live mode (include/live.h).
+//
+// Replays a directory of JPEGs (or the files given) on the frame as fast as
+// the link allows, or at a fixed frame rate with --fps. Each image is
+// decoded once with the fast decoder (src/fastjpeg.cpp) and centered on a
+// canvas the size of the panel; every frame then sends only the tiles that
+// differ from the previous one, RLE compressed or, built with libjpeg
+// (WITH_LIBJPEG), as small JPEGs when that is smaller. Prints the frames
+// per second achieved, the link use and the end-to-end latency from taking
+// a frame to the frame reporting it on the panel. Built and run by
+// scripts/live.sh.
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef WITH_LIBJPEG
+#include <jpeglib.h>
+#endif
+
+#include "fastjpeg.h"
+#include "live.h"
+#include "upload.h"
+
+#define REPLY_TIMEOUT_MS 1000
+#define HELLO_ATTEMPTS 3
+#define PING_ATTEMPTS 5
+#define WINDOW_TIMEOUT_MS 200 // no ACK for this long while the window is full, ask for one
+#define DRAIN_TIMEOUT_MS 1500 // wait for the last frames to be reported
+#define REPAIR_ATTEMPTS 5     // resends of damaged tiles at the end
+
+enum TileFormat
+{
+  FORMAT_RLE,
+  FORMAT_JPEG,
+  FORMAT_AUTO,
+};
+
+static int port = -1;
+static UploadParser parser;
+static uint8_t frame[UPLOAD_MAX_FRAME];
+
+// Panel and limits from the HELLO_ACK
+static int panel_w = 0, panel_h = 0;
+static size_t tile_bytes_max = 0;
+static uint32_t window_bytes = 0;
+
+static int tile_side = 32;
+static TileFormat tile_format = FORMAT_RLE;
+static int jpeg_quality = 85;
+
+// Flow control: bytes written to the port, bytes the frame has read, and
+// bytes that are never going to be read because they got lost on the line
+static uint64_t written = 0;
+static uint64_t consumed = 0;
+static uint64_t lost = 0;
+
+struct Pending
+{
+  uint16_t number;
+  double taken_at;
+  std::vector<int> cells; // grid cell of each tile, by tile index
+};
+
+static std::deque<Pending> pending; // frames sent and not reported yet
+static std::vector<bool> dirty;     // grid cells the panel may not show right, sent with the next frame
+static std::vector<double> latencies;
+static uint64_t device_busy_us = 0;
+static int frames_damaged = 0, frames_lost = 0;
+
+// Canvas the decode callback writes to
+static uint16_t *decode_canvas = nullptr;
+static int decode_x = 0, decode_y = 0;
+
+static double nowMs()
+{
+  using namespace std::chrono;
+  return duration<double, std::milli>(steady_clock::now().time_since_epoch()).count();
+}
+
+static speed_t speedFor(uint32_t baud)
+{
+  switch (baud)
+  {
+  case 115200:
+    return B115200;
+  case 230400:
+    return B230400;
+  case 460800:
+    return B460800;
+  case 921600:
+    return B921600;
+#ifdef B1000000
+  case 1000000:
+    return B1000000;
+  case 1500000:
+    return B1500000;
+  case 2000000:
+    return B2000000;
+#endif
+  default:
+    return 0;
+  }
+}
+
+static bool setBaud(uint32_t baud)
+{
+  struct termios tty;
+  if (tcgetattr(port, &tty) != 0)
+    return false;
+
+  tcdrain(port);
+  cfmakeraw(&tty);
+  tty.c_cflag |= CLOCAL | CREAD;
+  tty.c_cc[VMIN] = 0;
+  tty.c_cc[VTIME] = 0;
+  cfsetispeed(&tty, speedFor(baud));
+  cfsetospeed(&tty, speedFor(baud));
+  return tcsetattr(port, TCSANOW, &tty) == 0;
+}
+
+static void sendFrame(uint8_t type, const uint8_t *payload, size_t length)
+{
+  size_t size = uploadEncodeFrame(type, payload, length, frame);
+  written += size;
+
+  const uint8_t *p = frame;
+  while (size > 0)
+  {
+    ssize_t n = write(port, p, size);
+    if (n < 0 && errno != EAGAIN && errno != EINTR)
+    {
+      perror("write");
+      exit(1);
+    }
+    if (n > 0)
+    {
+      p += n;
+      size -= n;
+    }
+  }
+}
+
+// Waits up to timeout_ms for the next valid frame, false on timeout
+static bool receiveFrame(int timeout_ms)
+{
+  double deadline = nowMs() + timeout_ms;
+  uint8_t byte;
+
+  while (true)
+  {
+    int left = (int)(deadline - nowMs());
+    if (left <= 0)
+      return false;
+
+    struct pollfd fds = {port, POLLIN, 0};
+    if (poll(&fds, 1, left) <= 0)
+      continue;
+
+    while (read(port, &byte, 1) == 1)
+    {
+      if (uploadParse(parser, byte))
+        return true;
+    }
+  }
+}
+
+// Sends a frame until the expected reply arrives
+static bool request(uint8_t type, const uint8_t *payload, size_t length, uint8_t reply, int attempts)
+{
+  for (int i = 0; i < attempts; i++)
+  {
+    sendFrame(type, payload, length);
+
+    double deadline = nowMs() + REPLY_TIMEOUT_MS;
+    while (nowMs() < deadline && receiveFrame((int)(deadline - nowMs())))
+    {
+      if (parser.type == reply || parser.type == UPLOAD_ERROR)
+        return parser.type == reply;
+    }
+  }
+  return false;
+}
+
+// Offsets are 32-bit on the wire, extended against what was written
+static void updateConsumed(uint32_t reported)
+{
+  uint64_t value = (written & ~0xFFFFFFFFull) | reported;
+  if (value > written)
+    value -= 1ull << 32;
+  if (value > consumed)
+    consumed = value;
+}
+
+// Tiles left out of the drawn bitmap, or all of them without one
+static void markDirty(const Pending &frame, const uint8_t *drawn)
+{
+  for (size_t i = 0; i < frame.cells.size(); i++)
+  {
+    if (!drawn || !(drawn[i / 8] & (1 << (i % 8))))
+      dirty[frame.cells[i]] = true;
+  }
+}
+
+static void handleReply()
+{
+  if (parser.type == LIVE_ACK && parser.payload_length >= 4)
+  {
+    updateConsumed(uploadGet32(parser.payload));
+  }
+  else if (parser.type == LIVE_FRAME_ACK && parser.payload_length >= 11)
+  {
+    uint16_t number = uploadGet16(parser.payload);
+    updateConsumed(uploadGet32(parser.payload + 3));
+
+    // A repeated report of a frame already handled
+    if (std::none_of(pending.begin(), pending.end(), [&](const Pending &frame) { return frame.number == number; }))
+      return;
+
+    // Frames reported out of turn went missing on the way
+    while (!pending.empty() && pending.front().number != number)
+    {
+      markDirty(pending.front(), nullptr);
+      pending.pop_front();
+      frames_lost++;
+    }
+    if (pending.empty())
+      return;
+
+    // Damaged frames are on the panel too, less a few tiles
+    latencies.push_back(nowMs() - pending.front().taken_at);
+    device_busy_us += uploadGet32(parser.payload + 7);
+    if (parser.payload[2] != LIVE_FRAME_OK)
+    {
+      bool complete = parser.payload_length >= 13 + (pending.front().cells.size() + 7) / 8 &&
+                      uploadGet16(parser.payload + 11) == pending.front().cells.size();
+      markDirty(pending.front(), complete ? parser.payload + 13 : nullptr);
+      frames_damaged++;
+    }
+    pending.pop_front();
+  }
+}
+
+// Asks for the read count. The frame reads in order, so by the time it
+// answers everything sent before the PING has been read or is not coming.
+static void probe()
+{
+  sendFrame(UPLOAD_PING, nullptr, 0);
+
+  double deadline = nowMs() + REPLY_TIMEOUT_MS;
+  while (nowMs() < deadline && receiveFrame((int)(deadline - nowMs())))
+  {
+    handleReply();
+    if (parser.type == LIVE_ACK)
+    {
+      lost = written - consumed;
+      return;
+    }
+  }
+}
+
+// Blocks until length more bytes fit in the window
+static void waitForWindow(size_t length)
+{
+  while (written - consumed - lost + length > window_bytes)
+  {
+    if (receiveFrame(WINDOW_TIMEOUT_MS))
+      handleReply();
+    else
+      probe();
+  }
+}
+
+static void sendEnd(uint16_t number)
+{
+  uint8_t payload[2];
+  uploadPut16(payload, number);
+  waitForWindow(sizeof(payload) + 16);
+  sendFrame(LIVE_END, payload, sizeof(payload));
+}
+
+static void drainReplies()
+{
+  uint8_t byte;
+  while (read(port, &byte, 1) == 1)
+  {
+    if (uploadParse(parser, byte))
+      handleReply();
+  }
+}
+
+// ====== IMAGES ======
+
+static bool readFile(const char *path, std::vector<uint8_t> &data)
+{
+  FILE *file = fopen(path, "rb");
+  if (!file)
+    return false;
+
+  fseek(file, 0, SEEK_END);
+  data.resize(ftell(file));
+  fseek(file, 0, SEEK_SET);
+  bool ok = fread(data.data(), 1, data.size(), file) == data.size();
+  fclose(file);
+  return ok;
+}
+
+static bool jpegSize(const std::vector<uint8_t> &data, int *width, int *height)
+{
+  for (size_t i = 2; i + 9 < data.size();)
+  {
+    if (data[i] != 0xFF)
+      return false;
+
+    uint8_t code = data[i + 1];
+    size_t length = (data[i + 2] << 8) | data[i + 3];
+    if (code >= 0xC0 && code <= 0xCF && code != 0xC4 && code != 0xC8 && code != 0xCC)
+    {
+      *height = (data[i + 5] << 8) | data[i + 6];
+      *width = (data[i + 7] << 8) | data[i + 8];
+      return true;
+    }
+    i += 2 + length;
+  }
+  return false;
+}
+
+static bool canvasOutput(int16_t x, int16_t y, uint16_t w, uint16_t h, uint16_t *pixels)
+{
+  for (int row = 0; row < h; row++)
+  {
+    int cy = decode_y + y + row;
+    if (cy < 0 || cy >= panel_h)
+      continue;
+
+    for (int col = 0; col < w; col++)
+    {
+      int cx = decode_x + x + col;
+      if (cx >= 0 && cx < panel_w)
+        decode_canvas[cy * panel_w + cx] = pixels[row * w + col];
+    }
+  }
+  return true;
+}
+
+// Centered on a black canvas the size of the panel, like the slideshow
+static bool loadImage(const char *path, std::vector<uint16_t> &canvas)
+{
+  std::vector<uint8_t> data;
+  int width, height;
+  if (!readFile(path, data) || !jpegSize(data, &width, &height))
+    return false;
+
+  canvas.assign((size_t)panel_w * panel_h, 0);
+  decode_canvas = canvas.data();
+  decode_x = (panel_w - width) / 2;
+  decode_y = (panel_h - height) / 2;
+  return fastJpegDrawMem(0, 0, data.data(), data.size()) == FASTJPEG_OK;
+}
+
+static void collectImages(const char *path, std::vector<std::string> &paths)
+{
+  DIR *dir = opendir(path);
+  if (!dir)
+  {
+    paths.push_back(path);
+    return;
+  }
+
+  std::vector<std::string> found;
+  while (struct dirent *entry = readdir(dir))
+  {
+    std::string name = entry->d_name;
+    std::string lower = name;
+    std::transform(lower.begin(), lower.end(), lower.begin(), ::tolower);
+    if (name[0] != '.' && lower.size() > 4 && lower.compare(lower.size() - 4, 4, ".jpg") == 0)
+      found.push_back(std::string(path) + "/" + name);
+  }
+  closedir(dir);
+
+  std::sort(found.begin(), found.end());
+  paths.insert(paths.end(), found.begin(), found.end());
+}
+
+// ====== TILES ======
+
+#ifdef WITH_LIBJPEG
+static size_t encodeJpeg(const uint16_t *pixels, int w, int h, std::vector<uint8_t> &out)
+{
+  struct jpeg_compress_struct cinfo;
+  struct jpeg_error_mgr jerr;
+  cinfo.err = jpeg_std_error(&jerr);
+  jpeg_create_compress(&cinfo);
+
+  unsigned char *buffer = nullptr;
+  unsigned long size = 0;
+  jpeg_mem_dest(&cinfo, &buffer, &size);
+
+  cinfo.image_width = w;
+  cinfo.image_height = h;
+  cinfo.input_components = 3;
+  cinfo.in_color_space = JCS_RGB;
+  jpeg_set_defaults(&cinfo);
+  jpeg_set_quality(&cinfo, jpeg_quality, TRUE);
+  cinfo.write_JFIF_header = FALSE;
+  cinfo.optimize_coding = TRUE;
+  jpeg_start_compress(&cinfo, TRUE);
+
+  std::vector<uint8_t> row(w * 3);
+  while (cinfo.next_scanline < cinfo.image_height)
+  {
+    const uint16_t *src = pixels + cinfo.next_scanline * w;
+    for (int i = 0; i < w; i++)
+    {
+      uint16_t pixel = (uint16_t)((src[i] >> 8) | (src[i] << 8));
+      row[i * 3] = ((pixel >> 11) << 3) | (pixel >> 13);
+      row[i * 3 + 1] = (((pixel >> 5) & 0x3F) << 2) | ((pixel >> 9) & 0x03);
+      row[i * 3 + 2] = ((pixel & 0x1F) << 3) | ((pixel >> 2) & 0x07);
+    }
+    JSAMPROW rows[1] = {row.data()};
+    jpeg_write_scanlines(&cinfo, rows, 1);
+  }
+
+  jpeg_finish_compress(&cinfo);
+  jpeg_destroy_compress(&cinfo);
+
+  out.assign(buffer, buffer + size);
+  free(buffer);
+  return out.size();
+}
+#endif
+
+struct Tile
+{
+  int x, y, w, h;
+  uint8_t format;
+  std::vector<uint8_t> data;
+};
+
+static void encodeTile(const std::vector<uint16_t> &canvas, Tile &tile)
+{
+  std::vector<uint16_t> pixels(tile.w * tile.h);
+  for (int row = 0; row < tile.h; row++)
+    memcpy(&pixels[row * tile.w], &canvas[(tile.y + row) * panel_w + tile.x], tile.w * sizeof(uint16_t));
+
+  tile.data.resize(tile_bytes_max);
+  tile.data.resize(liveRleEncode(pixels.data(), pixels.size(), tile.data.data(), tile.data.size()));
+  tile.format = LIVE_FORMAT_RLE;
+
+#ifdef WITH_LIBJPEG
+  if (tile_format != FORMAT_RLE)
+  {
+    std::vector<uint8_t> jpeg;
+    encodeJpeg(pixels.data(), tile.w, tile.h, jpeg);
+
+    // Flat areas stay exact when RLE is no larger
+    if (jpeg.size() <= tile_bytes_max && (tile_format == FORMAT_JPEG || jpeg.size() < tile.data.size()))
+    {
+      tile.data.swap(jpeg);
+      tile.format = LIVE_FORMAT_JPEG;
+    }
+  }
+#endif
+}
+
+static bool tileChanged(const std::vector<uint16_t> &canvas, const std::vector<uint16_t> &shown, const Tile &tile)
+{
+  for (int row = 0; row < tile.h; row++)
+  {
+    size_t start = (size_t)(tile.y + row) * panel_w + tile.x;
+    if (memcmp(&canvas[start], &shown[start], tile.w * sizeof(uint16_t)) != 0)
+      return true;
+  }
+  return false;
+}
+
+// Sends the changed and dirty tiles of one frame, returns the bytes put on the wire
+static size_t sendImage(uint16_t number, const std::vector<uint16_t> &canvas, std::vector<uint16_t> &shown,
+                        double taken_at, int *tile_count)
+{
+  std::vector<Tile> tiles;
+  Pending frame = {number, taken_at, {}};
+  int cell = 0;
+  for (int y = 0; y < panel_h; y += tile_side)
+  {
+    for (int x = 0; x < panel_w; x += tile_side, cell++)
+    {
+      Tile tile = {x, y, std::min(tile_side, panel_w - x), std::min(tile_side, panel_h - y), 0, {}};
+      if (dirty[cell] || tileChanged(canvas, shown, tile))
+      {
+        tiles.push_back(tile);
+        frame.cells.push_back(cell);
+        dirty[cell] = false;
+      }
+    }
+  }
+
+  *tile_count = tiles.size();
+  if (tiles.empty())
+    return 0;
+
+  pending.push_back(frame);
+  uint64_t started = written;
+
+  // Encode one tile while the frame is still busy with the last
+  static uint8_t payload[LIVE_TILE_HEADER + UPLOAD_CHUNK];
+  for (size_t index = 0; index < tiles.size(); index++)
+  {
+    Tile &tile = tiles[index];
+    encodeTile(canvas, tile);
+
+    for (size_t offset = 0; offset < tile.data.size(); offset += UPLOAD_CHUNK)
+    {
+      size_t length = std::min<size_t>(UPLOAD_CHUNK, tile.data.size() - offset);
+      uploadPut16(payload, number);
+      uploadPut16(payload + 2, tiles.size());
+      uploadPut16(payload + 4, index);
+      uploadPut16(payload + 6, tile.x);
+      uploadPut16(payload + 8, tile.y);
+      payload[10] = tile.w;
+      payload[11] = tile.h;
+      payload[12] = tile.format;
+      payload[13] = 0;
+      uploadPut16(payload + 14, offset);
+      uploadPut16(payload + 16, tile.data.size());
+      memcpy(payload + LIVE_TILE_HEADER, tile.data.data() + offset, length);
+
+      waitForWindow(LIVE_TILE_HEADER + length + 16);
+      sendFrame(LIVE_TILE, payload, LIVE_TILE_HEADER + length);
+    }
+    drainReplies();
+  }
+
+  sendEnd(number);
+
+  shown = canvas;
+  return written - started;
+}
+
+static double percentile(std::vector<double> values, double p)
+{
+  if (values.empty())
+    return 0;
+  std::sort(values.begin(), values.end());
+  return values[std::min(values.size() - 1, (size_t)(p * (values.size() - 1) + 0.5))];
+}
+
+int main(int argc, char **argv)
+{
+  uint32_t baud = UPLOAD_MAX_BAUD;
+  double fps = 0;
+  int loops = 1;
+  int arg = 1;
+
+  for (; arg < argc && argv[arg][0] == '-'; arg++)
+  {
+    if (strcmp(argv[arg], "-b") == 0 && arg + 1 < argc)
+      baud = strtoul(argv[++arg], nullptr, 10);
+    else if (strcmp(argv[arg], "-t") == 0 && arg + 1 < argc)
+      tile_side = atoi(argv[++arg]);
+    else if (strcmp(argv[arg], "-f") == 0 && arg + 1 < argc)
+    {
+      const char *name = argv[++arg];
+      tile_format = strcmp(name, "jpeg") == 0 ? FORMAT_JPEG : strcmp(name, "auto") == 0 ? FORMAT_AUTO : FORMAT_RLE;
+    }
+    else if (strcmp(argv[arg], "-q") == 0 && arg + 1 < argc)
+      jpeg_quality = atoi(argv[++arg]);
+    else if (strcmp(argv[arg], "--fps") == 0 && arg + 1 < argc)
+      fps = atof(argv[++arg]);
+    else if (strcmp(argv[arg], "--loops") == 0 && arg + 1 < argc)
+      loops = atoi(argv[++arg]);
+    else
+      break;
+  }
+
+#ifndef WITH_LIBJPEG
+  if (tile_format != FORMAT_RLE)
+  {
+    fprintf(stderr, "Built without libjpeg, sending RLE tiles\n");
+    tile_format = FORMAT_RLE;
+  }
+#endif
+
+  if (argc - arg < 2 || speedFor(baud) == 0 || tile_side < 16 || tile_side > LIVE_TILE_SIDE || loops < 1)
+  {
+    fprintf(stderr, "Usage: %s [options] <port> <directory|file.jpg>...\n", argv[0]);
+    fprintf(stderr, "  -b baud      session baud, 115200 to 2000000 (default %d)\n", UPLOAD_MAX_BAUD);
+    fprintf(stderr, "  -t side      tile width and height, 16 to %d (default 32)\n", LIVE_TILE_SIDE);
+    fprintf(stderr, "  -f format    rle, jpeg or auto, the smaller of both per tile (default rle)\n");
+    fprintf(stderr, "  -q quality   JPEG tile quality (default 85)\n");
+    fprintf(stderr, "  --fps N      take frames at this rate instead of as fast as possible\n");
+    fprintf(stderr, "  --loops N    play the images N times (default 1)\n");
+    return 2;
+  }
+
+  std::vector<std::string> paths;
+  for (int i = arg + 1; i < argc; i++)
+    collectImages(argv[i], paths);
+  if (paths.empty())
+  {
+    fprintf(stderr, "No .jpg files found\n");
+    return 1;
+  }
+
+  port = open(argv[arg], O_RDWR | O_NOCTTY | O_NONBLOCK);
+  if (port < 0 || !setBaud(UPLOAD_DEFAULT_BAUD))
+  {
+    perror(argv[arg]);
+    return 1;
+  }
+  uploadParserReset(parser);
+
+  // The frame takes its clock from the host
+  time_t now = time(nullptr);
+  struct tm local;
+  localtime_r(&now, &local);
+
+  uint8_t hello[UPLOAD_HELLO_CLOCK_LENGTH];
+  uploadPut32(hello, baud);
+  uploadPut32(hello + 4, (uint32_t)now);
+  uploadPut32(hello + 8, (uint32_t)(int32_t)local.tm_gmtoff);
+  if (!request(LIVE_HELLO, hello, sizeof(hello), LIVE_HELLO_ACK, HELLO_ATTEMPTS))
+  {
+    fprintf(stderr, "No answer from the frame on %s\n", argv[arg]);
+    return 1;
+  }
+
+  uint32_t session_baud = uploadGet32(parser.payload);
+  panel_w = uploadGet16(parser.payload + 4);
+  panel_h = uploadGet16(parser.payload + 6);
+  tile_side = std::min<int>(tile_side, parser.payload[8]);
+  tile_bytes_max = uploadGet16(parser.payload + 9);
+  window_bytes = uploadGet16(parser.payload + 11);
+
+  int cells = ((panel_w + tile_side - 1) / tile_side) * ((panel_h + tile_side - 1) / tile_side);
+  if (cells > LIVE_FRAME_TILES)
+  {
+    fprintf(stderr, "%dx%d tiles make more than %d per frame on a %dx%d panel\n", tile_side, tile_side,
+            LIVE_FRAME_TILES, panel_w, panel_h);
+    return 1;
+  }
+  dirty.assign(cells, true);
+
+  if (speedFor(session_baud) == 0 || !setBaud(session_baud) || !request(UPLOAD_PING, nullptr, 0, LIVE_ACK, PING_ATTEMPTS))
+  {
+    fprintf(stderr, "Could not switch to %u baud\n", session_baud);
+    return 1;
+  }
+  handleReply();
+
+  // Decoded up front, so the replay measures the link and the frame only
+  fastJpegInit(canvasOutput);
+  std::vector<std::vector<uint16_t>> images;
+  for (const std::string &path : paths)
+  {
+    std::vector<uint16_t> canvas;
+    if (loadImage(path.c_str(), canvas))
+      images.push_back(std::move(canvas));
+    else
+      fprintf(stderr, "%s: not a decodable JPEG, skipped\n", path.c_str());
+  }
+  if (images.empty())
+    return 1;
+
+  const char *format_names[] = {"rle", "jpeg", "auto"};
+  printf("Session at %u baud, panel %dx%d, %dx%d %s tiles, %zu image(s)\n", session_baud, panel_w, panel_h, tile_side,
+         tile_side, format_names[tile_format], images.size());
+
+  std::vector<uint16_t> shown((size_t)panel_w * panel_h, 0);
+  uint16_t number = 0;
+  int frames = 0, unchanged = 0, repairs = 0;
+  long tiles_sent = 0;
+  uint64_t started_bytes = written;
+  double started_at = nowMs();
+
+  for (int loop = 0; loop < loops; loop++)
+  {
+    for (const std::vector<uint16_t> &canvas : images)
+    {
+      if (fps > 0)
+      {
+        double due = started_at + frames * 1000.0 / fps;
+        if (due > nowMs())
+          std::this_thread::sleep_for(std::chrono::duration<double, std::milli>(due - nowMs()));
+      }
+
+      int tile_count;
+      size_t bytes = sendImage(number, canvas, shown, nowMs(), &tile_count);
+      frames++;
+      if (tile_count == 0)
+      {
+        unchanged++;
+        continue;
+      }
+
+      tiles_sent += tile_count;
+      printf("Frame %u: %d tiles, %zu bytes\n", number, tile_count, bytes);
+      number++;
+      drainReplies();
+    }
+  }
+
+  // Wait for the last frames, then send damaged tiles of the last image
+  // again until the panel shows it right
+  for (int repair = 0; repair <= REPAIR_ATTEMPTS; repair++)
+  {
+    double deadline = nowMs() + DRAIN_TIMEOUT_MS;
+    while (!pending.empty() && nowMs() < deadline)
+    {
+      if (receiveFrame(WINDOW_TIMEOUT_MS))
+        handleReply();
+      else
+        sendEnd(pending.back().number);
+    }
+    while (!pending.empty())
+    {
+      markDirty(pending.front(), nullptr);
+      pending.pop_front();
+      frames_lost++;
+    }
+
+    int tile_count;
+    if (repair == REPAIR_ATTEMPTS || sendImage(number, images.back(), shown, nowMs(), &tile_count) == 0)
+      break;
+    printf("Repair %u: %d tiles\n", number, tile_count);
+    repairs++;
+    number++;
+  }
+
+  double elapsed = (nowMs() - started_at) / 1000.0;
+  uint64_t bytes = written - started_bytes;
+  request(LIVE_BYE, nullptr, 0, LIVE_BYE_ACK, 3);
+
+  int sent = frames - unchanged;
+  printf("\n");
+  printf("Frames:   %d sent, %d unchanged and skipped, %d damaged, %d lost, %d repairs\n", sent, unchanged,
+         frames_damaged, frames_lost, repairs);
+  printf("Tiles:    %.1f per frame, %.1f KB per frame\n", sent ? (double)tiles_sent / sent : 0.0,
+         sent ? bytes / 1024.0 / sent : 0.0);
+  printf("Rate:     %.2f fps, link %.1f KB/s (%.0f%% of the baud)\n", elapsed > 0 ? latencies.size() / elapsed : 0.0,
+         elapsed > 0 ? bytes / 1024.0 / elapsed : 0.0, elapsed > 0 ? bytes * 10.0 / elapsed / session_baud * 100 : 0.0);
+  printf("Latency:  p50 %.0f ms, p90 %.0f ms, max %.0f ms\n", percentile(latencies, 0.5), percentile(latencies, 0.9),
+         percentile(latencies, 1.0));
+  printf("On frame: %.1f ms decoding and drawing per frame\n",
+         latencies.empty() ? 0.0 : device_busy_us / 1000.0 / latencies.size());
+  if (parser.crc_errors)
+    printf("%u damaged frames received\n", parser.crc_errors);
+
+  close(port);
+  return latencies.empty() ? 1 : 0;
+}
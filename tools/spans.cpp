@@ -0,0 +1,291 @@
+// Host side of span tracing (include/spans.h).
+//
+// Asks the frame for its span ring with a SPAN_REQUEST frame, or reads a
+// dump saved from the serial monitor, and writes it as Chrome trace JSON:
+// one complete event per span, one track per core, times in microseconds
+// from the first span. Open the file in ui.perfetto.dev or chrome://tracing.
+// Also prints the spans with the most time in total.
+// Built and run by scripts/spans.sh.
+
+#include <fcntl.h>
+#include <math.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "spans.h"
+#include "upload.h"
+
+#define DUMP_TIMEOUT_MS 3000 // gives up when the port stays quiet this long
+#define SUMMARY_ROWS 12
+
+struct Span
+{
+  int core;
+  uint32_t end_tick;
+  uint32_t start;
+  uint32_t cycles;
+  std::string name;
+  double start_us; // unwrapped, filled in by the conversion
+};
+
+struct Dump
+{
+  unsigned mhz = 0;
+  unsigned tick_hz = 0;
+  unsigned recorded = 0;
+  std::vector<Span> spans;
+};
+
+static double nowMs()
+{
+  using namespace std::chrono;
+  return duration<double, std::milli>(steady_clock::now().time_since_epoch()).count();
+}
+
+// Feeds one line, true once the dump is complete
+static bool parseLine(const char *line, Dump &dump, bool &inside)
+{
+  unsigned core, end_tick, start, cycles, listed;
+  int name_at = 0;
+
+  if (sscanf(line, "SPANS BEGIN %x %x %x %x", &dump.mhz, &dump.tick_hz, &listed, &dump.recorded) == 4)
+  {
+    // A later dump replaces an earlier one in the same log
+    inside = true;
+    dump.spans.clear();
+  }
+  else if (inside && strncmp(line, "SPANS END", 9) == 0)
+  {
+    inside = false;
+    return true;
+  }
+  else if (inside && sscanf(line, "%x %x %x %x %n", &core, &end_tick, &start, &cycles, &name_at) == 4 && name_at > 0)
+  {
+    std::string name = line + name_at;
+    while (!name.empty() && (name.back() == '\r' || name.back() == '\n'))
+      name.pop_back();
+    dump.spans.push_back({(int)core, end_tick, start, cycles, name, 0});
+  }
+  return false;
+}
+
+static bool readDumpFile(const char *path, Dump &dump)
+{
+  FILE *file = fopen(path, "r");
+  if (!file)
+    return false;
+
+  char line[256];
+  bool inside = false, complete = false;
+  while (fgets(line, sizeof(line), file))
+  {
+    if (parseLine(line, dump, inside))
+      complete = true;
+  }
+  fclose(file);
+  return complete;
+}
+
+static bool readDumpPort(const char *path, Dump &dump)
+{
+  int port = open(path, O_RDWR | O_NOCTTY | O_NONBLOCK);
+  struct termios tty;
+  if (port < 0 || tcgetattr(port, &tty) != 0)
+  {
+    perror(path);
+    return false;
+  }
+
+  cfmakeraw(&tty);
+  tty.c_cflag |= CLOCAL | CREAD;
+  cfsetispeed(&tty, B115200);
+  cfsetospeed(&tty, B115200);
+  tcsetattr(port, TCSANOW, &tty);
+  tcflush(port, TCIFLUSH);
+
+  uint8_t frame[UPLOAD_MAX_FRAME];
+  size_t size = uploadEncodeFrame(SPAN_REQUEST, nullptr, 0, frame);
+  if (write(port, frame, size) != (ssize_t)size)
+  {
+    perror("write");
+    close(port);
+    return false;
+  }
+
+  std::string line;
+  bool inside = false;
+  double quiet_since = nowMs();
+
+  while (nowMs() - quiet_since < DUMP_TIMEOUT_MS)
+  {
+    struct pollfd fds = {port, POLLIN, 0};
+    if (poll(&fds, 1, 100) <= 0)
+      continue;
+
+    char buffer[512];
+    ssize_t n;
+    while ((n = read(port, buffer, sizeof(buffer))) > 0)
+    {
+      quiet_since = nowMs();
+      for (ssize_t i = 0; i < n; i++)
+      {
+        if (buffer[i] != '\n')
+        {
+          line += buffer[i];
+          continue;
+        }
+
+        if (parseLine(line.c_str(), dump, inside))
+        {
+          close(port);
+          return true;
+        }
+        line.clear();
+      }
+    }
+  }
+
+  close(port);
+  return false;
+}
+
+// The cycle counter wraps every few seconds, the tick count of each span
+// says which lap it is on
+static void unwrap(Dump &dump)
+{
+  const double lap = 4294967296.0;
+  double first = -1;
+
+  for (Span &span : dump.spans)
+  {
+    double near = (double)span.end_tick * dump.mhz * 1e6 / dump.tick_hz;
+    double end = span.start + (double)span.cycles;
+    end += lap * floor((near - end) / lap + 0.5);
+    span.start_us = (end - span.cycles) / dump.mhz;
+
+    if (first < 0 || span.start_us < first)
+      first = span.start_us;
+  }
+
+  for (Span &span : dump.spans)
+    span.start_us -= first;
+}
+
+static void writeJsonString(FILE *out, const std::string &text)
+{
+  fputc('"', out);
+  for (char c : text)
+  {
+    if (c == '"' || c == '\\')
+      fputc('\\', out);
+    if ((unsigned char)c >= 0x20)
+      fputc(c, out);
+  }
+  fputc('"', out);
+}
+
+static bool writeChromeTrace(const char *path, const Dump &dump)
+{
+  FILE *out = fopen(path, "w");
+  if (!out)
+    return false;
+
+  fprintf(out, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+  fprintf(out, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"photo frame\"}},\n");
+  fprintf(out, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"core 0\"}},\n");
+  fprintf(out, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"core 1\"}}");
+
+  for (const Span &span : dump.spans)
+  {
+    fprintf(out, ",\n{\"name\":");
+    writeJsonString(out, span.name);
+    fprintf(out, ",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}", span.core, span.start_us,
+            (double)span.cycles / dump.mhz);
+  }
+
+  fprintf(out, "\n]}\n");
+  return fclose(out) == 0;
+}
+
+static void printSummary(const Dump &dump)
+{
+  struct Total
+  {
+    unsigned count = 0;
+    double us = 0;
+    double max_us = 0;
+  };
+  std::map<std::string, Total> totals;
+
+  double end_us = 0;
+  for (const Span &span : dump.spans)
+  {
+    double us = (double)span.cycles / dump.mhz;
+    Total &total = totals[span.name];
+    total.count++;
+    total.us += us;
+    total.max_us = std::max(total.max_us, us);
+    end_us = std::max(end_us, span.start_us + us);
+  }
+
+  std::vector<std::pair<std::string, Total>> rows(totals.begin(), totals.end());
+  std::sort(rows.begin(), rows.end(), [](const auto &a, const auto &b) { return a.second.us > b.second.us; });
+
+  printf("%zu spans over %.1f ms", dump.spans.size(), end_us / 1000.0);
+  if (dump.recorded > dump.spans.size())
+    printf(", the %u before them were overwritten", dump.recorded - (unsigned)dump.spans.size());
+  printf("\n\n%-24s %8s %12s %12s %12s\n", "span", "count", "total ms", "mean us", "max us");
+
+  for (size_t i = 0; i < rows.size() && i < SUMMARY_ROWS; i++)
+  {
+    const Total &total = rows[i].second;
+    printf("%-24s %8u %12.2f %12.1f %12.1f\n", rows[i].first.c_str(), total.count, total.us / 1000.0,
+           total.us / total.count, total.max_us);
+  }
+}
+
+int main(int argc, char **argv)
+{
+  bool from_file = argc == 4 && strcmp(argv[1], "-i") == 0;
+  if (argc != 3 && !from_file)
+  {
+    fprintf(stderr, "Usage: %s <port> <trace.json>\n", argv[0]);
+    fprintf(stderr, "       %s -i <saved log> <trace.json>\n", argv[0]);
+    return 2;
+  }
+
+  Dump dump;
+  const char *source = argv[from_file ? 2 : 1];
+  if (from_file ? !readDumpFile(source, dump) : !readDumpPort(source, dump))
+  {
+    fprintf(stderr, "No span dump from %s (is the firmware built with SPAN_TRACE?)\n", source);
+    return 1;
+  }
+  if (dump.mhz == 0 || dump.tick_hz == 0)
+  {
+    fprintf(stderr, "Bad dump header\n");
+    return 1;
+  }
+
+  unwrap(dump);
+
+  const char *output = argv[argc - 1];
+  if (!writeChromeTrace(output, dump))
+  {
+    perror(output);
+    return 1;
+  }
+
+  printSummary(dump);
+  return 0;
+}
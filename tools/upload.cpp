@@ -0,0 +1,360 @@
+// Host sender for the serial upload protocol (include/upload.h).
+//
+// Opens a session with the frame at 115200 baud, switches both ends to the
+// requested baud and sends each file with a window of DATA frames in
+// flight, going back to the offset in a NAK or to the last acknowledged
+// offset after a timeout. Files interrupted earlier resume where the card
+// left off. Prints the sustained rate per file and for the whole session.
+// Built and run by scripts/upload.sh and scripts/upload_test.sh.
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "upload.h"
+
+#define REPLY_TIMEOUT_MS 1000
+#define HELLO_ATTEMPTS 3
+#define PING_ATTEMPTS 5
+
+static int port = -1;
+static UploadParser parser;
+static uint8_t frame[UPLOAD_MAX_FRAME];
+
+static uint32_t session_baud = UPLOAD_DEFAULT_BAUD;
+static bool compress_data = false;
+static long stop_after = -1; // testing: quit without closing after this many bytes
+
+static double nowMs()
+{
+  using namespace std::chrono;
+  return duration<double, std::milli>(steady_clock::now().time_since_epoch()).count();
+}
+
+static speed_t speedFor(uint32_t baud)
+{
+  switch (baud)
+  {
+  case 115200:
+    return B115200;
+  case 230400:
+    return B230400;
+  case 460800:
+    return B460800;
+  case 921600:
+    return B921600;
+#ifdef B1000000
+  case 1000000:
+    return B1000000;
+  case 1500000:
+    return B1500000;
+  case 2000000:
+    return B2000000;
+#endif
+  default:
+    return 0;
+  }
+}
+
+static bool setBaud(uint32_t baud)
+{
+  struct termios tty;
+  if (tcgetattr(port, &tty) != 0)
+    return false;
+
+  tcdrain(port);
+  cfmakeraw(&tty);
+  tty.c_cflag |= CLOCAL | CREAD;
+  tty.c_cc[VMIN] = 0;
+  tty.c_cc[VTIME] = 0;
+  cfsetispeed(&tty, speedFor(baud));
+  cfsetospeed(&tty, speedFor(baud));
+  return tcsetattr(port, TCSANOW, &tty) == 0;
+}
+
+static void sendFrame(uint8_t type, const uint8_t *payload, size_t length)
+{
+  size_t size = uploadEncodeFrame(type, payload, length, frame);
+  const uint8_t *p = frame;
+  while (size > 0)
+  {
+    ssize_t n = write(port, p, size);
+    if (n < 0 && errno != EAGAIN && errno != EINTR)
+    {
+      perror("write");
+      exit(1);
+    }
+    if (n > 0)
+    {
+      p += n;
+      size -= n;
+    }
+  }
+}
+
+// Waits up to timeout_ms for the next valid frame, false on timeout
+static bool receiveFrame(int timeout_ms)
+{
+  double deadline = nowMs() + timeout_ms;
+  uint8_t byte;
+
+  while (true)
+  {
+    int left = (int)(deadline - nowMs());
+    if (left <= 0)
+      return false;
+
+    struct pollfd fds = {port, POLLIN, 0};
+    if (poll(&fds, 1, left) <= 0)
+      continue;
+
+    while (read(port, &byte, 1) == 1)
+    {
+      if (uploadParse(parser, byte))
+        return true;
+    }
+  }
+}
+
+// Sends a frame until the expected reply arrives
+static bool request(uint8_t type, const uint8_t *payload, size_t length, uint8_t reply, int attempts)
+{
+  for (int i = 0; i < attempts; i++)
+  {
+    sendFrame(type, payload, length);
+
+    double deadline = nowMs() + REPLY_TIMEOUT_MS;
+    while (nowMs() < deadline && receiveFrame((int)(deadline - nowMs())))
+    {
+      if (parser.type == reply || parser.type == UPLOAD_ERROR)
+        return parser.type == reply;
+    }
+  }
+  return false;
+}
+
+static bool readFile(const char *path, std::vector<uint8_t> &data)
+{
+  FILE *file = fopen(path, "rb");
+  if (!file)
+    return false;
+
+  fseek(file, 0, SEEK_END);
+  data.resize(ftell(file));
+  fseek(file, 0, SEEK_SET);
+  bool ok = fread(data.data(), 1, data.size(), file) == data.size();
+  fclose(file);
+  return ok;
+}
+
+static void sendData(const std::vector<uint8_t> &data, uint32_t offset)
+{
+  static uint8_t payload[5 + UPLOAD_CHUNK];
+  size_t length = data.size() - offset < UPLOAD_CHUNK ? data.size() - offset : UPLOAD_CHUNK;
+
+  uploadPut32(payload, offset);
+  payload[4] = 0;
+  size_t packed = compress_data ? uploadCompress(data.data() + offset, length, payload + 5, UPLOAD_CHUNK) : 0;
+  if (packed)
+  {
+    payload[4] = UPLOAD_DATA_COMPRESSED;
+    sendFrame(UPLOAD_DATA, payload, 5 + packed);
+  }
+  else
+  {
+    memcpy(payload + 5, data.data() + offset, length);
+    sendFrame(UPLOAD_DATA, payload, 5 + length);
+  }
+}
+
+// Returns the bytes sent in this session for the file, -1 on failure
+static long sendFile(const char *path, int window)
+{
+  std::vector<uint8_t> data;
+  if (!readFile(path, data))
+  {
+    fprintf(stderr, "%s: cannot read\n", path);
+    return -1;
+  }
+
+  const char *name = strrchr(path, '/') ? strrchr(path, '/') + 1 : path;
+  uint32_t size = data.size();
+  uint32_t crc = uploadCrc32(0, data.data(), data.size());
+
+  uint8_t open[8 + UPLOAD_NAME_MAX];
+  size_t name_length = strlen(name);
+  if (name_length >= UPLOAD_NAME_MAX)
+  {
+    fprintf(stderr, "%s: name longer than %d characters\n", name, UPLOAD_NAME_MAX - 1);
+    return -1;
+  }
+  uploadPut32(open, size);
+  uploadPut32(open + 4, crc);
+  memcpy(open + 8, name, name_length);
+
+  if (!request(UPLOAD_OPEN, open, 8 + name_length, UPLOAD_OPEN_ACK, 3))
+  {
+    fprintf(stderr, "%s: rejected by the frame\n", name);
+    return -1;
+  }
+
+  uint32_t acked = uploadGet32(parser.payload);
+  uint32_t resumed_at = acked;
+  uint32_t next = acked;
+  uint32_t retransmits = 0;
+  double started_at = nowMs();
+
+  // Twice the time a full window takes on the wire, ten bits per byte
+  int data_timeout = 100 + 2 * window * (UPLOAD_CHUNK + 16) * 10000 / session_baud;
+
+  while (acked < size)
+  {
+    // Keep the window full
+    while (next < size && (next - acked + UPLOAD_CHUNK - 1) / UPLOAD_CHUNK < (uint32_t)window)
+    {
+      if (stop_after >= 0 && next >= (uint32_t)stop_after)
+      {
+        printf("%s: stopping at %u bytes\n", name, next);
+        exit(0);
+      }
+
+      sendData(data, next);
+      next += size - next < UPLOAD_CHUNK ? size - next : UPLOAD_CHUNK;
+    }
+
+    if (!receiveFrame(data_timeout))
+    {
+      // Nothing came back, start over from the last acknowledged offset
+      retransmits += (next - acked + UPLOAD_CHUNK - 1) / UPLOAD_CHUNK;
+      next = acked;
+      continue;
+    }
+
+    uint32_t offset = parser.payload_length >= 4 ? uploadGet32(parser.payload) : 0;
+    if (parser.type == UPLOAD_ACK && offset > acked)
+    {
+      acked = offset;
+    }
+    else if (parser.type == UPLOAD_NAK && offset >= acked)
+    {
+      retransmits += (next - offset + UPLOAD_CHUNK - 1) / UPLOAD_CHUNK;
+      acked = offset;
+      next = offset;
+    }
+    else if (parser.type == UPLOAD_ERROR)
+    {
+      fprintf(stderr, "%s: the frame reported error %u\n", name, parser.payload[0]);
+      return -1;
+    }
+  }
+
+  if (!request(UPLOAD_CLOSE, nullptr, 0, UPLOAD_CLOSE_ACK, 3) || parser.payload[0] != UPLOAD_STATUS_OK)
+  {
+    fprintf(stderr, "%s: not stored (status %d)\n", name, parser.type == UPLOAD_CLOSE_ACK ? parser.payload[0] : -1);
+    return -1;
+  }
+
+  double elapsed = (nowMs() - started_at) / 1000.0;
+  uint32_t sent = size - resumed_at;
+  printf("%s: %u bytes in %.2f s, %.1f KB/s", name, sent, elapsed, elapsed > 0 ? sent / 1024.0 / elapsed : 0.0);
+  if (resumed_at)
+    printf(", resumed at %u", resumed_at);
+  if (retransmits)
+    printf(", %u frames resent", retransmits);
+  printf("\n");
+
+  return sent;
+}
+
+int main(int argc, char **argv)
+{
+  uint32_t baud = UPLOAD_MAX_BAUD;
+  int arg = 1;
+
+  for (; arg < argc && argv[arg][0] == '-'; arg++)
+  {
+    if (strcmp(argv[arg], "-b") == 0 && arg + 1 < argc)
+      baud = strtoul(argv[++arg], nullptr, 10);
+    else if (strcmp(argv[arg], "-z") == 0)
+      compress_data = true;
+    else if (strcmp(argv[arg], "--stop-after") == 0 && arg + 1 < argc)
+      stop_after = strtol(argv[++arg], nullptr, 10);
+    else
+      break;
+  }
+
+  if (argc - arg < 2 || speedFor(baud) == 0)
+  {
+    fprintf(stderr, "Usage: %s [-b baud] [-z] <port> <file>...\n", argv[0]);
+    fprintf(stderr, "  -b baud  session baud, 115200 to 2000000 (default %d)\n", UPLOAD_MAX_BAUD);
+    fprintf(stderr, "  -z       compress data frames\n");
+    return 2;
+  }
+
+  port = open(argv[arg], O_RDWR | O_NOCTTY | O_NONBLOCK);
+  if (port < 0 || !setBaud(UPLOAD_DEFAULT_BAUD))
+  {
+    perror(argv[arg]);
+    return 1;
+  }
+  uploadParserReset(parser);
+
+  // The frame takes its clock from the host
+  time_t now = time(nullptr);
+  struct tm local;
+  localtime_r(&now, &local);
+
+  uint8_t hello[UPLOAD_HELLO_CLOCK_LENGTH];
+  uploadPut32(hello, baud);
+  uploadPut32(hello + 4, (uint32_t)now);
+  uploadPut32(hello + 8, (uint32_t)(int32_t)local.tm_gmtoff);
+  if (!request(UPLOAD_HELLO, hello, sizeof(hello), UPLOAD_HELLO_ACK, HELLO_ATTEMPTS))
+  {
+    fprintf(stderr, "No answer from the frame on %s\n", argv[arg]);
+    return 1;
+  }
+
+  session_baud = uploadGet32(parser.payload);
+  int window = parser.payload[6];
+  if (speedFor(session_baud) == 0 || !setBaud(session_baud) || !request(UPLOAD_PING, nullptr, 0, UPLOAD_PONG, PING_ATTEMPTS))
+  {
+    fprintf(stderr, "Could not switch to %u baud\n", session_baud);
+    return 1;
+  }
+  printf("Session at %u baud, window %d x %d bytes%s\n", session_baud, window, UPLOAD_CHUNK,
+         compress_data ? ", compressed" : "");
+
+  int failed = 0;
+  long total = 0;
+  double started_at = nowMs();
+
+  for (int i = arg + 1; i < argc; i++)
+  {
+    long sent = sendFile(argv[i], window);
+    if (sent < 0)
+      failed++;
+    else
+      total += sent;
+  }
+
+  double elapsed = (nowMs() - started_at) / 1000.0;
+  request(UPLOAD_BYE, nullptr, 0, UPLOAD_BYE_ACK, 3);
+
+  printf("Sent %d file(s), %ld bytes in %.2f s, sustained %.1f KB/s\n", argc - arg - 1 - failed, total, elapsed,
+         elapsed > 0 ? total / 1024.0 / elapsed : 0.0);
+  if (parser.crc_errors)
+    printf("%u damaged frames received\n", parser.crc_errors);
+
+  close(port);
+  return failed ? 1 : 0;
+}
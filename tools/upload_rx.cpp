@@ -0,0 +1,233 @@
+// Host receiver for the serial upload protocol, the frame's receive mode
+// (src/upload.cpp) running against a directory that stands in for the SD
+// card.
+//
+// Creates a pseudo-terminal pair and prints the path of its terminal side,
+// which the sender opens like the frame's USB serial port. Reads are paced
+// to the negotiated baud, so the reported rates match a real link, and
+// --noise N flips a bit in about one of every N bytes received to exercise
+// the CRC and retransmission paths. Sessions are served until the process
+// is stopped, or only one with --once. Used by scripts/upload_test.sh to
+// run the protocol end to end on Linux.
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <string>
+
+#include "upload.h"
+
+static int master = -1;
+static std::string card_dir;
+
+static uint32_t line_baud = UPLOAD_DEFAULT_BAUD;
+static double line_credit = 0; // bytes the line could have carried since the last read
+static double line_read_at = 0;
+static long noise_interval = 0;
+
+static double nowMs()
+{
+  using namespace std::chrono;
+  return duration<double, std::milli>(steady_clock::now().time_since_epoch()).count();
+}
+
+static std::string cardPath(const char *path)
+{
+  return card_dir + path;
+}
+
+static size_t portRead(void *context, uint8_t *buffer, size_t length)
+{
+  // Ten bits per byte on the wire, with at most a few ms of backlog
+  double now = nowMs();
+  line_credit += (now - line_read_at) * line_baud / 10000.0;
+  line_read_at = now;
+  if (line_credit > line_baud / 1000.0)
+    line_credit = line_baud / 1000.0;
+  if (length > line_credit)
+    length = (size_t)line_credit;
+
+  // Waits briefly so the session loop does not spin
+  struct pollfd fds = {master, POLLIN, 0};
+  if (length == 0 || poll(&fds, 1, 1) <= 0)
+    return 0;
+
+  ssize_t n = read(master, buffer, length);
+  if (n <= 0)
+    return 0;
+  line_credit -= n;
+
+  for (ssize_t i = 0; noise_interval > 0 && i < n; i++)
+  {
+    if (rand() % noise_interval == 0)
+      buffer[i] ^= 1 << (rand() % 8);
+  }
+  return n;
+}
+
+static void portWrite(void *context, const uint8_t *data, size_t length)
+{
+  while (length > 0)
+  {
+    ssize_t n = write(master, data, length);
+    if (n > 0)
+    {
+      data += n;
+      length -= n;
+    }
+    else if (n < 0 && errno != EAGAIN && errno != EINTR)
+    {
+      return;
+    }
+  }
+}
+
+// A pseudo-terminal runs at any baud, only the pacing follows it
+static void portSetBaud(void *context, uint32_t baud)
+{
+  line_baud = baud;
+}
+
+static uint32_t clockMillis(void *context)
+{
+  return (uint32_t)nowMs();
+}
+
+static void *cardOpen(void *context, const char *path, const char *mode)
+{
+  const char *file_mode = mode[0] == 'r' ? "rb" : mode[0] == 'w' ? "wb" : "ab";
+  return fopen(cardPath(path).c_str(), file_mode);
+}
+
+static size_t cardRead(void *context, void *file, uint8_t *buffer, size_t length)
+{
+  return fread(buffer, 1, length, (FILE *)file);
+}
+
+static size_t cardWrite(void *context, void *file, const uint8_t *data, size_t length)
+{
+  return fwrite(data, 1, length, (FILE *)file);
+}
+
+static void cardClose(void *context, void *file)
+{
+  fclose((FILE *)file);
+}
+
+static long cardSize(void *context, const char *path)
+{
+  struct stat info;
+  return stat(cardPath(path).c_str(), &info) == 0 ? info.st_size : -1;
+}
+
+static bool cardRemove(void *context, const char *path)
+{
+  return remove(cardPath(path).c_str()) == 0;
+}
+
+static bool cardRename(void *context, const char *from, const char *to)
+{
+  return rename(cardPath(from).c_str(), cardPath(to).c_str()) == 0;
+}
+
+static void onEvent(void *context, int event, const char *name, uint32_t done, uint32_t total)
+{
+  if (event == UPLOAD_EVENT_PROGRESS && done == total)
+    printf("Received %s (%u bytes)\n", name, total);
+  else if (event == UPLOAD_EVENT_START)
+    printf("Session started\n");
+  fflush(stdout);
+}
+
+static void onClock(void *context, uint32_t utc, int32_t utc_offset)
+{
+  printf("Host clock %u, UTC%+d s\n", utc, utc_offset);
+  fflush(stdout);
+}
+
+int main(int argc, char **argv)
+{
+  bool once = false;
+  int arg = 1;
+  for (; arg < argc - 1; arg++)
+  {
+    if (strcmp(argv[arg], "--once") == 0)
+      once = true;
+    else if (strcmp(argv[arg], "--noise") == 0 && arg + 1 < argc - 1)
+      noise_interval = strtol(argv[++arg], nullptr, 10);
+    else
+      break;
+  }
+
+  if (arg != argc - 1)
+  {
+    fprintf(stderr, "Usage: %s [--once] [--noise N] <card directory>\n", argv[0]);
+    return 2;
+  }
+  card_dir = argv[arg];
+  line_read_at = nowMs();
+
+  master = posix_openpt(O_RDWR | O_NOCTTY);
+  if (master < 0 || grantpt(master) != 0 || unlockpt(master) != 0)
+  {
+    perror("pseudo-terminal");
+    return 1;
+  }
+
+  // Keep the terminal side open and raw, so the pair survives senders
+  // coming and going, which is what resuming needs
+  const char *port_path = ptsname(master);
+  int terminal = open(port_path, O_RDWR | O_NOCTTY);
+  struct termios tty;
+  if (terminal < 0 || tcgetattr(terminal, &tty) != 0)
+  {
+    perror(port_path);
+    return 1;
+  }
+  cfmakeraw(&tty);
+  tcsetattr(terminal, TCSANOW, &tty);
+
+  printf("PORT %s\n", port_path);
+  fflush(stdout);
+
+  UploadIo io = {};
+  io.read = portRead;
+  io.write = portWrite;
+  io.set_baud = portSetBaud;
+  io.millis = clockMillis;
+  io.open = cardOpen;
+  io.file_read = cardRead;
+  io.file_write = cardWrite;
+  io.close = cardClose;
+  io.size = cardSize;
+  io.remove = cardRemove;
+  io.rename = cardRename;
+  io.event = onEvent;
+  io.set_clock = onClock;
+
+  while (true)
+  {
+    UploadStats stats;
+    if (!uploadPoll(io, &stats))
+      continue;
+
+    printf("Session over: %d file(s), %u bytes (%u on the wire) in %u ms\n", stats.files, stats.bytes,
+           stats.wire_bytes, stats.elapsed_ms);
+    fflush(stdout);
+
+    if (once)
+      break;
+  }
+
+  close(terminal);
+  close(master);
+  return 0;
+}